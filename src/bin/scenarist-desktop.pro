@@ -355,6 +355,7 @@ SOURCES += \
     scenarist-core/BusinessLayer/Tools/RestoreFromBackupTool.cpp \
     scenarist-core/BusinessLayer/ScenarioDocument/ScriptBookmarksModel.cpp \
     scenarist-desktop/ManagementLayer/Scenario/ScriptBookmarksManager.cpp \
+    scenarist-desktop/ManagementLayer/Scenario/ScriptSpellingIndex.cpp \
     scenarist-desktop/UserInterfaceLayer/Scenario/ScriptBookmarks/ScriptBookmarks.cpp \
     scenarist-desktop/UserInterfaceLayer/Scenario/ScriptBookmarks/BookmarkDialog.cpp \
     scenarist-core/Domain/ScriptVersion.cpp \
@@ -640,6 +641,7 @@ HEADERS += \
     scenarist-core/BusinessLayer/Tools/RestoreFromBackupTool.h \
     scenarist-core/BusinessLayer/ScenarioDocument/ScriptBookmarksModel.h \
     scenarist-desktop/ManagementLayer/Scenario/ScriptBookmarksManager.h \
+    scenarist-desktop/ManagementLayer/Scenario/ScriptSpellingIndex.h \
     scenarist-desktop/UserInterfaceLayer/Scenario/ScriptBookmarks/ScriptBookmarks.h \
     scenarist-desktop/UserInterfaceLayer/Scenario/ScriptBookmarks/BookmarkDialog.h \
     scenarist-core/Domain/ScriptVersion.h \
@@ -49,6 +49,7 @@
 #include <QDesktopServices>
 #include <QFileDialog>
 #include <QLabel>
+#include <QLoggingCategory>
 #include <QMenu>
 #include <QMenuBar>
 #include <QProcess>
@@ -68,6 +69,18 @@
 #include <functional>
 
 using namespace ManagementLayer;
+
+/**
+ * @brief Категория журнала для замеров времени этапов загрузки проекта
+ * @note Включается через QT_LOGGING_RULES="scenarist.projectloading=true"
+ */
+Q_LOGGING_CATEGORY(projectLoading, "scenarist.projectloading")
+
+/**
+ * @brief Категория журнала для замеров времени, на которое сохранение блокирует интерфейс
+ * @note Включается через QT_LOGGING_RULES="scenarist.projectsaving=true"
+ */
+Q_LOGGING_CATEGORY(projectSaving, "scenarist.projectsaving")
 using UserInterface::ApplicationView;
 using UserInterface::AddProjectDialog;
 using UserInterface::MenuView;
@@ -97,6 +110,22 @@ namespace {
     const int SETTINGS_TAB_INDEX = 6;
     /** @} */
 
+    /**
+     * @brief Время после последнего изменения проекта, в течение которого автосохранение откладывается, мс
+     * @note Соответствует интервалу определения простоя приложения
+     */
+    const int kAutosaveIdleDelay = 3000;
+
+    /**
+     * @brief Этапы загрузки проекта, выполняемые после того, как текст сценария уже показан
+     */
+    /** @{ */
+    const int kLoadingCardsStage = 0;
+    const int kLoadingResearchStage = 1;
+    const int kLoadingStatisticsStage = 2;
+    const int kLoadingFinishStage = 3;
+    /** @} */
+
     /**
      * @brief Расширения файлов проекта
      */
@@ -628,6 +657,11 @@ void ApplicationManager::aboutSave()
         return;
     }
 
+    //
+    // Если проект ещё загружается, то сперва дозагрузим его
+    //
+    completeProjectLoading();
+
     //
     // Сохраняем только, если приложение находится в рабочем состоянии
     //
@@ -655,10 +689,23 @@ void ApplicationManager::aboutSave()
         //
         // Управляющие должны сохранить несохранённые данные
         //
+        // ... сохранение выполняется в потоке интерфейса целиком, поэтому его длительность
+        //     и есть время, на которое оно прерывает работу пользователя
+        //
+        QElapsedTimer saveTimer;
+        saveTimer.start();
         DatabaseLayer::Database::transaction();
         m_researchManager->saveResearch();
+        const qint64 researchSaveTime = saveTimer.elapsed();
         m_scenarioManager->saveCurrentProject();
+        const qint64 scriptSaveTime = saveTimer.elapsed() - researchSaveTime;
         DatabaseLayer::Database::commit();
+        const qint64 saveTime = saveTimer.elapsed();
+        m_longestSaveTime = qMax(m_longestSaveTime, saveTime);
+        qCInfo(projectSaving) << "project saved in" << saveTime << "ms: research" << researchSaveTime
+                              << "ms, script" << scriptSaveTime << "ms, commit"
+                              << saveTime - researchSaveTime - scriptSaveTime
+                              << "ms; longest save" << m_longestSaveTime << "ms";
 
         //
         // Обновим информацию о последнем изменении
@@ -686,6 +733,13 @@ void ApplicationManager::aboutSave()
                 //
                 baseBackupName = QString("%1 [%2]").arg(currentProject.name()).arg(currentProject.id());
             }
+            //
+            // ... в копию должен попасть полный текст сценария, а не только патчи после снимка,
+            //     чтобы её можно было открыть любой версией программы
+            //
+            if (m_isBackupsEnabled) {
+                m_scenarioManager->compactCurrentProject();
+            }
             QtConcurrent::run(&m_backupHelper, &BackupHelper::saveBackup, ProjectsManager::currentProject().path(), baseBackupName);
         }
         //
@@ -745,6 +799,20 @@ void ApplicationManager::aboutSave()
     }
 }
 
+void ApplicationManager::aboutAutosave()
+{
+    //
+    // Если пользователь только что изменил проект, то не прерываем его работу,
+    // сохранение произойдёт при первом же простое приложения
+    //
+    if (m_lastProjectChangeTimer.isValid()
+        && m_lastProjectChangeTimer.elapsed() < kAutosaveIdleDelay) {
+        return;
+    }
+
+    aboutSave();
+}
+
 void ApplicationManager::aboutStartNewVersion()
 {
     UserInterface::ProjectVersionDialog versionDialog(m_view);
@@ -1464,11 +1532,13 @@ void ApplicationManager::aboutSyncClosedWithError(int _errorCode, const QString&
 
 void ApplicationManager::aboutImport()
 {
+    //
+    // Импорт выполняется в фоне, рабочее состояние восстановится по его завершении
+    //
     m_state = ApplicationState::Importing;
-    m_importManager->importScenario(m_scenarioManager->scenario(), m_scenarioManager->cursorPosition());
-    m_researchManager->loadScenarioData();
-
-    m_state = ApplicationState::Working;
+    if (!m_importManager->importScenario(m_scenarioManager->scenario(), m_scenarioManager->cursorPosition())) {
+        m_state = ApplicationState::Working;
+    }
 }
 
 void ApplicationManager::aboutExport()
@@ -1523,6 +1593,7 @@ void ApplicationManager::aboutProjectChanged()
     if (isProjectLoaded()) {
         updateWindowModified(m_view, true);
         m_statisticsManager->scenarioTextChanged();
+        m_lastProjectChangeTimer.start();
     }
 }
 
@@ -1790,6 +1861,10 @@ bool ApplicationManager::saveIfNeeded()
 void ApplicationManager::goToEditCurrentProject(const QString& _importFilePath)
 {
     m_state = ApplicationState::ProjectLoading;
+    ++m_projectLoadingId;
+    m_projectLoadingStage = kLoadingCardsStage;
+    m_projectLoadingImportFilePath = _importFilePath;
+    m_projectLoadingTimer.start();
 
     //
     // Покажем уведомление пользователю
@@ -1842,6 +1917,13 @@ void ApplicationManager::goToEditCurrentProject(const QString& _importFilePath)
         m_synchronizationManager->prepareToFullSynchronization();
     }
 
+    //
+    // Панели, данные которых ещё не загружены, блокируем до окончания их загрузки
+    //
+    m_scenarioManager->cardsView()->setEnabled(false);
+    m_researchManager->view()->setEnabled(false);
+    m_statisticsManager->view()->setEnabled(false);
+
     //
     // FIXME: Сделать загрузку сценария  сразу в БД, это заодно позволит избавиться
     //		  и от необходимости сохранять проект после синхронизации
@@ -1850,6 +1932,7 @@ void ApplicationManager::goToEditCurrentProject(const QString& _importFilePath)
     // Это нужно делать перед синхронизацией текста
     //
     m_scenarioManager->loadCurrentProject();
+    qCInfo(projectLoading) << "script loaded in" << m_projectLoadingTimer.elapsed() << "ms";
 
     //
     // Синхронизируем проекты из облака
@@ -1858,40 +1941,14 @@ void ApplicationManager::goToEditCurrentProject(const QString& _importFilePath)
         progress.setProgressText(QString::null, tr("Sync scenario with cloud service."));
         m_synchronizationManager->aboutFullSyncScenario();
         m_synchronizationManager->aboutFullSyncData();
+        qCInfo(projectLoading) << "cloud sync finished in" << m_projectLoadingTimer.elapsed() << "ms";
     }
 
     //
-    // FIXME: Если были изменения связанные с текстом сценария перестраиваем карточки
-    //        т.к. там нет пока синхронизации
-    //
-    m_scenarioManager->rebuildCardsFromScript();
-
-    //
-    // Загрузить данные из файла
-    // Делать это нужно после того, как все данные синхронизировались
-    //
-    m_researchManager->loadCurrentProject();
-    m_statisticsManager->loadCurrentProject();
-
-    //
-    // Затем импортируем данные из указанного файла, если необходимо
-    //
-    if (!_importFilePath.isEmpty()) {
-        progress.setProgressText(tr("Import"), tr("Please wait. Import can take few minutes."));
-        m_importManager->importScenario(m_scenarioManager->scenario(), _importFilePath);
-        m_researchManager->loadScenarioData();
-    }
-
-    //
-    // Запускаем обработку изменений сценария
-    //
-    m_scenarioManager->startChangesHandling();
-
-    //
-    // Загрузить настройки файла
-    // Порядок загрузки важен - сначала настройки каждого модуля, потом активные вкладки
+    // Загрузить настройки файла, чтобы показать проект в том виде, в котором пользователь оставил его
+    // Порядок загрузки важен - сначала настройки каждого модуля, потом активные вкладки,
+    // настройки разработки загружаются вместе с её данными
     //
-    m_researchManager->loadCurrentProjectSettings(ProjectsManager::currentProject().path());
     m_scenarioManager->loadCurrentProjectSettings(ProjectsManager::currentProject().path());
     m_exportManager->loadCurrentProjectSettings(ProjectsManager::currentProject().path());
     m_toolsManager->loadCurrentProjectSettings();
@@ -1903,38 +1960,144 @@ void ApplicationManager::goToEditCurrentProject(const QString& _importFilePath)
     updateWindowTitle();
 
     //
-    // Установим параметры между менеджерами
-    //
-    m_scenarioManager->setScriptHeader(m_researchManager->scriptHeader());
-    m_scenarioManager->setScriptFooter(m_researchManager->scriptFooter());
-    m_scenarioManager->setSceneNumbersPrefix(m_researchManager->sceneNumbersPrefix());
-    m_scenarioManager->setSceneStartNumber(m_researchManager->sceneStartNumber());
-
-    //
-    // Обновим информацию о последнем изменении
-    //
-    aboutUpdateLastChangeInfo();
-
-    //
-    // Закроем уведомление
+    // Закроем уведомление, текст сценария уже можно редактировать
     //
     QApplication::sendPostedEvents();
     QApplication::processEvents();
     progress.finish();
-
-    m_state = ApplicationState::Working;
+    qCInfo(projectLoading) << "script shown in" << m_projectLoadingTimer.elapsed() << "ms";
 
     //
-    // После того, как все данные загружены и синхронизированы, сохраняем проект
+    // Остальные данные загружаем поэтапно, давая приложению обработать события между этапами
     //
-    if (m_projectsManager->currentProject().isRemote()) {
-        updateWindowModified(m_view, true);
-        aboutSave();
+    continueProjectLoading(m_projectLoadingId);
+}
+
+void ApplicationManager::continueProjectLoading(int _loadingId)
+{
+    QTimer::singleShot(0, this, [this, _loadingId] {
+        //
+        // Если проект был закрыт, или начата загрузка другого проекта, то прерываем загрузку
+        //
+        if (_loadingId != m_projectLoadingId
+            || m_state != ApplicationState::ProjectLoading) {
+            return;
+        }
+
+        loadProjectStage(m_projectLoadingStage++);
+        continueProjectLoading(_loadingId);
+    });
+}
+
+void ApplicationManager::completeProjectLoading()
+{
+    while (m_state == ApplicationState::ProjectLoading
+           && m_projectLoadingStage <= kLoadingFinishStage) {
+        loadProjectStage(m_projectLoadingStage++);
+    }
+}
+
+void ApplicationManager::loadProjectStage(int _stage)
+{
+    switch (_stage) {
+        case kLoadingCardsStage: {
+            //
+            // FIXME: Если были изменения связанные с текстом сценария перестраиваем карточки
+            //        т.к. там нет пока синхронизации
+            // ... загрузка не должна помечать проект изменённым, при этом сохраняем отметку
+            //     об изменениях, которые пользователь мог успеть сделать
+            //
+            const bool isModified = m_view->isWindowModified();
+            m_scenarioManager->rebuildCardsFromScript();
+            updateWindowModified(m_view, isModified);
+            m_scenarioManager->cardsView()->setEnabled(true);
+            qCInfo(projectLoading) << "cards loaded in" << m_projectLoadingTimer.elapsed() << "ms";
+            break;
+        }
+
+        case kLoadingResearchStage: {
+            //
+            // Загрузить данные из файла
+            // Делать это нужно после того, как все данные синхронизировались
+            //
+            const bool isModified = m_view->isWindowModified();
+            m_researchManager->loadCurrentProject();
+            updateWindowModified(m_view, isModified);
+
+            //
+            // Затем импортируем данные из указанного файла, если необходимо
+            //
+            if (!m_projectLoadingImportFilePath.isEmpty()) {
+                m_importManager->importScenario(m_scenarioManager->scenario(), m_projectLoadingImportFilePath);
+                m_projectLoadingImportFilePath.clear();
+            }
+
+            m_researchManager->loadCurrentProjectSettings(ProjectsManager::currentProject().path());
+
+            //
+            // Установим параметры между менеджерами
+            //
+            m_scenarioManager->setScriptHeader(m_researchManager->scriptHeader());
+            m_scenarioManager->setScriptFooter(m_researchManager->scriptFooter());
+            m_scenarioManager->setSceneNumbersPrefix(m_researchManager->sceneNumbersPrefix());
+            m_scenarioManager->setSceneStartNumber(m_researchManager->sceneStartNumber());
+
+            m_researchManager->view()->setEnabled(true);
+            qCInfo(projectLoading) << "research loaded in" << m_projectLoadingTimer.elapsed() << "ms";
+            break;
+        }
+
+        case kLoadingStatisticsStage: {
+            m_statisticsManager->loadCurrentProject();
+            m_statisticsManager->view()->setEnabled(true);
+            qCInfo(projectLoading) << "statistics loaded in" << m_projectLoadingTimer.elapsed() << "ms";
+            break;
+        }
+
+        case kLoadingFinishStage: {
+            //
+            // Запускаем обработку изменений сценария
+            //
+            m_scenarioManager->startChangesHandling();
+
+            //
+            // Обновим информацию о последнем изменении
+            //
+            aboutUpdateLastChangeInfo();
+
+            m_state = ApplicationState::Working;
+            qCInfo(projectLoading) << "project loaded in" << m_projectLoadingTimer.elapsed() << "ms";
+
+            //
+            // После того, как все данные загружены и синхронизированы, сохраняем проект
+            //
+            if (m_projectsManager->currentProject().isRemote()) {
+                updateWindowModified(m_view, true);
+                aboutSave();
+            }
+            break;
+        }
     }
 }
 
 void ApplicationManager::closeCurrentProject()
 {
+    //
+    // Прерываем поэтапную загрузку проекта, если она ещё не завершилась
+    //
+    ++m_projectLoadingId;
+    if (m_state == ApplicationState::ProjectLoading) {
+        m_state = ApplicationState::Working;
+    }
+
+    //
+    // Результат незавершённого импорта в закрываемый проект не нужен
+    //
+    m_importManager->cancelImport();
+    m_scenarioManager->cardsView()->setEnabled(true);
+    m_researchManager->view()->setEnabled(true);
+    m_statisticsManager->view()->setEnabled(true);
+
     if (isProjectLoaded()) {
         //
         // Сохраним настройки закрываемого проекта
@@ -1944,6 +2107,12 @@ void ApplicationManager::closeCurrentProject()
         m_exportManager->saveCurrentProjectSettings(ProjectsManager::currentProject().path());
         saveCurrentProjectSettings(ProjectsManager::currentProject().path());
 
+        //
+        // Запишем полный снимок сценария, чтобы при следующем открытии не пришлось
+        // накатывать изменения, сделанные после предыдущего снимка
+        //
+        m_scenarioManager->compactCurrentProject();
+
         //
         // Закроем проект управляющими
         //
@@ -2228,6 +2397,15 @@ void ApplicationManager::initConnections()
     connect(m_startUpManager, &StartUpManager::unshareRemoteProjectRequested, this, &ApplicationManager::unshareRemoteProject);
     connect(m_startUpManager, &StartUpManager::updatePublished, m_menuManager, &MenuManager::showUpdateButton);
 
+    connect(m_importManager, &ImportManager::importFinished, this, [this] (bool _isImported) {
+        if (_isImported) {
+            m_researchManager->loadScenarioData();
+        }
+        if (m_state == ApplicationState::Importing) {
+            m_state = ApplicationState::Working;
+        }
+    });
+
     connect(m_researchManager, &ResearchManager::scriptNameChanged, this, &ApplicationManager::updateWindowTitle);
     connect(m_researchManager, &ResearchManager::scriptHeaderChanged, m_scenarioManager, &ScenarioManager::setScriptHeader);
     connect(m_researchManager, &ResearchManager::scriptFooterChanged, m_scenarioManager, &ScenarioManager::setScriptFooter);
@@ -2240,6 +2418,7 @@ void ApplicationManager::initConnections()
     connect(m_researchManager, &ResearchManager::locationNameChanged, m_scenarioManager, &ScenarioManager::aboutLocationNameChanged);
     connect(m_researchManager, &ResearchManager::refreshLocations, m_scenarioManager, &ScenarioManager::aboutRefreshLocations);
     connect(m_researchManager, &ResearchManager::addScriptVersionRequested, this, &ApplicationManager::aboutStartNewVersion);
+    connect(m_researchManager, &ResearchManager::currentScriptTextRequested, m_scenarioManager, &ScenarioManager::updateCurrentScriptText);
 
     connect(m_scenarioManager, &ScenarioManager::showFullscreen, this, &ApplicationManager::aboutShowFullscreen);
     connect(m_scenarioManager, &ScenarioManager::updateScenarioRequest, this, &ApplicationManager::aboutUpdateLastChangeInfo);
@@ -2271,6 +2450,7 @@ void ApplicationManager::initConnections()
     connect(m_settingsManager, &SettingsManager::scenarioEditSettingsUpdated, m_toolsManager, &ToolsManager::reloadTextEditSettings);
 
     connect(m_toolsManager, &ToolsManager::applyScriptRequested, m_scenarioManager, &ScenarioManager::setScriptXml);
+    connect(m_toolsManager, &ToolsManager::currentScriptTextRequested, m_scenarioManager, &ScenarioManager::updateCurrentScriptText);
 
     connect(m_researchManager, SIGNAL(researchChanged()), this, SLOT(aboutProjectChanged()));
     connect(m_scenarioManager, SIGNAL(scenarioChanged()), this, SLOT(aboutProjectChanged()));
@@ -2459,7 +2639,7 @@ void ApplicationManager::reloadApplicationSettings()
     m_autosaveTimer.stop();
     m_autosaveTimer.disconnect();
     if (autosave) {
-        connect(&m_autosaveTimer, SIGNAL(timeout()), this, SLOT(aboutSave()));
+        connect(&m_autosaveTimer, SIGNAL(timeout()), this, SLOT(aboutAutosave()));
         m_autosaveTimer.start(autosaveInterval * 60 * 1000); // Переводим минуты в миллисекунды
     }
 
@@ -2475,6 +2655,7 @@ void ApplicationManager::reloadApplicationSettings()
             DataStorageLayer::StorageFacade::settingsStorage()->value(
                 "application/save-backups-folder",
                 DataStorageLayer::SettingsStorage::ApplicationSettings);
+    m_isBackupsEnabled = saveBackups;
     m_backupHelper.setIsActive(saveBackups);
     m_backupHelper.setBackupDir(saveBackupsFolder);
 
@@ -3,6 +3,7 @@
 
 #include <3rd_party/Helpers/BackupHelper.h>
 
+#include <QElapsedTimer>
 #include <QObject>
 #include <QTimer>
 
@@ -95,6 +96,13 @@ namespace ManagementLayer
          */
         void aboutSave();
 
+        /**
+         * @brief Сохранить в файл по таймеру автосохранения
+         * @note Если пользователь в данный момент редактирует проект, то сохранение откладывается
+         *       до ближайшего простоя приложения, чтобы не прерывать набор текста
+         */
+        void aboutAutosave();
+
         /**
          * @brief Начать новую версию сценария
          */
@@ -262,6 +270,23 @@ namespace ManagementLayer
          */
         void goToEditCurrentProject(const QString& _importFilePath = QString());
 
+        /**
+         * @brief Запланировать выполнение очередного этапа загрузки проекта
+         * @note Этапы выполняются в следующих итерациях цикла событий, чтобы пользователь мог
+         *       работать с текстом сценария, пока загружаются остальные данные
+         */
+        void continueProjectLoading(int _loadingId);
+
+        /**
+         * @brief Выполнить все оставшиеся этапы загрузки проекта сразу
+         */
+        void completeProjectLoading();
+
+        /**
+         * @brief Выполнить заданный этап загрузки проекта
+         */
+        void loadProjectStage(int _stage);
+
         /**
          * @brief Закрыть текущий проект
          */
@@ -421,11 +446,36 @@ namespace ManagementLayer
          */
         QTimer m_autosaveTimer;
 
+        /**
+         * @brief Время прошедшее с последнего изменения проекта
+         */
+        QElapsedTimer m_lastProjectChangeTimer;
+
+        /**
+         * @brief Наибольшая длительность сохранения проекта за время работы, мс
+         */
+        qint64 m_longestSaveTime = 0;
+
+        /**
+         * @brief Данные поэтапной загрузки проекта
+         */
+        /** @{ */
+        int m_projectLoadingId = 0;
+        int m_projectLoadingStage = 0;
+        QString m_projectLoadingImportFilePath;
+        QElapsedTimer m_projectLoadingTimer;
+        /** @} */
+
         /**
          * @brief Помощник резервного копирования
          */
         BackupHelper m_backupHelper;
 
+        /**
+         * @brief Включено ли создание резервных копий
+         */
+        bool m_isBackupsEnabled = false;
+
         /**
          * @brief Состояние приложения в данный момент
          */
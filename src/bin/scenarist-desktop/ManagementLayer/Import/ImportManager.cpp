@@ -24,9 +24,14 @@
 #include <3rd_party/Widgets/QLightBoxWidget/qlightboxprogress.h>
 #include <3rd_party/Widgets/QLightBoxWidget/qlightboxmessage.h>
 
+#include <format_manager.h>
+
 #include <QApplication>
 #include <QFile>
+#include <QFutureWatcher>
 #include <QSet>
+#include <QTextCursor>
+#include <QtConcurrentRun>
 
 using ManagementLayer::ImportManager;
 using UserInterface::ImportDialog;
@@ -49,6 +54,58 @@ namespace {
     const QString kCeltxExtension = ".celtx";
     /** @} */
 
+    /**
+     * @brief Данные, прочитанные из импортируемого файла
+     */
+    struct ImportData {
+        QString scenarioXml;
+        QVariantMap research;
+    };
+
+    /**
+     * @brief Создать импортёр для заданного файла
+     */
+    static BusinessLogic::AbstractImporter* createImporter(const QString& _filePath) {
+        const QString filePath = _filePath.toLower();
+        if (filePath.endsWith(kKitScenaristExtension)) {
+            return new BusinessLogic::KitScenaristImporter;
+        } else if (filePath.endsWith(kFinalDraftExtension)
+                   || filePath.endsWith(kFinalDraftTemplateExtension)) {
+            return new BusinessLogic::FdxImporter;
+        } else if (filePath.endsWith(kTrelbyExtension)) {
+            return new BusinessLogic::TrelbyImporter;
+        } else if (filePath.endsWith(kFountainExtension)) {
+            return new BusinessLogic::FountainImporter;
+        } else if (filePath.endsWith(kCeltxExtension)) {
+            return new BusinessLogic::CeltxImporter;
+        }
+        return new BusinessLogic::DocumentImporter;
+    }
+
+    /**
+     * @brief Можно ли читать файл в фоновом потоке
+     * @note Импортёры из ядра не рассчитаны на работу в нескольких потоках, поэтому в фон отдаём только те,
+     *       что лишь разбирают файл, а проекты КИТ Сценариста читаются через соединение с базой данных,
+     *       которое можно использовать только в создавшем его потоке, поэтому их читаем в потоке гуи
+     */
+    static bool canReadInBackground(const QString& _filePath) {
+        return !_filePath.toLower().endsWith(kKitScenaristExtension);
+    }
+
+    /**
+     * @brief Прочитать импортируемый файл
+     * @note Не трогает ни документ сценария, ни базу данных, поэтому может выполняться в фоне
+     */
+    static ImportData readImportData(const BusinessLogic::ImportParameters& _importParameters) {
+        QScopedPointer<BusinessLogic::AbstractImporter> importer(createImporter(_importParameters.filePath));
+        ImportData data;
+        data.scenarioXml = importer->importScript(_importParameters);
+        if (!data.scenarioXml.isEmpty()) {
+            data.research = importer->importResearch(_importParameters);
+        }
+        return data;
+    }
+
     /**
      * @brief Сохранить импортированный документ разработки со вложенными документами
      */
@@ -164,30 +221,167 @@ ImportManager::ImportManager(QObject* _parent, QWidget* _parentWidget) :
 bool ImportManager::importScenario(BusinessLogic::ScenarioDocument* _scenario, int _cursorPosition,
     const BusinessLogic::ImportParameters& _importParameters)
 {
+    const ImportData data = ::readImportData(_importParameters);
+    return applyImport(_scenario, _cursorPosition, _importParameters, data.scenarioXml, data.research);
+}
+
+void ImportManager::importScenario(BusinessLogic::ScenarioDocument* _scenario, const QString& _importFilePath)
+{
+    BusinessLogic::ImportParameters importParameters;
+    importParameters.filePath = _importFilePath;
+    startImport(_scenario, 0, importParameters, false);
+}
+
+bool ImportManager::importScenario(BusinessLogic::ScenarioDocument* _scenario, int _cursorPosition)
+{
+    if (m_importDialog->exec() == QLightBoxDialog::Accepted) {
+        BusinessLogic::ImportParameters importParameters = m_importDialog->importParameters();
+
+        //
+        // Формат MS DOC не поддерживается, он отображается только для того, чтобы пользователи
+        // не теряли свои файлы
+        //
+        if (importParameters.filePath.toLower().endsWith(kMsDocExtension)) {
+            QLightBoxMessage::critical(m_importDialog, tr("File format not supported"),
+                tr("Microsoft <b>DOC</b> files are not supported. You need save it to <b>DOCX</b> file and reimport."));
+            return false;
+        }
+
+        //
+        // Если файла не существует, уведомим об этом
+        //
+        if (!QFile::exists(importParameters.filePath)) {
+            QLightBoxMessage::critical(m_importDialog, tr("File doesn't exists"),
+                tr("Please choose existing file and retry import."));
+            return false;
+        }
+
+        //
+        // Импортируем
+        //
+        startImport(_scenario, _cursorPosition, importParameters, true);
+        return true;
+    }
+
+    return false;
+}
+
+bool ImportManager::isImporting() const
+{
+    return m_progress != nullptr;
+}
+
+void ImportManager::cancelImport()
+{
+    if (!isImporting()) {
+        return;
+    }
+
+    //
+    // Останавливаем чтение документа, а результат, если он всё-таки успеет сформироваться, отбрасываем
+    //
+    if (!m_importCanceled.isNull()) {
+        m_importCanceled->storeRelease(1);
+    }
+    ++m_importId;
+    hideProgress();
+    emit importFinished(false);
+}
+
+void ImportManager::startImport(BusinessLogic::ScenarioDocument* _scenario, int _cursorPosition,
+    const BusinessLogic::ImportParameters& _importParameters, bool _notifyIfFailed)
+{
+    const int importId = ++m_importId;
+    QSharedPointer<QAtomicInt> importCanceled(new QAtomicInt(0));
+    m_importCanceled = importCanceled;
+
+    //
+    // Пока файл читается, пользователь может продолжать работать с текстом, поэтому позицию вставки
+    // отслеживаем курсором, который смещается вместе с изменениями документа
+    //
+    QTextCursor insertCursor(_scenario->document());
+    insertCursor.setPosition(qBound(0, _cursorPosition, _scenario->document()->characterCount() - 1));
+
     //
-    // Получим xml-представление импортируемого сценария
+    // Покажем уведомление пользователю
     //
-    QScopedPointer<BusinessLogic::AbstractImporter> importer;
-    if (_importParameters.filePath.toLower().endsWith(kKitScenaristExtension)) {
-        importer.reset(new BusinessLogic::KitScenaristImporter);
-    } else if (_importParameters.filePath.toLower().endsWith(kFinalDraftExtension)
-               || _importParameters.filePath.toLower().endsWith(kFinalDraftTemplateExtension)) {
-        importer.reset(new BusinessLogic::FdxImporter);
-    } else if (_importParameters.filePath.toLower().endsWith(kTrelbyExtension)) {
-        importer.reset(new BusinessLogic::TrelbyImporter);
-    } else if (_importParameters.filePath.toLower().endsWith(kFountainExtension)) {
-        importer.reset(new BusinessLogic::FountainImporter);
-    } else if (_importParameters.filePath.toLower().endsWith(kCeltxExtension)) {
-        importer.reset(new BusinessLogic::CeltxImporter);
-    } else {
-        importer.reset(new BusinessLogic::DocumentImporter);
+    if (m_progress == nullptr) {
+        m_progress = new QLightBoxProgress(m_importDialog->parentWidget());
+        m_progress->showProgress(tr("Import"), tr("Please wait. Import can take few minutes."));
     }
-    const QString importScenarioXml = importer->importScript(_importParameters);
 
+    //
+    // Вставляем в сценарий уже готовый результат чтения
+    //
+    auto finishImport = [this, importId, _scenario, insertCursor, _importParameters, _notifyIfFailed] (const ImportData& _data) {
+        //
+        // Импорт был прерван, или после него был начат другой
+        //
+        if (importId != m_importId) {
+            return;
+        }
+        m_importCanceled.reset();
+
+        QLightBoxProgress::setProgressText(tr("Import"), tr("Inserting imported text..."));
+        const int insertPosition = insertCursor.isNull() ? 0 : insertCursor.position();
+        const bool isImportSucceed =
+                applyImport(_scenario, insertPosition, _importParameters, _data.scenarioXml, _data.research);
+
+        //
+        // Закроем уведомление
+        //
+        hideProgress();
+
+        //
+        // Если импорт не удался, уведомим об этом пользователя
+        //
+        if (!isImportSucceed && _notifyIfFailed) {
+            QLightBoxMessage::critical(m_importDialog->parentWidget(), tr("Import aborted"),
+                tr("File to import is empty. Please check that you select correct file and retry import."));
+        }
+
+        emit importFinished(isImportSucceed);
+    };
+
+    //
+    // Файлы, импортёры которых нельзя запускать в фоне, читаем сразу
+    //
+    if (!::canReadInBackground(_importParameters.filePath)) {
+        QApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
+        finishImport(::readImportData(_importParameters));
+        return;
+    }
+
+    //
+    // ... а остальные в отдельном потоке
+    //
+    QFutureWatcher<ImportData>* watcher = new QFutureWatcher<ImportData>(this);
+    connect(watcher, &QFutureWatcher<ImportData>::finished, this, [watcher, finishImport] {
+        watcher->deleteLater();
+        finishImport(watcher->result());
+    });
+    watcher->setFuture(QtConcurrent::run([this, importId, importCanceled, _importParameters] {
+        //
+        // Читатели документов создаются внутри импортёров, поэтому обработчики прогресса и прерывания
+        // передаём им через менеджер форматов, для всех читателей, создаваемых в этом потоке
+        //
+        FormatManager::setReaderHandlers(
+            [this, importId] (int _progress) { emit importProgressChanged(importId, _progress); },
+            [importCanceled] { return importCanceled->loadAcquire() != 0; });
+        const ImportData data = ::readImportData(_importParameters);
+        FormatManager::clearReaderHandlers();
+        return data;
+    }));
+}
+
+bool ImportManager::applyImport(BusinessLogic::ScenarioDocument* _scenario, int _cursorPosition,
+    const BusinessLogic::ImportParameters& _importParameters, const QString& _scenarioXml,
+    const QVariantMap& _research)
+{
     //
     // Если нету текста, прерываем выполнение
     //
-    if (importScenarioXml.isEmpty()) {
+    if (_scenarioXml.isEmpty()) {
         return false;
     }
 
@@ -216,9 +410,12 @@ bool ImportManager::importScenario(BusinessLogic::ScenarioDocument* _scenario, i
         }
     }
     //
-    // ... загрузим текст
+    // ... загрузим текст одним изменением, чтобы его можно было целиком отменить
     //
-    _scenario->document()->insertFromMime(insertPosition, importScenarioXml);
+    QTextCursor cursor(_scenario->document());
+    cursor.beginEditBlock();
+    _scenario->document()->insertFromMime(insertPosition, _scenarioXml);
+    cursor.endEditBlock();
 
     //
     // ... в случае необходимости определяем локации и персонажей
@@ -307,13 +504,12 @@ bool ImportManager::importScenario(BusinessLogic::ScenarioDocument* _scenario, i
     //
     // Загрузим данные разработки
     //
-    const QVariantMap research = importer->importResearch(_importParameters);
-    if (!research.isEmpty()) {
+    if (!_research.isEmpty()) {
         //
         // Данные сценария
         //
         {
-            const QVariantMap script = research["script"].toMap();
+            const QVariantMap script = _research["script"].toMap();
             DataStorageLayer::StorageFacade::scenarioDataStorage()->setName(script["name"].toString());
             DataStorageLayer::StorageFacade::scenarioDataStorage()->setLogline(script["logline"].toString());
             DataStorageLayer::StorageFacade::scenarioDataStorage()->setAdditionalInfo(script["additional_info"].toString());
@@ -329,7 +525,7 @@ bool ImportManager::importScenario(BusinessLogic::ScenarioDocument* _scenario, i
         //
         {
             QLightBoxProgress::setProgressText(tr("Characters import"), QString());
-            const QVariantList characters = research["characters"].toList();
+            const QVariantList characters = _research["characters"].toList();
             for (const QVariant& character : characters) {
                 ::storeCharacter(character.toMap());
             }
@@ -340,7 +536,7 @@ bool ImportManager::importScenario(BusinessLogic::ScenarioDocument* _scenario, i
         //
         {
             QLightBoxProgress::setProgressText(tr("Locations import"), QString());
-            const QVariantList locations = research["locations"].toList();
+            const QVariantList locations = _research["locations"].toList();
             for (const QVariant& location : locations) {
                 ::storeLocation(location.toMap());
             }
@@ -351,7 +547,7 @@ bool ImportManager::importScenario(BusinessLogic::ScenarioDocument* _scenario, i
         //
         {
             QLightBoxProgress::setProgressText(tr("Documents import"), QString());
-            const QVariantList documents = research["documents"].toList();
+            const QVariantList documents = _research["documents"].toList();
             for (const QVariant& document : documents) {
                 ::storeResearchDocument(document.toMap(), nullptr);
             }
@@ -361,60 +557,12 @@ bool ImportManager::importScenario(BusinessLogic::ScenarioDocument* _scenario, i
     return true;
 }
 
-void ImportManager::importScenario(BusinessLogic::ScenarioDocument* _scenario, const QString& _importFilePath)
-{
-    BusinessLogic::ImportParameters importParameters;
-    importParameters.filePath = _importFilePath;
-    importScenario(_scenario, 0, importParameters);
-}
-
-void ImportManager::importScenario(BusinessLogic::ScenarioDocument* _scenario, int _cursorPosition)
+void ImportManager::hideProgress()
 {
-    if (m_importDialog->exec() == QLightBoxDialog::Accepted) {
-        BusinessLogic::ImportParameters importParameters = m_importDialog->importParameters();
-
-        //
-        // Формат MS DOC не поддерживается, он отображается только для того, чтобы пользователи
-        // не теряли свои файлы
-        //
-        if (importParameters.filePath.toLower().endsWith(kMsDocExtension)) {
-            QLightBoxMessage::critical(m_importDialog, tr("File format not supported"),
-                tr("Microsoft <b>DOC</b> files are not supported. You need save it to <b>DOCX</b> file and reimport."));
-            return;
-        }
-
-        //
-        // Если файла не существует, уведомим об этом
-        //
-        if (!QFile::exists(importParameters.filePath)) {
-            QLightBoxMessage::critical(m_importDialog, tr("File doesn't exists"),
-                tr("Please choose existing file and retry import."));
-            return;
-        }
-
-        //
-        // Покажем уведомление пользователю
-        //
-        QLightBoxProgress progress(m_importDialog->parentWidget());
-        progress.showProgress(tr("Import"), tr("Please wait. Import can take few minutes."));
-
-        //
-        // Импортируем
-        //
-        const bool isImportSucceed = importScenario(_scenario, _cursorPosition, importParameters);
-
-        //
-        // Если импорт не удался, уведомим об этом пользователя
-        //
-        if (!isImportSucceed) {
-            QLightBoxMessage::critical(m_importDialog->parentWidget(), tr("Import aborted"),
-                tr("File to import is empty. Please check that you select correct file and retry import."));
-        }
-
-        //
-        // Закроем уведомление
-        //
-        progress.finish();
+    if (m_progress != nullptr) {
+        m_progress->finish();
+        m_progress->deleteLater();
+        m_progress = nullptr;
     }
 }
 
@@ -425,5 +573,9 @@ void ImportManager::initView()
 
 void ImportManager::initConnections()
 {
-
+    connect(this, &ImportManager::importProgressChanged, this, [this] (int _importId, int _progress) {
+        if (_importId == m_importId && isImporting()) {
+            QLightBoxProgress::setProgressText(tr("Import"), tr("Reading file... %1%").arg(_progress));
+        }
+    }, Qt::QueuedConnection);
 }
@@ -1,7 +1,12 @@
 #ifndef IMPORTMANAGER_H
 #define IMPORTMANAGER_H
 
+#include <QAtomicInt>
 #include <QObject>
+#include <QSharedPointer>
+#include <QVariantMap>
+
+class QLightBoxProgress;
 
 namespace BusinessLogic {
     class ScenarioDocument;
@@ -28,13 +33,64 @@ namespace ManagementLayer
         /**
          * @brief Импортировать сценарий
          */
-        /** @{ */
         bool importScenario(BusinessLogic::ScenarioDocument* _scenario, int _cursorPosition,
             const BusinessLogic::ImportParameters& _importParameters);
+
+        /**
+         * @brief Начать импорт сценария в фоне
+         * @note Файл читается в отдельном потоке (кроме форматов, импортёры которых нельзя запускать в фоне),
+         *       а в сценарий результат вставляется одним изменением по завершении,
+         *       о чём сообщает сигнал importFinished
+         */
+        /** @{ */
         void importScenario(BusinessLogic::ScenarioDocument* _scenario, const QString& _importFilePath);
-        void importScenario(BusinessLogic::ScenarioDocument* _scenario, int _cursorPosition);
+        /** @return Был ли запущен импорт */
+        bool importScenario(BusinessLogic::ScenarioDocument* _scenario, int _cursorPosition);
         /** @} */
 
+        /**
+         * @brief Выполняется ли сейчас импорт
+         */
+        bool isImporting() const;
+
+        /**
+         * @brief Прервать текущий импорт, сценарий при этом не изменяется
+         * @note Чтение документов останавливается, не дожидаясь окончания разбора файла
+         */
+        void cancelImport();
+
+    signals:
+        /**
+         * @brief Фоновый импорт завершён
+         * @param _isImported - был ли сценарий импортирован, или импорт не удался, или был прерван
+         */
+        void importFinished(bool _isImported);
+
+        /**
+         * @brief Изменился прогресс чтения импортируемого файла
+         * @note Испускается из потока, в котором читается файл
+         */
+        void importProgressChanged(int _importId, int _progress);
+
+    private:
+        /**
+         * @brief Запустить чтение импортируемого файла в фоне
+         */
+        void startImport(BusinessLogic::ScenarioDocument* _scenario, int _cursorPosition,
+            const BusinessLogic::ImportParameters& _importParameters, bool _notifyIfFailed);
+
+        /**
+         * @brief Загрузить прочитанные из файла данные в сценарий и разработку
+         */
+        bool applyImport(BusinessLogic::ScenarioDocument* _scenario, int _cursorPosition,
+            const BusinessLogic::ImportParameters& _importParameters, const QString& _scenarioXml,
+            const QVariantMap& _research);
+
+        /**
+         * @brief Скрыть уведомление о ходе импорта
+         */
+        void hideProgress();
+
     private:
         /**
          * @brief Настроить представление
@@ -51,6 +107,21 @@ namespace ManagementLayer
          * @brief Диалог экспорта
          */
         UserInterface::ImportDialog* m_importDialog;
+
+        /**
+         * @brief Уведомление о ходе фонового импорта
+         */
+        QLightBoxProgress* m_progress = nullptr;
+
+        /**
+         * @brief Идентификатор текущего импорта, результаты прерванных импортов отбрасываются
+         */
+        int m_importId = 0;
+
+        /**
+         * @brief Флаг прерывания текущего импорта, проверяется читателями документов в фоновом потоке
+         */
+        QSharedPointer<QAtomicInt> m_importCanceled;
     };
 }
 
@@ -87,6 +87,11 @@ void ResearchManager::loadCurrentProject()
     //
     m_model->load(StorageFacade::researchStorage()->all());
 
+    //
+    // Запомним положение загруженных элементов, чтобы при сохранении писать только изменения
+    //
+    updateSavedResearchPositions();
+
     //
     // Откроем первый элемент на редактирование
     //
@@ -109,6 +114,7 @@ void ResearchManager::loadScenarioData()
     m_scenarioData.insert(ScenarioData::YEAR_KEY, StorageFacade::scenarioDataStorage()->year());
     m_scenarioData.insert(ScenarioData::LOGLINE_KEY, StorageFacade::scenarioDataStorage()->logline());
     m_scenarioData.insert(ScenarioData::SYNOPSIS_KEY, StorageFacade::scenarioDataStorage()->synopsis());
+    m_changedScenarioDataKeys.clear();
 
     if (m_view->currentResearchIndex().isValid()) {
         editResearch(m_view->currentResearchIndex());
@@ -134,6 +140,9 @@ void ResearchManager::loadCurrentProjectSettings(const QString& _projectPath)
 void ResearchManager::closeCurrentProject()
 {
     m_scenarioData.clear();
+    m_changedScenarioDataKeys.clear();
+    m_savedResearchPositions.clear();
+    m_changedResearch.clear();
     m_model->clear();
     m_view->clear();
 }
@@ -223,32 +232,72 @@ void ResearchManager::updateSettings()
 
 void ResearchManager::saveResearch()
 {
+    m_lastSaveRowsCount = 0;
+
+    //
+    // Сохраняем изменённые данные сценария
     //
-    // Сохраняем данные сценария
-    //
-    if (!m_scenarioData.isEmpty()) {
-        StorageFacade::scenarioDataStorage()->setName(m_scenarioData.value(ScenarioData::NAME_KEY));
-        StorageFacade::scenarioDataStorage()->setHeader(m_scenarioData.value(ScenarioData::HEADER_KEY));
-        StorageFacade::scenarioDataStorage()->setFooter(m_scenarioData.value(ScenarioData::FOOTER_KEY));
-        StorageFacade::scenarioDataStorage()->setSceneNumbersPrefix(m_scenarioData.value(ScenarioData::SCENE_NUMBERS_PREFIX_KEY));
-        StorageFacade::scenarioDataStorage()->setSceneStartNumber(m_scenarioData.value(ScenarioData::SCENE_START_NUMBER_KEY));
-        StorageFacade::scenarioDataStorage()->setAdditionalInfo(m_scenarioData.value(ScenarioData::ADDITIONAL_INFO_KEY));
-        StorageFacade::scenarioDataStorage()->setGenre(m_scenarioData.value(ScenarioData::GENRE_KEY));
-        StorageFacade::scenarioDataStorage()->setAuthor(m_scenarioData.value(ScenarioData::AUTHOR_KEY));
-        StorageFacade::scenarioDataStorage()->setContacts(m_scenarioData.value(ScenarioData::CONTACTS_KEY));
-        StorageFacade::scenarioDataStorage()->setYear(m_scenarioData.value(ScenarioData::YEAR_KEY));
-        StorageFacade::scenarioDataStorage()->setLogline(m_scenarioData.value(ScenarioData::LOGLINE_KEY));
-        StorageFacade::scenarioDataStorage()->setSynopsis(m_scenarioData.value(ScenarioData::SYNOPSIS_KEY));
+    foreach (const QString& key, m_changedScenarioDataKeys) {
+        const QString value = m_scenarioData.value(key);
+        if (key == ScenarioData::NAME_KEY) {
+            StorageFacade::scenarioDataStorage()->setName(value);
+        } else if (key == ScenarioData::HEADER_KEY) {
+            StorageFacade::scenarioDataStorage()->setHeader(value);
+        } else if (key == ScenarioData::FOOTER_KEY) {
+            StorageFacade::scenarioDataStorage()->setFooter(value);
+        } else if (key == ScenarioData::SCENE_NUMBERS_PREFIX_KEY) {
+            StorageFacade::scenarioDataStorage()->setSceneNumbersPrefix(value);
+        } else if (key == ScenarioData::SCENE_START_NUMBER_KEY) {
+            StorageFacade::scenarioDataStorage()->setSceneStartNumber(value);
+        } else if (key == ScenarioData::ADDITIONAL_INFO_KEY) {
+            StorageFacade::scenarioDataStorage()->setAdditionalInfo(value);
+        } else if (key == ScenarioData::GENRE_KEY) {
+            StorageFacade::scenarioDataStorage()->setGenre(value);
+        } else if (key == ScenarioData::AUTHOR_KEY) {
+            StorageFacade::scenarioDataStorage()->setAuthor(value);
+        } else if (key == ScenarioData::CONTACTS_KEY) {
+            StorageFacade::scenarioDataStorage()->setContacts(value);
+        } else if (key == ScenarioData::YEAR_KEY) {
+            StorageFacade::scenarioDataStorage()->setYear(value);
+        } else if (key == ScenarioData::LOGLINE_KEY) {
+            StorageFacade::scenarioDataStorage()->setLogline(value);
+        } else if (key == ScenarioData::SYNOPSIS_KEY) {
+            StorageFacade::scenarioDataStorage()->setSynopsis(value);
+        } else {
+            continue;
+        }
+        ++m_lastSaveRowsCount;
     }
+    m_changedScenarioDataKeys.clear();
 
     //
-    // Сохраняем элементы разработки
+    // Сохраняем элементы разработки, которые изменились с момента предыдущего сохранения:
+    // содержимое помечается в обработчиках редактирования, а перемещения в модели
+    // определяются сравнением родителя и порядка сортировки
     //
+    QHash<Domain::Research*, QPair<Domain::Research*, int>> savedResearchPositions;
     foreach (Domain::DomainObject* researchObject,
              DataStorageLayer::StorageFacade::researchStorage()->all()->toList()) {
         Domain::Research* research = dynamic_cast<Domain::Research*>(researchObject);
-        DataStorageLayer::StorageFacade::researchStorage()->updateResearch(research);
+        const QPair<Domain::Research*, int> position(research->parent(), research->sortOrder());
+        if (m_changedResearch.contains(research)
+            || !m_savedResearchPositions.contains(research)
+            || m_savedResearchPositions.value(research) != position) {
+            DataStorageLayer::StorageFacade::researchStorage()->updateResearch(research);
+            ++m_lastSaveRowsCount;
+        }
+        savedResearchPositions.insert(research, position);
     }
+    //
+    // ... запоминаем только существующие элементы, чтобы не держать удалённые
+    //
+    m_savedResearchPositions = savedResearchPositions;
+    m_changedResearch.clear();
+}
+
+int ResearchManager::lastSaveRowsCount() const
+{
+    return m_lastSaveRowsCount;
 }
 
 void ResearchManager::setCommentOnly(bool _isCommentOnly)
@@ -591,6 +640,8 @@ void ResearchManager::removeResearchItem(BusinessLogic::ResearchModelItem* _item
     //
     // Удалим
     //
+    m_savedResearchPositions.remove(_item->research());
+    m_changedResearch.remove(_item->research());
     DataStorageLayer::StorageFacade::researchStorage()->removeResearch(_item->research());
 }
 
@@ -698,9 +749,11 @@ void ResearchManager::showNavigatorContextMenu(const QModelIndex& _index, const
             refreshResearchSubtree(_index);
         } else if (toggledAction == removeColorAction) {
             researchItem->research()->setColor(QColor());
+            markResearchChanged(researchItem->research());
         } else {
             if (colorsPane->currentColor().isValid()) {
                 researchItem->research()->setColor(colorsPane->currentColor());
+                markResearchChanged(researchItem->research());
             }
         }
     }
@@ -715,10 +768,29 @@ void ResearchManager::updateScenarioData(const QString& _key, const QString& _va
         && m_scenarioData.contains(_key)
         && m_scenarioData.value(_key) != _value) {
         m_scenarioData.insert(_key, _value);
+        m_changedScenarioDataKeys.insert(_key);
         emit researchChanged();
     }
 }
 
+void ResearchManager::markResearchChanged(Domain::Research* _research)
+{
+    if (_research != nullptr) {
+        m_changedResearch.insert(_research);
+    }
+}
+
+void ResearchManager::updateSavedResearchPositions()
+{
+    m_savedResearchPositions.clear();
+    m_changedResearch.clear();
+    foreach (Domain::DomainObject* researchObject,
+             DataStorageLayer::StorageFacade::researchStorage()->all()->toList()) {
+        Domain::Research* research = dynamic_cast<Domain::Research*>(researchObject);
+        m_savedResearchPositions.insert(research, qMakePair(research->parent(), research->sortOrder()));
+    }
+}
+
 void ResearchManager::initView()
 {
     m_view->setResearchModel(m_model);
@@ -799,6 +871,7 @@ void ResearchManager::initConnections()
                                                                _index.sibling(mappedVersionIndex, _index.column())));
             scriptText = scriptVersion->scriptText();
         } else {
+            emit currentScriptTextRequested();
             scriptText = DataStorageLayer::StorageFacade::scenarioStorage()->current()->text();
         }
 
@@ -836,6 +909,7 @@ void ResearchManager::initConnections()
             if (StorageFacade::researchStorage()->hasCharacter(_name)) {
                 Research* mainCharacter = StorageFacade::researchStorage()->character(_name);
                 mainCharacter->addDescription(m_currentResearch->description());
+                markResearchChanged(mainCharacter);
                 removeResearchItem(m_currentResearchItem);
             }
             //
@@ -843,6 +917,7 @@ void ResearchManager::initConnections()
             //
             else {
                 m_currentResearch->setName(newName);
+                markResearchChanged(m_currentResearch);
                 m_model->updateItem(m_model->itemForIndex(m_view->currentResearchIndex()));
             }
             emit researchChanged();
@@ -854,6 +929,7 @@ void ResearchManager::initConnections()
             && m_currentResearch->type() == Research::Character) {
             auto* researchCharacter = dynamic_cast<ResearchCharacter*>(m_currentResearch);
             researchCharacter->setRealName(_name);
+            markResearchChanged(researchCharacter);
             emit researchChanged();
         }
     });
@@ -862,6 +938,7 @@ void ResearchManager::initConnections()
             && m_currentResearch->type() == Research::Character) {
             auto* researchCharacter = dynamic_cast<ResearchCharacter*>(m_currentResearch);
             researchCharacter->setDescriptionText(_description);
+            markResearchChanged(researchCharacter);
             emit researchChanged();
         }
     });
@@ -880,6 +957,7 @@ void ResearchManager::initConnections()
             if (StorageFacade::researchStorage()->hasLocation(_name)) {
                 Research* mainLocation = StorageFacade::researchStorage()->location(_name);
                 mainLocation->addDescription(m_currentResearch->description());
+                markResearchChanged(mainLocation);
                 removeResearchItem(m_currentResearchItem);
             }
             //
@@ -887,6 +965,7 @@ void ResearchManager::initConnections()
             //
             else {
                 m_currentResearch->setName(newName);
+                markResearchChanged(m_currentResearch);
                 m_model->updateItem(m_model->itemForIndex(m_view->currentResearchIndex()));
             }
             emit researchChanged();
@@ -898,6 +977,7 @@ void ResearchManager::initConnections()
             && m_currentResearch->type() == Research::Location
             && m_currentResearch->description() != _description) {
             m_currentResearch->setDescription(_description);
+            markResearchChanged(m_currentResearch);
             emit researchChanged();
         }
     });
@@ -910,6 +990,7 @@ void ResearchManager::initConnections()
                 || m_currentResearch->type() == Research::Text)
             && m_currentResearch->name() != _name) {
             m_currentResearch->setName(_name);
+            markResearchChanged(m_currentResearch);
             m_model->updateItem(m_model->itemForIndex(m_view->currentResearchIndex()));
             emit researchChanged();
         }
@@ -920,6 +1001,7 @@ void ResearchManager::initConnections()
                 || m_currentResearch->type() == Research::Text)
             && m_currentResearch->description() != _description) {
             m_currentResearch->setDescription(_description);
+            markResearchChanged(m_currentResearch);
             emit researchChanged();
         }
     });
@@ -931,6 +1013,7 @@ void ResearchManager::initConnections()
             && m_currentResearch->type() == Research::Url
             && m_currentResearch->name() != _name) {
             m_currentResearch->setName(_name);
+            markResearchChanged(m_currentResearch);
             m_model->updateItem(m_model->itemForIndex(m_view->currentResearchIndex()));
             emit researchChanged();
         }
@@ -940,6 +1023,7 @@ void ResearchManager::initConnections()
             && m_currentResearch->type() == Research::Url
             && m_currentResearch->url() != _urlLink) {
             m_currentResearch->setUrl(_urlLink);
+            markResearchChanged(m_currentResearch);
             m_model->updateItem(m_model->itemForIndex(m_view->currentResearchIndex()));
             emit researchChanged();
         }
@@ -949,6 +1033,7 @@ void ResearchManager::initConnections()
             && m_currentResearch->type() == Research::Url
             && m_currentResearch->description() != _html) {
             m_currentResearch->setDescription(_html);
+            markResearchChanged(m_currentResearch);
             emit researchChanged();
         }
     });
@@ -960,6 +1045,7 @@ void ResearchManager::initConnections()
             && m_currentResearch->type() == Research::ImagesGallery
             && m_currentResearch->name() != _name) {
             m_currentResearch->setName(_name);
+            markResearchChanged(m_currentResearch);
             m_model->updateItem(m_model->itemForIndex(m_view->currentResearchIndex()));
             emit researchChanged();
         }
@@ -974,6 +1060,7 @@ void ResearchManager::initConnections()
                 StorageFacade::researchStorage()->storeResearch(
                     m_currentResearch, Research::Image, _sortOrder, tr("Unnamed image"));
             newResearch->setImage(_image);
+            markResearchChanged(newResearch);
 
             emit researchChanged();
         }
@@ -989,6 +1076,8 @@ void ResearchManager::initConnections()
             //
             // ... удалим
             //
+            m_savedResearchPositions.remove(researchToDelete);
+            m_changedResearch.remove(researchToDelete);
             DataStorageLayer::StorageFacade::researchStorage()->removeResearch(researchToDelete);
 
             //
@@ -1008,6 +1097,7 @@ void ResearchManager::initConnections()
             && m_currentResearch->type() == Research::Image
             && m_currentResearch->name() != _name) {
             m_currentResearch->setName(_name);
+            markResearchChanged(m_currentResearch);
             m_model->updateItem(m_model->itemForIndex(m_view->currentResearchIndex()));
             emit researchChanged();
         }
@@ -1016,6 +1106,7 @@ void ResearchManager::initConnections()
         if (m_currentResearch != nullptr
             && m_currentResearch->type() == Research::Image) {
             m_currentResearch->setImage(_image);
+            markResearchChanged(m_currentResearch);
             emit researchChanged();
         }
     });
@@ -1027,6 +1118,7 @@ void ResearchManager::initConnections()
             && m_currentResearch->type() == Research::MindMap
             && m_currentResearch->name() != _name) {
             m_currentResearch->setName(_name);
+            markResearchChanged(m_currentResearch);
             m_model->updateItem(m_model->itemForIndex(m_view->currentResearchIndex()));
             emit researchChanged();
         }
@@ -1035,6 +1127,7 @@ void ResearchManager::initConnections()
         if (m_currentResearch != nullptr
             && m_currentResearch->type() == Research::MindMap) {
             m_currentResearch->setDescription(_xml);
+            markResearchChanged(m_currentResearch);
             emit researchChanged();
         }
     });
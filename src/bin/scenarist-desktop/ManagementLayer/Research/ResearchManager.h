@@ -1,8 +1,11 @@
 #ifndef RESEARCHMANAGER_H
 #define RESEARCHMANAGER_H
 
+#include <QHash>
 #include <QObject>
 #include <QMap>
+#include <QPair>
+#include <QSet>
 
 class QAbstractItemModel;
 
@@ -76,9 +79,15 @@ namespace ManagementLayer
 
         /**
          * @brief Сохранить разработки проекта
+         * @note Сохраняются только данные изменённые с момента предыдущего сохранения
          */
         void saveResearch();
 
+        /**
+         * @brief Количество строк записанных в базу данных при последнем сохранении разработки
+         */
+        int lastSaveRowsCount() const;
+
         /**
          * @brief Установить режим работы со сценарием
          */
@@ -185,6 +194,11 @@ namespace ManagementLayer
          */
         void addScriptVersionRequested();
 
+        /**
+         * @brief Нужен актуальный текст текущего сценария из хранилища
+         */
+        void currentScriptTextRequested();
+
     private:
         /**
          * @brief Добавить разработку
@@ -219,6 +233,17 @@ namespace ManagementLayer
          */
         void updateScenarioData(const QString& _key, const QString& _value);
 
+        /**
+         * @brief Пометить элемент разработки, как требующий сохранения
+         * @note Вызывается во всех обработчиках, меняющих содержимое элемента
+         */
+        void markResearchChanged(Domain::Research* _research);
+
+        /**
+         * @brief Запомнить положение всех элементов разработки, как сохранённое
+         */
+        void updateSavedResearchPositions();
+
     private:
         /**
          * @brief Настроить представление
@@ -246,6 +271,26 @@ namespace ManagementLayer
          */
         QMap<QString, QString> m_scenarioData;
 
+        /**
+         * @brief Ключи данных сценария изменённые с момента последнего сохранения
+         */
+        QSet<QString> m_changedScenarioDataKeys;
+
+        /**
+         * @brief Родитель и порядок сортировки элементов разработки на момент последнего сохранения
+         */
+        QHash<Domain::Research*, QPair<Domain::Research*, int>> m_savedResearchPositions;
+
+        /**
+         * @brief Элементы разработки, содержимое которых изменилось с момента последнего сохранения
+         */
+        QSet<Domain::Research*> m_changedResearch;
+
+        /**
+         * @brief Количество строк записанных при последнем сохранении
+         */
+        int m_lastSaveRowsCount = 0;
+
         /**
          * @brief Модель данных о разработке
          */
@@ -22,6 +22,12 @@
 #include <QPrinter>
 #include <QPrintPreviewDialog>
 #include <QScopedPointer>
+#include <QPair>
+#include <QSet>
+#include <QVector>
+#include <QXmlStreamReader>
+
+#include <algorithm>
 
 using ManagementLayer::ScenarioCardsManager;
 using UserInterface::PrintCardsDialog;
@@ -30,6 +36,37 @@ using UserInterface::ScenarioItemDialog;
 
 namespace {
     const bool IS_SCRIPT = false;
+
+    /**
+     * @brief Элементы схемы, соответствующие элементам модели
+     */
+    /** @{ */
+    const QString kCardElement = "card";
+    const QString kActElement = "act";
+    /** @} */
+
+    /**
+     * @brief Заголовок карточки элемента
+     */
+    static QString cardTitle(const BusinessLogic::ScenarioModelItem* _item) {
+        return TextEditHelper::smartToUpper(_item->name().isEmpty() ? _item->header() : _item->name());
+    }
+
+    /**
+     * @brief Описание карточки элемента
+     */
+    static QString cardDescription(const BusinessLogic::ScenarioModelItem* _item) {
+        return _item->description().isEmpty() ? _item->fullText() : _item->description();
+    }
+
+    /**
+     * @brief Совпадает ли сохранённое в схеме значение атрибута с заданным
+     * @note Если атрибута нет, считаем что значение изменилось
+     */
+    static bool isAttributeEqual(const QXmlStreamAttributes& _attributes, const QString& _name, const QString& _value) {
+        return _attributes.hasAttribute(_name)
+                && _attributes.value(_name) == _value;
+    }
 }
 
 
@@ -39,6 +76,9 @@ ScenarioCardsManager::ScenarioCardsManager(QObject* _parent, QWidget* _parentWid
     m_addItemDialog(new ScenarioItemDialog(_parentWidget)),
     m_printDialog(new PrintCardsDialog(_parentWidget))
 {
+    m_applyChangesTimer.setSingleShot(true);
+    m_applyChangesTimer.setInterval(0);
+
     initConnections();
     reloadSettings();
 }
@@ -72,13 +112,18 @@ void ScenarioCardsManager::reloadSettings()
                 );
 }
 
-QString ScenarioCardsManager::save() const
+QString ScenarioCardsManager::save()
 {
+    //
+    // В схему должны попасть и изменения модели, которые ещё не применены к карточкам
+    //
+    applyPendingChanges();
     return m_view->save();
 }
 
 void ScenarioCardsManager::saveChanges(bool _hasChangesInText)
 {
+    applyPendingChanges();
     m_view->saveChanges(_hasChangesInText);
 }
 
@@ -89,57 +134,21 @@ void ScenarioCardsManager::load(BusinessLogic::ScenarioModel* _model, const QStr
     //
     if (m_model != _model) {
         m_model = _model;
+        //
+        // Изменения модели не применяются к карточкам сразу, а накапливаются до следующего прохода
+        // цикла событий, т.к. при вставке и импорте текста модель испускает сигналы на каждую строку
+        //
         connect(m_model, &BusinessLogic::ScenarioModel::rowsInserted, this, [this] (const QModelIndex& _parent, int _first, int _last) {
             //
             // Пробегаем каждый добавленный элемент
             //
             for (int row = _first; row <= _last; ++row) {
                 const QModelIndex index = m_model->index(row, 0, _parent);
-                BusinessLogic::ScenarioModelItem* item = m_model->itemForIndex(index);
-
-                //
-                // ... пропускаем сцены если их уровень вложенности больше второго
-                //
-                if (item->hasParent()
-                    && item->parent()->hasParent()
-                    && item->parent()->parent()->hasParent()) {
-                    continue;
-                }
-
-                //
-                // ... определим предыдущий элемент
-                //
-                QModelIndex currentCardIndex = _parent;
-                if (row > 0) {
-                    //
-                    // -1 т.к. нужен предыдущий элемент
-                    //
-                    const int itemRow = row - 1;
-                    if (_parent.isValid()) {
-                        currentCardIndex = _parent.child(itemRow, 0);
-                    } else {
-                        currentCardIndex = m_model->index(itemRow, 0);
-                    }
-                }
-                BusinessLogic::ScenarioModelItem* currentCard = m_model->itemForIndex(currentCardIndex);
-
-                //
-                // ... вставляем
-                //
-                const bool isEmbedded =
-                        item->hasParent()
-                        && item->parent()->type() != BusinessLogic::ScenarioModelItem::Scenario;
-                m_view->insertCard(
-                    item->uuid(),
-                    item->type() == BusinessLogic::ScenarioModelItem::Folder,
-                    item->sceneNumber(),
-                    item->name().isEmpty() ? TextEditHelper::smartToUpper(item->header()) : TextEditHelper::smartToUpper(item->name()),
-                    item->description().isEmpty() ? item->fullText() : item->description(),
-                    item->stamp(),
-                    item->colors(),
-                    isEmbedded,
-                    currentCard->uuid());
+                const QString uuid = m_model->itemForIndex(index)->uuid();
+                m_pendingUpdatedCards.remove(uuid);
+                m_pendingInsertedCards.insert(uuid, index);
             }
+            m_applyChangesTimer.start();
         });
         connect(m_model, &BusinessLogic::ScenarioModel::rowsAboutToBeRemoved, this, [this] (const QModelIndex& _parent, int _first, int _last) {
             for (int row = _last; row >= _first; --row) {
@@ -150,34 +159,46 @@ void ScenarioCardsManager::load(BusinessLogic::ScenarioModel* _model, const QStr
                     currentCardIndex = m_model->index(row, 0);
                 }
                 BusinessLogic::ScenarioModelItem* currentCard = m_model->itemForIndex(currentCardIndex);
-                m_view->removeCard(currentCard->uuid());
+                m_pendingUpdatedCards.remove(currentCard->uuid());
+                //
+                // ... если удаляется элемент, добавленный в этой же пачке, то его карточки ещё нет
+                //     в представлении, поэтому просто отменяем вставку
+                //
+                const auto insertedCard = m_pendingInsertedCards.find(currentCard->uuid());
+                if (insertedCard != m_pendingInsertedCards.end()
+                    && insertedCard.value() == currentCardIndex) {
+                    m_pendingInsertedCards.erase(insertedCard);
+                    continue;
+                }
+                //
+                // ... в остальных случаях карточку удаляем, т.к. элемент мог быть перемещён
+                //     и его карточка уже есть в представлении
+                //
+                m_pendingInsertedCards.remove(currentCard->uuid());
+                m_pendingRemovedCards.append(currentCard->uuid());
             }
+            m_applyChangesTimer.start();
         });
         connect(m_model, &BusinessLogic::ScenarioModel::dataChanged, this, [this] (const QModelIndex& _topLeft, const QModelIndex& _bottomRight) {
             for (int row = _topLeft.row(); row <= _bottomRight.row(); ++row) {
                 const QModelIndex index = m_model->index(row, 0, _topLeft.parent());
-                const BusinessLogic::ScenarioModelItem* item = m_model->itemForIndex(index);
-                const bool isAct =
-                        item->type() == BusinessLogic::ScenarioModelItem::Folder
-                        && item->hasParent()
-                        && item->parent()->type() == BusinessLogic::ScenarioModelItem::Scenario;
-                const bool isEmbedded =
-                        item->hasParent()
-                        && item->parent()->type() != BusinessLogic::ScenarioModelItem::Scenario;
-                m_view->updateCard(
-                    item->uuid(),
-                    item->type() == BusinessLogic::ScenarioModelItem::Folder,
-                    item->sceneNumber(),
-                    item->name().isEmpty() ? TextEditHelper::smartToUpper(item->header()) : TextEditHelper::smartToUpper(item->name()),
-                    item->description().isEmpty() ? item->fullText() : item->description(),
-                    item->stamp(),
-                    item->colors(),
-                    isEmbedded,
-                    isAct);
+                const QString uuid = m_model->itemForIndex(index)->uuid();
+                //
+                // ... новые карточки и так будут добавлены с актуальными данными
+                //
+                if (!m_pendingInsertedCards.contains(uuid)) {
+                    m_pendingUpdatedCards.insert(uuid, index);
+                }
             }
+            m_applyChangesTimer.start();
         });
     }
 
+    //
+    // Накопленные изменения относятся к предыдущей схеме
+    //
+    clearPendingChanges();
+
     //
     // Загрузим сценарий
     //
@@ -194,22 +215,176 @@ void ScenarioCardsManager::load(BusinessLogic::ScenarioModel* _model, const QStr
     }
 }
 
+void ScenarioCardsManager::reconcile()
+{
+    if (m_model == nullptr) {
+        return;
+    }
+
+    applyPendingChanges();
+
+    //
+    // Собираем карточки, которые есть в загруженной схеме, в порядке их следования,
+    // вместе с сохранёнными в схеме данными, чтобы не обновлять карточки, которые не изменились
+    //
+    QStringList schemeUuids;
+    QHash<QString, QXmlStreamAttributes> schemeCards;
+    {
+        QXmlStreamReader reader(m_view->save());
+        while (!reader.atEnd()) {
+            reader.readNext();
+            if (reader.isStartElement()
+                && (reader.name() == kCardElement || reader.name() == kActElement)
+                && reader.attributes().hasAttribute("id")) {
+                const QString uuid = reader.attributes().value("id").toString();
+                schemeUuids.append(uuid);
+                schemeCards.insert(uuid, reader.attributes());
+            }
+        }
+
+        //
+        // ... если схему прочитать не удалось, то остаётся только построить её заново
+        //
+        if (reader.hasError()) {
+            m_view->load(m_model->simpleScheme());
+            return;
+        }
+    }
+
+    //
+    // Собираем элементы модели, для которых должны быть карточки, в порядке их следования в сценарии
+    //
+    QVector<QModelIndex> modelIndexes;
+    QVector<int> modelLevels;
+    QHash<QString, int> modelPositions;
+    {
+        QVector<QPair<QModelIndex, int>> parents { { QModelIndex(), 0 } };
+        while (!parents.isEmpty()) {
+            const QPair<QModelIndex, int> parent = parents.takeLast();
+            //
+            // ... дочерние элементы добавляем в обратном порядке, чтобы обойти дерево сверху вниз
+            //
+            for (int row = m_model->rowCount(parent.first) - 1; row >= 0; --row) {
+                const QModelIndex index = m_model->index(row, 0, parent.first);
+                if (isCardIndex(index)) {
+                    parents.append({ index, parent.second + 1 });
+                }
+            }
+            if (parent.first.isValid()) {
+                modelPositions.insert(m_model->itemForIndex(parent.first)->uuid(), modelIndexes.size());
+                modelIndexes.append(parent.first);
+                modelLevels.append(parent.second);
+            }
+        }
+    }
+
+    //
+    // Карточки, которые сохранили свой порядок относительно друг друга, остаются на своих местах,
+    // а это наибольшая возрастающая подпоследовательность позиций в модели, взятых в порядке схемы
+    //
+    QVector<int> commonPositions;
+    QSet<QString> schemeUuidsSet;
+    for (const QString& uuid : schemeUuids) {
+        schemeUuidsSet.insert(uuid);
+        if (modelPositions.contains(uuid)) {
+            commonPositions.append(modelPositions.value(uuid));
+        }
+    }
+    QSet<int> stablePositions;
+    {
+        QVector<int> tails;
+        QVector<int> tailsIndexes;
+        QVector<int> previousIndexes(commonPositions.size(), -1);
+        for (int index = 0; index < commonPositions.size(); ++index) {
+            const int position = commonPositions.at(index);
+            const int length = int(std::lower_bound(tails.begin(), tails.end(), position) - tails.begin());
+            if (length == tails.size()) {
+                tails.append(position);
+                tailsIndexes.append(index);
+            } else {
+                tails[length] = position;
+                tailsIndexes[length] = index;
+            }
+            if (length > 0) {
+                previousIndexes[index] = tailsIndexes.at(length - 1);
+            }
+        }
+        for (int index = tailsIndexes.isEmpty() ? -1 : tailsIndexes.last();
+             index != -1;
+             index = previousIndexes.at(index)) {
+            stablePositions.insert(commonPositions.at(index));
+        }
+    }
+    //
+    // ... вложенные карточки перемещённой папки переносятся вместе с ней, поэтому их тоже нужно
+    //     вставить заново, элементы дерева обходились сверху вниз, так что они идут сразу за папкой
+    //
+    for (int position = 0; position < modelIndexes.size(); ++position) {
+        if (stablePositions.contains(position)) {
+            continue;
+        }
+
+        const int level = modelLevels.at(position);
+        while (position + 1 < modelIndexes.size()
+               && modelLevels.at(position + 1) > level) {
+            stablePositions.remove(++position);
+        }
+    }
+
+    bool hasChanges = false;
+
+    //
+    // Удаляем карточки, элементов которых больше нет в модели, либо которые были перемещены
+    //
+    for (int index = schemeUuids.size() - 1; index >= 0; --index) {
+        const QString& uuid = schemeUuids.at(index);
+        if (!modelPositions.contains(uuid)
+            || !stablePositions.contains(modelPositions.value(uuid))) {
+            m_view->removeCard(uuid);
+            hasChanges = true;
+        }
+    }
+
+    //
+    // Добавляем недостающие и перемещённые карточки, а остальные обновляем, если они изменились
+    //
+    for (int position = 0; position < modelIndexes.size(); ++position) {
+        const QModelIndex& index = modelIndexes.at(position);
+        if (stablePositions.contains(position)) {
+            const BusinessLogic::ScenarioModelItem* item = m_model->itemForIndex(index);
+            if (!isCardEqual(schemeCards.value(item->uuid()), index)) {
+                updateCardForIndex(index);
+            }
+        } else {
+            insertCardForIndex(index);
+            hasChanges = true;
+        }
+    }
+
+    if (hasChanges) {
+        m_view->saveChanges(true);
+    }
+}
+
 void ScenarioCardsManager::clear()
 {
     if (m_model != nullptr) {
         m_model->disconnect(this);
         m_model = nullptr;
     }
+    clearPendingChanges();
     m_view->clear();
 }
 
 void ScenarioCardsManager::undo()
 {
+    applyPendingChanges();
     m_view->undo();
 }
 
 void ScenarioCardsManager::redo()
 {
+    applyPendingChanges();
     m_view->redo();
 }
 
@@ -242,6 +417,7 @@ void ScenarioCardsManager::addCard()
         //
         // Определим карточку, после которой нужно добавить элемент
         //
+        applyPendingChanges();
         QModelIndex index;
         const QString lastItemUuid = m_view->beforeNewItemUuid();
         if (!lastItemUuid.isEmpty()) {
@@ -693,8 +869,172 @@ void ScenarioCardsManager::printCards(QPrinter* _printer)
     m_printDialog->setEnabled(true);
 }
 
+bool ScenarioCardsManager::isCardIndex(const QModelIndex& _index) const
+{
+    //
+    // Карточки есть только у элементов не глубже второго уровня вложенности
+    //
+    const BusinessLogic::ScenarioModelItem* item = m_model->itemForIndex(_index);
+    return !(item->hasParent()
+             && item->parent()->hasParent()
+             && item->parent()->parent()->hasParent());
+}
+
+void ScenarioCardsManager::insertCardForIndex(const QModelIndex& _index)
+{
+    BusinessLogic::ScenarioModelItem* item = m_model->itemForIndex(_index);
+
+    //
+    // ... пропускаем сцены если их уровень вложенности больше второго
+    //
+    if (!isCardIndex(_index)) {
+        return;
+    }
+
+    //
+    // ... определим предыдущий элемент
+    //
+    QModelIndex currentCardIndex = _index.parent();
+    if (_index.row() > 0) {
+        //
+        // -1 т.к. нужен предыдущий элемент
+        //
+        const int itemRow = _index.row() - 1;
+        if (_index.parent().isValid()) {
+            currentCardIndex = _index.parent().child(itemRow, 0);
+        } else {
+            currentCardIndex = m_model->index(itemRow, 0);
+        }
+    }
+    BusinessLogic::ScenarioModelItem* currentCard = m_model->itemForIndex(currentCardIndex);
+
+    //
+    // ... вставляем
+    //
+    const bool isEmbedded =
+            item->hasParent()
+            && item->parent()->type() != BusinessLogic::ScenarioModelItem::Scenario;
+    m_view->insertCard(
+        item->uuid(),
+        item->type() == BusinessLogic::ScenarioModelItem::Folder,
+        item->sceneNumber(),
+        cardTitle(item),
+        cardDescription(item),
+        item->stamp(),
+        item->colors(),
+        isEmbedded,
+        currentCard->uuid());
+}
+
+void ScenarioCardsManager::updateCardForIndex(const QModelIndex& _index)
+{
+    const BusinessLogic::ScenarioModelItem* item = m_model->itemForIndex(_index);
+    const bool isAct =
+            item->type() == BusinessLogic::ScenarioModelItem::Folder
+            && item->hasParent()
+            && item->parent()->type() == BusinessLogic::ScenarioModelItem::Scenario;
+    const bool isEmbedded =
+            item->hasParent()
+            && item->parent()->type() != BusinessLogic::ScenarioModelItem::Scenario;
+    m_view->updateCard(
+        item->uuid(),
+        item->type() == BusinessLogic::ScenarioModelItem::Folder,
+        item->sceneNumber(),
+        cardTitle(item),
+        cardDescription(item),
+        item->stamp(),
+        item->colors(),
+        isEmbedded,
+        isAct);
+}
+
+bool ScenarioCardsManager::isCardEqual(const QXmlStreamAttributes& _card, const QModelIndex& _index) const
+{
+    if (_card.isEmpty()) {
+        return false;
+    }
+
+    //
+    // Сравниваем только содержимое, которое передаётся в карточку, положение карточки не важно,
+    // смена типа или вложенности элемента меняет порядок карточек, поэтому обрабатывается при вставке
+    //
+    const BusinessLogic::ScenarioModelItem* item = m_model->itemForIndex(_index);
+    return isAttributeEqual(_card, "title", cardTitle(item))
+            && isAttributeEqual(_card, "description", cardDescription(item))
+            && isAttributeEqual(_card, "colors", item->colors())
+            && (item->type() == BusinessLogic::ScenarioModelItem::Folder
+                || (isAttributeEqual(_card, "number", item->sceneNumber())
+                    && isAttributeEqual(_card, "stamp", item->stamp())));
+}
+
+void ScenarioCardsManager::applyPendingChanges()
+{
+    m_applyChangesTimer.stop();
+
+    if (m_model == nullptr) {
+        clearPendingChanges();
+        return;
+    }
+
+    //
+    // Сначала удаляем карточки, чтобы перемещённые элементы вставились уже на новое место
+    //
+    for (const QString& uuid : m_pendingRemovedCards) {
+        m_view->removeCard(uuid);
+    }
+
+    //
+    // Добавляем новые карточки в порядке следования элементов в сценарии, чтобы к моменту
+    // вставки каждой карточки предыдущая уже была в представлении
+    //
+    QVector<QPair<QVector<int>, QModelIndex>> insertedIndexes;
+    insertedIndexes.reserve(m_pendingInsertedCards.size());
+    for (const QPersistentModelIndex& persistentIndex : m_pendingInsertedCards) {
+        //
+        // ... элементы, которые были удалены вместе с родителем, пропускаем
+        //
+        if (!persistentIndex.isValid()) {
+            continue;
+        }
+
+        QVector<int> path;
+        for (QModelIndex index = persistentIndex; index.isValid(); index = index.parent()) {
+            path.prepend(index.row());
+        }
+        insertedIndexes.append({ path, persistentIndex });
+    }
+    std::sort(insertedIndexes.begin(), insertedIndexes.end(),
+              [] (const QPair<QVector<int>, QModelIndex>& _lhs, const QPair<QVector<int>, QModelIndex>& _rhs) {
+        return _lhs.first < _rhs.first;
+    });
+    for (const auto& insertedIndex : insertedIndexes) {
+        insertCardForIndex(insertedIndex.second);
+    }
+
+    //
+    // Обновляем изменённые карточки, каждую не более одного раза
+    //
+    for (const QPersistentModelIndex& persistentIndex : m_pendingUpdatedCards) {
+        if (persistentIndex.isValid()) {
+            updateCardForIndex(persistentIndex);
+        }
+    }
+
+    clearPendingChanges();
+}
+
+void ScenarioCardsManager::clearPendingChanges()
+{
+    m_applyChangesTimer.stop();
+    m_pendingRemovedCards.clear();
+    m_pendingInsertedCards.clear();
+    m_pendingUpdatedCards.clear();
+}
+
 void ScenarioCardsManager::initConnections()
 {
+    connect(&m_applyChangesTimer, &QTimer::timeout, this, &ScenarioCardsManager::applyPendingChanges);
+
     //
     // Если не удалось загрузить сохранённую схему, построим её заново
     //
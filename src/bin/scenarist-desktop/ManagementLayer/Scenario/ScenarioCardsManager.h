@@ -1,10 +1,14 @@
 #ifndef SCENARIOCARDSMANAGER_H
 #define SCENARIOCARDSMANAGER_H
 
+#include <QHash>
 #include <QModelIndexList>
 #include <QObject>
+#include <QPersistentModelIndex>
+#include <QTimer>
 
 class QPrinter;
+class QXmlStreamAttributes;
 
 namespace BusinessLogic {
     class ScenarioModel;
@@ -41,8 +45,9 @@ namespace ManagementLayer
 
         /**
          * @brief Сохранить схему сценария
+         * @note Перед сохранением применяются накопленные изменения модели
          */
-        QString save() const;
+        QString save();
 
         /**
          * @brief Сохранить изменения схемы
@@ -54,6 +59,13 @@ namespace ManagementLayer
          */
         void load(BusinessLogic::ScenarioModel* _model, const QString& _xml);
 
+        /**
+         * @brief Привести загруженную схему в соответствие с моделью сценария
+         * @note Добавляются и удаляются только карточки, которые отличаются от модели,
+         *       остальные сохраняют положение, заданное пользователем
+         */
+        void reconcile();
+
         /**
          * @brief Очистить данные схемы и модель
          */
@@ -183,6 +195,38 @@ namespace ManagementLayer
         /** @} */
 
     private:
+        /**
+         * @brief Есть ли у элемента модели карточка
+         */
+        bool isCardIndex(const QModelIndex& _index) const;
+
+        /**
+         * @brief Добавить карточку для элемента модели
+         */
+        void insertCardForIndex(const QModelIndex& _index);
+
+        /**
+         * @brief Обновить карточку элемента модели
+         */
+        void updateCardForIndex(const QModelIndex& _index);
+
+        /**
+         * @brief Совпадают ли данные карточки из схемы с данными элемента модели
+         */
+        bool isCardEqual(const QXmlStreamAttributes& _card, const QModelIndex& _index) const;
+
+        /**
+         * @brief Применить к представлению накопленные изменения модели
+         * @note Изменения модели применяются пачкой один раз за проход цикла событий,
+         *       чтобы при вставке или импорте большого текста не перестраивать карточки на каждую строку
+         */
+        void applyPendingChanges();
+
+        /**
+         * @brief Отбросить накопленные изменения модели
+         */
+        void clearPendingChanges();
+
         /**
          * @brief Настроить соединения
          */
@@ -208,6 +252,26 @@ namespace ManagementLayer
          * @brief Модель сценария
          */
         BusinessLogic::ScenarioModel* m_model = nullptr;
+
+        /**
+         * @brief Таймер применения накопленных изменений модели
+         */
+        QTimer m_applyChangesTimer;
+
+        /**
+         * @brief Идентификаторы карточек, которые нужно удалить, в порядке удаления
+         */
+        QStringList m_pendingRemovedCards;
+
+        /**
+         * @brief Элементы модели, для которых нужно добавить карточки
+         */
+        QHash<QString, QPersistentModelIndex> m_pendingInsertedCards;
+
+        /**
+         * @brief Элементы модели, карточки которых нужно обновить
+         */
+        QHash<QString, QPersistentModelIndex> m_pendingUpdatedCards;
     };
 }
 
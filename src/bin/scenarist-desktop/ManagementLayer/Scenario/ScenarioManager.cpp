@@ -30,6 +30,8 @@
 #include <DataLayer/DataStorageLayer/ResearchStorage.h>
 #include <DataLayer/DataStorageLayer/SettingsStorage.h>
 
+#include <ManagementLayer/Project/ProjectsManager.h>
+
 #include <3rd_party/Helpers/DiffMatchPatchHelper.h>
 #include <3rd_party/Helpers/RunOnce.h>
 #include <3rd_party/Helpers/ShortcutHelper.h>
@@ -77,6 +79,40 @@ namespace {
     const int FAST_SAVE_CHANGES_INTERVAL = 1000;
     /** @} */
 
+    /**
+     * @brief Задержки обновления счётчиков и хронометража после изменения текста и перемещения курсора, мс
+     * @note Пока пользователь печатает, или листает текст, они не пересчитываются
+     */
+    /** @{ */
+    const int kUpdateCountersInterval = 500;
+    const int kUpdateDurationInterval = 150;
+    /** @} */
+
+    /**
+     * @brief Количество изменений текста, после которого в базу пишется полный снимок сценария
+     * @note Формат хранения сценария в проекте: столбец text таблицы scenario содержит последний
+     *       снимок текста, а сделанные после него изменения хранятся только в виде патчей
+     *       в таблице scenario_changes. Последнее вошедшее в снимок изменение отмечается в настройках
+     *       сценария (см. ключи ниже). Полный снимок пишется каждые kSnapshotChangesLimit изменений,
+     *       при изменении схемы карточек, при каждом сохранении проектов из облака, перед созданием
+     *       резервной копии и при закрытии проекта, поэтому закрытые проекты и резервные копии
+     *       можно читать и старыми версиями программы
+     */
+    const int kSnapshotChangesLimit = 100;
+
+    /**
+     * @brief Ключи для хранения последнего изменения, вошедшего в снимок текста сценария
+     */
+    /** @{ */
+    const QString kSnapshotChangeDatetimeKey = "script-snapshot-change-datetime";
+    const QString kSnapshotChangeUuidKey = "script-snapshot-change-uuid";
+    /** @} */
+
+    /**
+     * @brief Формат даты изменения сценария
+     */
+    const QString kChangeDatetimeFormat = "yyyy-MM-dd hh:mm:ss:zzz";
+
     /**
      * @brief Индексы дополнительных панелей в навигаторе
      */
@@ -331,6 +367,10 @@ void ScenarioManager::loadCurrentProject()
     Domain::Scenario* currentScenarioDraft =
             DataStorageLayer::StorageFacade::scenarioStorage()->current(IS_DRAFT);
     m_scenarioDraft->load(currentScenarioDraft);
+    //
+    // ... и накатим изменения, сохранённые после последнего снимка текста
+    //
+    replayChangesAfterSnapshot();
 
     //
     // Установим данные для менеджеров
@@ -349,15 +389,19 @@ void ScenarioManager::loadCurrentProject()
     //
     // Обновим счётчики, когда данные полностью загрузятся
     //
+    m_fullDuration = -1;
     QTimer::singleShot(100, this, &ScenarioManager::aboutUpdateCounters);
+
+    m_hasUnsavedChanges = false;
 }
 
 void ScenarioManager::rebuildCardsFromScript()
 {
     //
-    // Передаём пустую строку вместо схемы, чтобы карточки построились из текста сценария
+    // Схема уже загружена вместе с проектом, поэтому лишь приводим её в соответствие с текстом сценария,
+    // сохраняя расположение карточек, которые не изменились
     //
-    m_cardsManager->load(m_scenario->model(), QString());
+    m_cardsManager->reconcile();
 }
 
 void ScenarioManager::startChangesHandling()
@@ -394,23 +438,54 @@ void ScenarioManager::loadCurrentProjectSettings(const QString& _projectPath)
 void ScenarioManager::saveCurrentProject()
 {
     //
-    // Сохраняем сценарий
+    // Сохраняем изменения текста в виде патчей
     //
-    m_scenario->scenario()->setText(m_scenario->save());
-    m_scenario->scenario()->setScheme(m_cardsManager->save());
-    DataStorageLayer::StorageFacade::scenarioStorage()->storeScenario(m_scenario->scenario());
+    aboutSaveScenarioChanges();
+    DataStorageLayer::StorageFacade::scenarioChangeStorage()->store();
 
     //
-    // Сохраняем черновик
+    // Схему обновляем в памяти сразу, а текст сценария только при сохранении снимка, т.к. сериализация
+    // большого сценария долгая, те кому нужен актуальный текст вызывают updateCurrentScriptText()
     //
-    m_scenarioDraft->scenario()->setText(m_scenarioDraft->save());
-    DataStorageLayer::StorageFacade::scenarioStorage()->storeScenario(m_scenarioDraft->scenario());
+    const QString scriptScheme = m_cardsManager->save();
+    const bool isSchemeChanged = m_scenario->scenario()->scheme() != scriptScheme;
+    m_scenario->scenario()->setScheme(scriptScheme);
 
     //
-    // Сохраняем изменения
+    // А в базу полный текст сценария пишем только периодически, т.к. для больших сценариев
+    // это долго, в остальное время текст восстанавливается из снимка и сохранённых после него патчей.
+    // Изменения проектов из облака могут приходить не по порядку, поэтому для них снимок
+    // сохраняется каждый раз
     //
-    aboutSaveScenarioChanges();
-    DataStorageLayer::StorageFacade::scenarioChangeStorage()->store();
+    if (isSchemeChanged
+        || m_scriptChangesAfterSnapshot + m_draftChangesAfterSnapshot >= kSnapshotChangesLimit
+        || ProjectsManager::currentProject().isRemote()) {
+        saveScriptSnapshot();
+    }
+
+    m_hasUnsavedChanges = false;
+}
+
+void ScenarioManager::compactCurrentProject()
+{
+    //
+    // Снимок делаем только если все изменения уже сохранены, чтобы не записать в него то,
+    // от сохранения чего пользователь отказался
+    //
+    if (m_hasUnsavedChanges
+        || m_scriptChangesAfterSnapshot + m_draftChangesAfterSnapshot == 0) {
+        return;
+    }
+
+    DatabaseLayer::Database::transaction();
+    saveScriptSnapshot();
+    DatabaseLayer::Database::commit();
+}
+
+void ScenarioManager::updateCurrentScriptText()
+{
+    m_scenario->scenario()->setText(m_scenario->save());
+    m_scenarioDraft->scenario()->setText(m_scenarioDraft->save());
 }
 
 void ScenarioManager::saveCurrentProjectSettings(const QString& _projectPath)
@@ -438,6 +513,9 @@ void ScenarioManager::closeCurrentProject()
     // Остановим таймер сохранения изменений документа
     //
     m_saveChangesTimer.stop();
+    m_updateCountersTimer.stop();
+    m_updateDurationTimer.stop();
+    m_fullDuration = -1;
 
     //
     // Очистим от предыдущих данных
@@ -917,6 +995,8 @@ void ScenarioManager::aboutRedo()
 
 void ScenarioManager::aboutRefreshDuration(int _cursorPosition)
 {
+    m_updateDurationTimer.stop();
+    m_fullDuration = -1;
     if (BusinessLogic::ChronometerFacade::chronometryUsed()) {
         workingScenario()->refresh();
     }
@@ -927,10 +1007,17 @@ void ScenarioManager::aboutUpdateDuration(int _cursorPosition)
 {
     QString duration;
     if (BusinessLogic::ChronometerFacade::chronometryUsed()) {
+        //
+        // Полный хронометраж меняется только вместе с текстом, поэтому при перемещении курсора
+        // используем ранее посчитанное значение
+        //
+        if (m_fullDuration < 0) {
+            m_fullDuration = workingScenario()->fullDuration();
+        }
         QString durationToCursor =
                 BusinessLogic::ChronometerFacade::secondsToTime(workingScenario()->durationAtPosition(_cursorPosition));
         QString durationToEnd =
-                BusinessLogic::ChronometerFacade::secondsToTime(workingScenario()->fullDuration());
+                BusinessLogic::ChronometerFacade::secondsToTime(m_fullDuration);
         duration = QString("%1: <b>%2 | %3</b>").arg(tr("Chron.")).arg(durationToCursor).arg(durationToEnd);
     }
 
@@ -939,6 +1026,7 @@ void ScenarioManager::aboutUpdateDuration(int _cursorPosition)
 
 void ScenarioManager::aboutRefreshCounters()
 {
+    m_updateCountersTimer.stop();
     workingScenario()->refresh();
     aboutUpdateCounters();
 }
@@ -1146,6 +1234,7 @@ void ScenarioManager::aboutSaveScenarioChanges()
     Domain::ScenarioChange* change = m_scenario->document()->saveChanges();
     if (change != nullptr) {
         change->setIsDraft(false);
+        ++m_scriptChangesAfterSnapshot;
     }
     //
     // ... и черновика
@@ -1153,6 +1242,7 @@ void ScenarioManager::aboutSaveScenarioChanges()
     Domain::ScenarioChange* changeDraft = m_scenarioDraft->document()->saveChanges();
     if (changeDraft != nullptr) {
         changeDraft->setIsDraft(true);
+        ++m_draftChangesAfterSnapshot;
     }
 
     //
@@ -1184,6 +1274,11 @@ void ScenarioManager::initData()
     m_draftNavigatorManager->setNavigationModel(m_scenarioDraft->model());
     m_scriptBookmarksManager->setBookmarksModel(m_scenario->document()->bookmarksModel());
     m_textEditManager->setScenarioDocument(m_scenario->document());
+
+    m_updateCountersTimer.setSingleShot(true);
+    m_updateCountersTimer.setInterval(kUpdateCountersInterval);
+    m_updateDurationTimer.setSingleShot(true);
+    m_updateDurationTimer.setInterval(kUpdateDurationInterval);
 }
 
 void ScenarioManager::initView()
@@ -1299,9 +1394,18 @@ void ScenarioManager::initConnections()
     connect(m_scriptBookmarksManager, &ScriptBookmarksManager::bookmarkSelected, m_textEditManager, &ScenarioTextEditManager::setCursorPosition);
 
     connect(m_textEditManager, &ScenarioTextEditManager::textModeChanged, this, &ScenarioManager::aboutRefreshCounters);
-    connect(m_textEditManager, &ScenarioTextEditManager::cursorPositionChanged, this, &ScenarioManager::aboutUpdateDuration);
-    connect(m_textEditManager, &ScenarioTextEditManager::textChanged, [this] { aboutUpdateDuration(m_textEditManager->cursorPosition()); });
-    connect(m_textEditManager, &ScenarioTextEditManager::textChanged, this, &ScenarioManager::aboutUpdateCounters);
+    //
+    // Счётчики и хронометраж пересчитываются по всему тексту, поэтому обновляем их не на каждое нажатие клавиши,
+    // а когда пользователь остановится
+    //
+    connect(m_textEditManager, &ScenarioTextEditManager::cursorPositionChanged, &m_updateDurationTimer, static_cast<void (QTimer::*)()>(&QTimer::start));
+    connect(m_textEditManager, &ScenarioTextEditManager::textChanged, this, [this] {
+        m_fullDuration = -1;
+        m_updateDurationTimer.start();
+        m_updateCountersTimer.start();
+    });
+    connect(&m_updateDurationTimer, &QTimer::timeout, this, [this] { aboutUpdateDuration(m_textEditManager->cursorPosition()); });
+    connect(&m_updateCountersTimer, &QTimer::timeout, this, &ScenarioManager::aboutUpdateCounters);
     connect(m_textEditManager, &ScenarioTextEditManager::cursorPositionChanged, this, &ScenarioManager::aboutUpdateCurrentSceneTitleAndDescription);
     connect(m_textEditManager, &ScenarioTextEditManager::cursorPositionChanged, this, &ScenarioManager::aboutSelectItemInNavigator, Qt::QueuedConnection);
     connect(m_textEditManager, &ScenarioTextEditManager::cursorPositionChanged, m_scriptBookmarksManager, static_cast<void (ScriptBookmarksManager::*)(int)>(&ScriptBookmarksManager::selectBookmark), Qt::QueuedConnection);
@@ -1333,6 +1437,7 @@ void ScenarioManager::initConnections()
     connect(m_sceneDescriptionManager, &ScenarioSceneDescriptionManager::titleChanged, this, &ScenarioManager::scenarioChanged);
     connect(m_sceneDescriptionManager, &ScenarioSceneDescriptionManager::descriptionChanged, this, &ScenarioManager::scenarioChanged);
     connect(m_textEditManager, &ScenarioTextEditManager::textChanged, this, &ScenarioManager::scenarioChanged);
+    connect(this, &ScenarioManager::scenarioChanged, this, [this] { m_hasUnsavedChanges = true; });
 }
 
 void ScenarioManager::initStyleSheet()
@@ -1372,6 +1477,12 @@ void ScenarioManager::setWorkingMode(QObject* _sender)
             m_textEditManager->setAdditionalCursors(additionalCursors);
             prevNavigatorManager->clearSelection();
 
+            //
+            // ... посчитанный хронометраж относится к предыдущему документу
+            //
+            m_fullDuration = -1;
+            m_updateDurationTimer.start();
+
             emit scenarioChanged();
         }
     }
@@ -1381,3 +1492,105 @@ BusinessLogic::ScenarioDocument* ScenarioManager::workingScenario() const
 {
     return m_workModeIsDraft ? m_scenarioDraft : m_scenario;
 }
+
+void ScenarioManager::saveScriptSnapshot()
+{
+    //
+    // Сохраняем текст сценария, строку сценария пишем всегда, т.к. в ней хранится и схема карточек
+    //
+    m_scenario->scenario()->setText(m_scenario->save());
+    DataStorageLayer::StorageFacade::scenarioStorage()->storeScenario(m_scenario->scenario());
+
+    //
+    // ... и черновика, если он изменялся
+    //
+    if (m_draftChangesAfterSnapshot > 0) {
+        m_scenarioDraft->scenario()->setText(m_scenarioDraft->save());
+        DataStorageLayer::StorageFacade::scenarioStorage()->storeScenario(m_scenarioDraft->scenario());
+    }
+
+    storeScriptSnapshotMarker();
+
+    m_scriptChangesAfterSnapshot = 0;
+    m_draftChangesAfterSnapshot = 0;
+}
+
+void ScenarioManager::storeScriptSnapshotMarker()
+{
+    //
+    // Запоминаем последнее изменение вошедшее в снимок, если изменений ещё нет,
+    // то все последующие будут сделаны позже текущего момента (даты изменений хранятся в UTC)
+    //
+    QString snapshotChangeDatetime = QDateTime::currentDateTimeUtc().toString(kChangeDatetimeFormat);
+    QString snapshotChangeUuid;
+    if (const Domain::ScenarioChange* lastChange
+            = DataStorageLayer::StorageFacade::scenarioChangeStorage()->last()) {
+        snapshotChangeDatetime = lastChange->datetime().toString(kChangeDatetimeFormat);
+        snapshotChangeUuid = lastChange->uuid().toString();
+    }
+    DataStorageLayer::StorageFacade::settingsStorage()->setValue(
+                kSnapshotChangeDatetimeKey, snapshotChangeDatetime,
+                DataStorageLayer::SettingsStorage::ScenarioSettings);
+    DataStorageLayer::StorageFacade::settingsStorage()->setValue(
+                kSnapshotChangeUuidKey, snapshotChangeUuid,
+                DataStorageLayer::SettingsStorage::ScenarioSettings);
+}
+
+void ScenarioManager::replayChangesAfterSnapshot()
+{
+    m_scriptChangesAfterSnapshot = 0;
+    m_draftChangesAfterSnapshot = 0;
+
+    //
+    // Если снимок ни разу не сохранялся, значит текст в базе полный, отмечаем его как снимок,
+    // чтобы патчи, сохранённые после него, были применены при следующей загрузке проекта
+    //
+    const QString snapshotChangeDatetime =
+            DataStorageLayer::StorageFacade::settingsStorage()->value(
+                kSnapshotChangeDatetimeKey,
+                DataStorageLayer::SettingsStorage::ScenarioSettings);
+    if (snapshotChangeDatetime.isEmpty()) {
+        storeScriptSnapshotMarker();
+        return;
+    }
+    const QString snapshotChangeUuid =
+            DataStorageLayer::StorageFacade::settingsStorage()->value(
+                kSnapshotChangeUuidKey,
+                DataStorageLayer::SettingsStorage::ScenarioSettings);
+
+    //
+    // Собираем патчи изменений сделанных после снимка
+    //
+    QList<QString> scriptPatches;
+    QList<QString> draftPatches;
+    for (const QString& changeUuid
+         : DataStorageLayer::StorageFacade::scenarioChangeStorage()->newUuids(snapshotChangeDatetime)) {
+        if (changeUuid == snapshotChangeUuid) {
+            continue;
+        }
+
+        const Domain::ScenarioChange* change =
+                DataStorageLayer::StorageFacade::scenarioChangeStorage()->change(changeUuid);
+        if (change == nullptr) {
+            continue;
+        }
+
+        if (change->isDraft()) {
+            draftPatches.append(change->redoPatch());
+            ++m_draftChangesAfterSnapshot;
+        } else {
+            scriptPatches.append(change->redoPatch());
+            ++m_scriptChangesAfterSnapshot;
+        }
+    }
+
+    //
+    // ... и накатываем их на загруженный снимок
+    //
+    if (!scriptPatches.isEmpty()) {
+        m_scenario->document()->applyPatches(scriptPatches);
+    }
+    if (!draftPatches.isEmpty()) {
+        m_scenarioDraft->document()->applyPatches(draftPatches);
+    }
+}
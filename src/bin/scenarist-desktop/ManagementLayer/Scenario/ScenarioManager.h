@@ -71,7 +71,7 @@ namespace ManagementLayer
         void loadCurrentProject();
 
         /**
-         * @brief Сформировать карточки из сценария
+         * @brief Обновить карточки в соответствии с текстом сценария
          */
         void rebuildCardsFromScript();
 
@@ -87,9 +87,25 @@ namespace ManagementLayer
 
         /**
          * @brief Сохранить данные текущего проекта
+         * @note Полный текст сценария пишется в базу только периодически, в остальное время
+         *       сохраняются лишь накопленные патчи изменений
          */
         void saveCurrentProject();
 
+        /**
+         * @brief Сохранить полный снимок текста сценария, если после него были сохранены изменения
+         * @note Используется перед созданием резервной копии и при закрытии проекта, чтобы эти файлы
+         *       всегда оставались в полном виде
+         */
+        void compactCurrentProject();
+
+        /**
+         * @brief Обновить текст сценария и черновика в хранилище данных, не записывая их в базу
+         * @note Между снимками текст в хранилище не обновляется, поэтому его нужно актуализировать
+         *       перед тем, как читать из хранилища
+         */
+        void updateCurrentScriptText();
+
         /**
          * @brief Сохранить настройки текущего проекта
          */
@@ -262,6 +278,8 @@ namespace ManagementLayer
 
         /**
          * @brief Обновить хронометраж
+         * @note Хронометраж сцен и счётчики считает ScenarioDocument из библиотеки ядра, здесь обновления
+         *       лишь откладываются до паузы в наборе текста, а полный хронометраж кэшируется до изменения текста
          */
         /** @{ */
         void aboutRefreshDuration(int _cursorPosition);
@@ -414,6 +432,21 @@ namespace ManagementLayer
          */
         BusinessLogic::ScenarioDocument* workingScenario() const;
 
+        /**
+         * @brief Сохранить полный снимок текста сценария и черновика
+         */
+        void saveScriptSnapshot();
+
+        /**
+         * @brief Запомнить последнее изменение, вошедшее в снимок текста
+         */
+        void storeScriptSnapshotMarker();
+
+        /**
+         * @brief Применить изменения сохранённые после последнего снимка текста
+         */
+        void replayChangesAfterSnapshot();
+
     private:
         /**
          * @brief Представление сценария
@@ -513,6 +546,32 @@ namespace ManagementLayer
          * @brief Таймер для сохранения изменений сценария
          */
         QTimer m_saveChangesTimer;
+
+        /**
+         * @brief Таймеры отложенного обновления счётчиков и хронометража
+         */
+        /** @{ */
+        QTimer m_updateCountersTimer;
+        QTimer m_updateDurationTimer;
+        /** @} */
+
+        /**
+         * @brief Полный хронометраж текущего документа, или -1, если его нужно пересчитать
+         */
+        int m_fullDuration = -1;
+
+        /**
+         * @brief Количество изменений текста сделанных после последнего снимка
+         */
+        /** @{ */
+        int m_scriptChangesAfterSnapshot = 0;
+        int m_draftChangesAfterSnapshot = 0;
+        /** @} */
+
+        /**
+         * @brief Есть ли в проекте изменения, которые ещё не были сохранены
+         */
+        bool m_hasUnsavedChanges = false;
     };
 }
 
@@ -1,4 +1,5 @@
 #include "ScenarioTextEditManager.h"
+#include "ScriptSpellingIndex.h"
 
 #include <BusinessLayer/ScenarioDocument/ScenarioDocument.h>
 #include <BusinessLayer/ScenarioDocument/ScenarioModelItem.h>
@@ -12,7 +13,10 @@
 
 #include <UserInterfaceLayer/Scenario/ScenarioTextEdit/ScenarioTextEditWidget.h>
 
+#include <QShortcut>
+
 using ManagementLayer::ScenarioTextEditManager;
+using ManagementLayer::ScriptSpellingIndex;
 using BusinessLogic::ScenarioDocument;
 using UserInterface::ScenarioTextEditWidget;
 
@@ -33,7 +37,8 @@ namespace {
 
 ScenarioTextEditManager::ScenarioTextEditManager(QObject* _parent, QWidget* _parentWidget) :
     QObject(_parent),
-    m_view(new ScenarioTextEditWidget(_parentWidget))
+    m_view(new ScenarioTextEditWidget(_parentWidget)),
+    m_spellingIndex(new ScriptSpellingIndex(this))
 {
     initView();
     initConnections();
@@ -54,6 +59,7 @@ void ScenarioTextEditManager::setScenarioDocument(BusinessLogic::ScenarioTextDoc
 {
     if (m_view->scenarioDocument() != _document) {
         m_view->setScenarioDocument(_document, _isDraft);
+        m_spellingIndex->setDocument(_document);
         reloadTextEditSettings();
     }
 }
@@ -65,7 +71,8 @@ void ScenarioTextEditManager::setDuration(const QString& _duration)
 
 void ScenarioTextEditManager::setCountersInfo(const QStringList& _counters)
 {
-    m_view->setCountersInfo(_counters);
+    m_countersInfo = _counters;
+    updateCountersInfo();
 }
 
 void ScenarioTextEditManager::setCursorPosition(int _position)
@@ -117,16 +124,20 @@ void ScenarioTextEditManager::reloadTextEditSettings()
                     "scenario-editor/smart-quotes",
                     DataStorageLayer::SettingsStorage::ApplicationSettings)
                 .toInt());
-    m_view->setUseSpellChecker(
-                DataStorageLayer::StorageFacade::settingsStorage()->value(
-                    "scenario-editor/spell-checking",
-                    DataStorageLayer::SettingsStorage::ApplicationSettings)
-                .toInt());
-    m_view->setSpellCheckLanguage(
-                DataStorageLayer::StorageFacade::settingsStorage()->value(
-                    "scenario-editor/spell-checking-language",
-                    DataStorageLayer::SettingsStorage::ApplicationSettings)
-                .toInt());
+    const bool useSpellChecker =
+            DataStorageLayer::StorageFacade::settingsStorage()->value(
+                "scenario-editor/spell-checking",
+                DataStorageLayer::SettingsStorage::ApplicationSettings)
+            .toInt();
+    const int spellCheckLanguage =
+            DataStorageLayer::StorageFacade::settingsStorage()->value(
+                "scenario-editor/spell-checking-language",
+                DataStorageLayer::SettingsStorage::ApplicationSettings)
+            .toInt();
+    m_view->setUseSpellChecker(useSpellChecker);
+    m_view->setSpellCheckLanguage(spellCheckLanguage);
+    m_spellingIndex->setSpellChecking(useSpellChecker, spellCheckLanguage);
+    updateCountersInfo();
 
     //
     // Цветовая схема
@@ -294,9 +305,29 @@ void ScenarioTextEditManager::renameSceneNumber(const QString& _oldSceneNumber,
     }
 }
 
-void ScenarioTextEditManager::initView()
+void ScenarioTextEditManager::goToNextMisspelling()
 {
+    const int misspellingPosition = m_spellingIndex->nextMisspelling(m_view->cursorPosition());
+    if (misspellingPosition != -1) {
+        m_view->setCursorPosition(misspellingPosition);
+    }
+}
 
+void ScenarioTextEditManager::updateCountersInfo()
+{
+    QStringList counters = m_countersInfo;
+    if (m_spellingIndex->isEnabled()
+        && m_spellingIndex->misspellingsCount() > 0) {
+        counters.append(tr("Misspellings: %1").arg(m_spellingIndex->misspellingsCount()));
+    }
+    m_view->setCountersInfo(counters);
+}
+
+void ScenarioTextEditManager::initView()
+{
+    QShortcut* nextMisspellingShortcut = new QShortcut(QKeySequence("F7"), m_view);
+    nextMisspellingShortcut->setContext(Qt::WidgetWithChildrenShortcut);
+    connect(nextMisspellingShortcut, &QShortcut::activated, this, &ScenarioTextEditManager::goToNextMisspelling);
 }
 
 void ScenarioTextEditManager::initConnections()
@@ -311,4 +342,5 @@ void ScenarioTextEditManager::initConnections()
     connect(m_view, &ScenarioTextEditWidget::addBookmarkRequested, this, &ScenarioTextEditManager::addBookmarkRequested);
     connect(m_view, &ScenarioTextEditWidget::removeBookmarkRequested, this, &ScenarioTextEditManager::removeBookmarkRequested);
     connect(m_view, &ScenarioTextEditWidget::renameSceneNumberRequested, this, &ScenarioTextEditManager::renameSceneNumber);
+    connect(m_spellingIndex, &ScriptSpellingIndex::misspellingsCountChanged, this, &ScenarioTextEditManager::updateCountersInfo);
 }
@@ -2,6 +2,7 @@
 #define SCENARIOTEXTEDITMANAGER_H
 
 #include <QObject>
+#include <QStringList>
 
 class QMenu;
 class QTextCursor;
@@ -17,6 +18,8 @@ namespace BusinessLogic {
 
 namespace ManagementLayer
 {
+    class ScriptSpellingIndex;
+
     /**
      * @brief Управляющий редактированием сценария
      */
@@ -187,6 +190,16 @@ namespace ManagementLayer
          */
         void renameSceneNumber(const QString& _oldSceneNumber, int _position);
 
+        /**
+         * @brief Перейти к следующей ошибке правописания
+         */
+        void goToNextMisspelling();
+
+        /**
+         * @brief Обновить значения счётчиков, добавив к ним количество ошибок правописания
+         */
+        void updateCountersInfo();
+
     private:
         /**
          * @brief Настроить представление
@@ -203,6 +216,16 @@ namespace ManagementLayer
          * @brief Редактор
          */
         UserInterface::ScenarioTextEditWidget* m_view;
+
+        /**
+         * @brief Индекс ошибок правописания в редактируемом документе
+         */
+        ScriptSpellingIndex* m_spellingIndex;
+
+        /**
+         * @brief Значения счётчиков
+         */
+        QStringList m_countersInfo;
     };
 }
 
@@ -0,0 +1,468 @@
+#include "ScriptSpellingIndex.h"
+
+#include <3rd_party/Widgets/SpellCheckTextEdit/SpellChecker.h>
+
+#include <hunspell/spellservice.hxx>
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QFutureWatcher>
+#include <QStandardPaths>
+#include <QTextBlock>
+#include <QTextBoundaryFinder>
+#include <QTextCodec>
+#include <QTextDocument>
+#include <QTextStream>
+#include <QtConcurrentRun>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using ManagementLayer::ScriptSpellingIndex;
+
+namespace {
+    /**
+     * @brief Задержка запуска проверки после изменения текста
+     */
+    const int kCheckDelay = 500;
+
+    /**
+     * @brief Количество блоков, проверяемых за один запуск фоновой проверки
+     */
+    const int kBlocksPerCheck = 200;
+
+    /**
+     * @brief Файл пользовательского словаря, в который добавляет слова проверяющий редактора
+     */
+    const QString kUserDictionaryFileName = "UserDictionary.dict";
+
+    /**
+     * @brief Найти слова с ошибками в тексте блока
+     */
+    static QVector<ScriptSpellingIndex::Misspelling> findMisspellings(const QString& _text,
+        SpellService* _spellService, QTextCodec* _codec) {
+        //
+        // Собираем слова блока, не трогая слова с цифрами
+        //
+        QVector<ScriptSpellingIndex::Misspelling> words;
+        std::vector<std::string> encodedWords;
+        QTextBoundaryFinder finder(QTextBoundaryFinder::Word, _text);
+        int wordStart = -1;
+        for (int position = finder.position(); position != -1; position = finder.toNextBoundary()) {
+            const QTextBoundaryFinder::BoundaryReasons reasons = finder.boundaryReasons();
+            if (wordStart != -1 && reasons.testFlag(QTextBoundaryFinder::EndOfItem)) {
+                const QStringRef word = _text.midRef(wordStart, position - wordStart);
+                if (std::none_of(word.begin(), word.end(), [] (const QChar& _char) { return _char.isDigit(); })) {
+                    ScriptSpellingIndex::Misspelling misspelling;
+                    misspelling.position = wordStart;
+                    misspelling.length = word.length();
+                    words.append(misspelling);
+                    encodedWords.push_back(_codec->fromUnicode(word.toString()).toStdString());
+                }
+                wordStart = -1;
+            }
+            if (reasons.testFlag(QTextBoundaryFinder::StartOfItem)) {
+                wordStart = position;
+            }
+        }
+
+        //
+        // ... и проверяем их одним запросом
+        //
+        std::vector<char> verdicts;
+        _spellService->spell(encodedWords, verdicts);
+        QVector<ScriptSpellingIndex::Misspelling> misspellings;
+        for (int index = 0; index < words.size(); ++index) {
+            if (!verdicts[index]) {
+                misspellings.append(words.at(index));
+            }
+        }
+        return misspellings;
+    }
+}
+
+
+ScriptSpellingIndex::ScriptSpellingIndex(QObject* _parent) :
+    QObject(_parent)
+{
+    m_checkTimer.setSingleShot(true);
+    m_checkTimer.setInterval(kCheckDelay);
+    connect(&m_checkTimer, &QTimer::timeout, this, &ScriptSpellingIndex::checkDirtyBlocks);
+    connect(&m_userDictionaryWatcher, &QFileSystemWatcher::fileChanged,
+            this, &ScriptSpellingIndex::aboutUserDictionaryChanged);
+    connect(&m_userDictionaryWatcher, &QFileSystemWatcher::directoryChanged,
+            this, &ScriptSpellingIndex::aboutUserDictionaryChanged);
+}
+
+void ScriptSpellingIndex::setDocument(QTextDocument* _document)
+{
+    if (m_document == _document) {
+        return;
+    }
+
+    if (!m_document.isNull()) {
+        m_document->disconnect(this);
+    }
+
+    m_document = _document;
+
+    if (!m_document.isNull()) {
+        connect(m_document, &QTextDocument::contentsChange, this, &ScriptSpellingIndex::aboutContentsChange);
+    }
+
+    restart();
+}
+
+void ScriptSpellingIndex::setSpellChecking(bool _enabled, int _language)
+{
+    const QString hunspellDictionariesFolderPath =
+            QStandardPaths::writableLocation(QStandardPaths::DataLocation)
+            + QDir::separator() + "Hunspell" + QDir::separator();
+    const QString languageCode = SpellChecker::languageCode((SpellChecker::Language)_language);
+    const QString affPath = hunspellDictionariesFolderPath + languageCode + ".aff";
+    const QString dicPath = hunspellDictionariesFolderPath + languageCode + ".dic";
+
+    if (m_isEnabled == _enabled
+        && m_affPath == affPath
+        && m_dicPath == dicPath) {
+        //
+        // Словарь мог быть ещё не скачан в прошлый раз, пробуем проверить снова
+        //
+        if (m_isEnabled && m_spellService == nullptr) {
+            m_checkTimer.start();
+        }
+        return;
+    }
+
+    m_isEnabled = _enabled;
+    m_affPath = affPath;
+    m_dicPath = dicPath;
+    m_userDictionaryPath = hunspellDictionariesFolderPath + kUserDictionaryFileName;
+    m_spellService.reset();
+    m_codec = nullptr;
+    m_userWords.clear();
+    restart();
+}
+
+bool ScriptSpellingIndex::isEnabled() const
+{
+    return m_isEnabled;
+}
+
+int ScriptSpellingIndex::misspellingsCount() const
+{
+    return m_misspellings.size();
+}
+
+int ScriptSpellingIndex::nextMisspelling(int _position) const
+{
+    if (m_misspellings.isEmpty()) {
+        return -1;
+    }
+
+    auto next = std::upper_bound(m_misspellings.begin(), m_misspellings.end(), _position,
+                                 [] (int _value, const Misspelling& _misspelling) {
+        return _value < _misspelling.position;
+    });
+    if (next == m_misspellings.end()) {
+        next = m_misspellings.begin();
+    }
+    return next->position;
+}
+
+void ScriptSpellingIndex::aboutContentsChange(int _position, int _charsRemoved, int _charsAdded)
+{
+    ++m_revision;
+
+    if (!m_isEnabled) {
+        return;
+    }
+
+    //
+    // Убираем ошибки в изменённом тексте и сдвигаем последующие
+    //
+    const int changeEnd = _position + _charsRemoved;
+    const int delta = _charsAdded - _charsRemoved;
+    const int misspellingsCount = m_misspellings.size();
+    auto misspelling = m_misspellings.begin();
+    for (auto it = m_misspellings.begin(); it != m_misspellings.end(); ++it) {
+        if (it->position + it->length <= _position) {
+            *misspelling++ = *it;
+        } else if (it->position >= changeEnd) {
+            *misspelling = *it;
+            misspelling->position += delta;
+            ++misspelling;
+        }
+    }
+    m_misspellings.erase(misspelling, m_misspellings.end());
+
+    //
+    // ... так же сдвигаем ожидающие проверки блоки
+    //
+    auto shiftPosition = [_position, changeEnd, delta] (int& _value) {
+        if (_value >= changeEnd) {
+            _value += delta;
+        } else if (_value > _position) {
+            _value = _position;
+        }
+    };
+    std::for_each(m_dirtyPositions.begin(), m_dirtyPositions.end(), shiftPosition);
+    std::for_each(m_checkingPositions.begin(), m_checkingPositions.end(), shiftPosition);
+
+    markDirty(_position, _position + _charsAdded);
+
+    if (misspellingsCount != m_misspellings.size()) {
+        emit misspellingsCountChanged(m_misspellings.size());
+    }
+}
+
+void ScriptSpellingIndex::markDirty(int _from, int _to)
+{
+    if (m_document.isNull()) {
+        return;
+    }
+
+    for (QTextBlock block = m_document->findBlock(_from);
+         block.isValid() && block.position() <= _to;
+         block = block.next()) {
+        m_dirtyPositions.append(block.position());
+    }
+
+    m_checkTimer.start();
+}
+
+void ScriptSpellingIndex::checkDirtyBlocks()
+{
+    if (m_isChecking
+        || !m_isEnabled
+        || m_document.isNull()
+        || m_dirtyPositions.isEmpty()) {
+        return;
+    }
+
+    //
+    // Служба проверки создаётся в потоке интерфейса, чтобы словарь загружался один раз
+    //
+    if (m_spellService == nullptr
+        && !loadSpellService()) {
+        return;
+    }
+
+    //
+    // Берём копию текста очередной пачки блоков
+    //
+    std::sort(m_dirtyPositions.begin(), m_dirtyPositions.end());
+    QVector<CheckedBlock> blocks;
+    QStringList blocksTexts;
+    int dirtyIndex = 0;
+    for (; dirtyIndex < m_dirtyPositions.size() && blocks.size() < kBlocksPerCheck; ++dirtyIndex) {
+        const QTextBlock block = m_document->findBlock(m_dirtyPositions.at(dirtyIndex));
+        if (!block.isValid()
+            || (!blocks.isEmpty() && blocks.last().position == block.position())) {
+            continue;
+        }
+
+        CheckedBlock checkedBlock;
+        checkedBlock.position = block.position();
+        checkedBlock.length = block.length();
+        blocks.append(checkedBlock);
+        blocksTexts.append(block.text());
+        m_checkingPositions.append(block.position());
+    }
+    m_dirtyPositions.remove(0, dirtyIndex);
+    if (blocks.isEmpty()) {
+        return;
+    }
+
+    //
+    // ... и проверяем их в отдельном потоке
+    //
+    m_isChecking = true;
+    const int revision = m_revision;
+    const int restartsCount = m_restartsCount;
+    std::shared_ptr<SpellService> spellService = m_spellService;
+    QTextCodec* codec = m_codec;
+    QFutureWatcher<QVector<CheckedBlock>>* watcher = new QFutureWatcher<QVector<CheckedBlock>>(this);
+    connect(watcher, &QFutureWatcher<QVector<CheckedBlock>>::finished, this,
+            [this, watcher, revision, restartsCount] {
+        const QVector<CheckedBlock> checkedBlocks = watcher->result();
+        watcher->deleteLater();
+        m_isChecking = false;
+
+        //
+        // Если проверка была перезапущена, то результаты уже не нужны
+        //
+        if (restartsCount != m_restartsCount) {
+            checkDirtyBlocks();
+            return;
+        }
+
+        //
+        // Если словарь изменился с прошлой проверки, то проверяем весь документ заново
+        //
+        if (m_spellServiceGeneration != m_spellService->generation()) {
+            m_spellServiceGeneration = m_spellService->generation();
+            restart();
+            return;
+        }
+
+        //
+        // Применяем результаты, только если текст не изменился за время проверки,
+        // а иначе проверяем те же блоки ещё раз
+        //
+        if (revision == m_revision) {
+            applyCheckedBlocks(checkedBlocks);
+        } else {
+            m_dirtyPositions += m_checkingPositions;
+        }
+        m_checkingPositions.clear();
+
+        if (!m_checkTimer.isActive()) {
+            checkDirtyBlocks();
+        }
+    });
+
+    watcher->setFuture(QtConcurrent::run([spellService, codec, blocks, blocksTexts] {
+        QVector<CheckedBlock> checkedBlocks = blocks;
+        for (int index = 0; index < checkedBlocks.size(); ++index) {
+            checkedBlocks[index].misspellings =
+                    findMisspellings(blocksTexts.at(index), spellService.get(), codec);
+        }
+        return checkedBlocks;
+    }));
+}
+
+void ScriptSpellingIndex::applyCheckedBlocks(const QVector<CheckedBlock>& _blocks)
+{
+    const int misspellingsCount = m_misspellings.size();
+    for (const CheckedBlock& block : _blocks) {
+        //
+        // Заменяем ошибки блока на найденные
+        //
+        const int blockEnd = block.position + block.length;
+        auto blockBegin = std::lower_bound(m_misspellings.begin(), m_misspellings.end(), block.position,
+                                           [] (const Misspelling& _misspelling, int _position) {
+            return _misspelling.position < _position;
+        });
+        auto blockLast = blockBegin;
+        while (blockLast != m_misspellings.end() && blockLast->position < blockEnd) {
+            ++blockLast;
+        }
+        const int insertIndex = blockBegin - m_misspellings.begin();
+        m_misspellings.erase(blockBegin, blockLast);
+
+        QVector<Misspelling> misspellings = block.misspellings;
+        for (Misspelling& misspelling : misspellings) {
+            misspelling.position += block.position;
+        }
+        m_misspellings.insert(insertIndex, misspellings.size(), Misspelling());
+        std::copy(misspellings.begin(), misspellings.end(), m_misspellings.begin() + insertIndex);
+    }
+
+    if (misspellingsCount != m_misspellings.size()) {
+        emit misspellingsCountChanged(m_misspellings.size());
+    }
+}
+
+void ScriptSpellingIndex::restart()
+{
+    ++m_restartsCount;
+    m_dirtyPositions.clear();
+    m_checkingPositions.clear();
+
+    const int misspellingsCount = m_misspellings.size();
+    m_misspellings.clear();
+    if (misspellingsCount != 0) {
+        emit misspellingsCountChanged(0);
+    }
+
+    if (!m_isEnabled || m_document.isNull()) {
+        m_checkTimer.stop();
+        return;
+    }
+
+    for (QTextBlock block = m_document->begin(); block.isValid(); block = block.next()) {
+        m_dirtyPositions.append(block.position());
+    }
+    m_checkTimer.start();
+}
+
+bool ScriptSpellingIndex::loadSpellService()
+{
+    if (!QFile::exists(m_affPath)
+        || !QFile::exists(m_dicPath)) {
+        return false;
+    }
+
+    m_spellService = SpellService::instance(QFile::encodeName(m_affPath).constData(),
+                                            QFile::encodeName(m_dicPath).constData());
+    m_codec = QTextCodec::codecForName(QByteArray::fromStdString(m_spellService->get_dic_encoding()));
+    if (m_codec == nullptr) {
+        m_codec = QTextCodec::codecForName("UTF-8");
+    }
+
+    //
+    // Следим за пользовательским словарём, а также за его папкой, на случай,
+    // если файл словаря ещё не создан или будет перезаписан
+    //
+    const QString userDictionaryFolderPath = QFileInfo(m_userDictionaryPath).absolutePath();
+    if (!m_userDictionaryWatcher.directories().contains(userDictionaryFolderPath)) {
+        m_userDictionaryWatcher.addPath(userDictionaryFolderPath);
+    }
+    loadUserDictionary();
+    m_spellServiceGeneration = m_spellService->generation();
+    return true;
+}
+
+bool ScriptSpellingIndex::loadUserDictionary()
+{
+    if (m_spellService == nullptr) {
+        return false;
+    }
+
+    if (QFile::exists(m_userDictionaryPath)
+        && !m_userDictionaryWatcher.files().contains(m_userDictionaryPath)) {
+        m_userDictionaryWatcher.addPath(m_userDictionaryPath);
+    }
+
+    QFile userDictionary(m_userDictionaryPath);
+    if (!userDictionary.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    //
+    // Словарь только пополняется, поэтому добавляем лишь новые слова
+    //
+    bool isWordsAdded = false;
+    QTextStream stream(&userDictionary);
+    while (!stream.atEnd()) {
+        const QString word = stream.readLine().trimmed();
+        if (word.isEmpty()
+            || m_userWords.contains(word)) {
+            continue;
+        }
+
+        m_userWords.insert(word);
+        m_spellService->add(m_codec->fromUnicode(word).toStdString());
+        isWordsAdded = true;
+    }
+    return isWordsAdded;
+}
+
+void ScriptSpellingIndex::aboutUserDictionaryChanged()
+{
+    if (m_spellService == nullptr
+        || !loadUserDictionary()) {
+        return;
+    }
+
+    //
+    // Если идёт проверка, то документ будет перепроверен по её завершении
+    //
+    if (!m_isChecking) {
+        m_spellServiceGeneration = m_spellService->generation();
+        restart();
+    }
+}
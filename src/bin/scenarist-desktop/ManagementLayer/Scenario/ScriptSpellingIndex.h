@@ -0,0 +1,228 @@
+#ifndef SCRIPTSPELLINGINDEX_H
+#define SCRIPTSPELLINGINDEX_H
+
+#include <QFileSystemWatcher>
+#include <QObject>
+#include <QPointer>
+#include <QSet>
+#include <QTimer>
+#include <QVector>
+
+#include <memory>
+
+class QTextCodec;
+class QTextDocument;
+class SpellService;
+
+
+namespace ManagementLayer
+{
+    /**
+     * @brief Индекс ошибок правописания во всём документе
+     *
+     * Блоки документа проверяются пачками в фоновом потоке, в поток интерфейса
+     * возвращаются только найденные в проверенных блоках ошибки
+     *
+     * @note Служба проверки создаётся в потоке интерфейса. Проверяющий редактора
+     *       (SpellChecker из scenarist-core) загружает свой экземпляр словаря,
+     *       а слова, добавленные им в пользовательский словарь, подгружаются
+     *       в службу из файла этого словаря
+     */
+    class ScriptSpellingIndex : public QObject
+    {
+        Q_OBJECT
+
+    public:
+        /**
+         * @brief Ошибка правописания
+         */
+        struct Misspelling {
+            /**
+             * @brief Позиция слова в документе (в результатах проверки - в блоке)
+             */
+            int position = 0;
+
+            /**
+             * @brief Длина слова
+             */
+            int length = 0;
+        };
+
+        /**
+         * @brief Проверенный блок
+         */
+        struct CheckedBlock {
+            /**
+             * @brief Позиция и длина блока в документе на момент проверки
+             */
+            int position = 0;
+            int length = 0;
+
+            /**
+             * @brief Ошибки в блоке
+             */
+            QVector<Misspelling> misspellings;
+        };
+
+    public:
+        explicit ScriptSpellingIndex(QObject* _parent = nullptr);
+
+        /**
+         * @brief Установить проверяемый документ
+         */
+        void setDocument(QTextDocument* _document);
+
+        /**
+         * @brief Включить/выключить проверку и задать язык словаря
+         */
+        void setSpellChecking(bool _enabled, int _language);
+
+        /**
+         * @brief Включена ли проверка
+         */
+        bool isEnabled() const;
+
+        /**
+         * @brief Количество ошибок в документе
+         */
+        int misspellingsCount() const;
+
+        /**
+         * @brief Позиция первой ошибки после заданной позиции (по кругу), или -1, если ошибок нет
+         */
+        int nextMisspelling(int _position) const;
+
+    signals:
+        /**
+         * @brief Изменилось количество ошибок
+         */
+        void misspellingsCountChanged(int _count);
+
+    private:
+        /**
+         * @brief Сдвинуть индекс и отметить изменённые блоки для проверки
+         */
+        void aboutContentsChange(int _position, int _charsRemoved, int _charsAdded);
+
+        /**
+         * @brief Отметить для проверки блоки в заданном диапазоне
+         */
+        void markDirty(int _from, int _to);
+
+        /**
+         * @brief Запустить проверку очередной пачки блоков
+         */
+        void checkDirtyBlocks();
+
+        /**
+         * @brief Заменить ошибки проверенных блоков
+         */
+        void applyCheckedBlocks(const QVector<CheckedBlock>& _blocks);
+
+        /**
+         * @brief Очистить индекс и запланировать проверку всего документа
+         */
+        void restart();
+
+        /**
+         * @brief Загрузить службу проверки выбранного словаря, если словарь уже скачан
+         */
+        bool loadSpellService();
+
+        /**
+         * @brief Добавить в службу проверки новые слова пользовательского словаря
+         * @return Были ли добавлены слова
+         */
+        bool loadUserDictionary();
+
+        /**
+         * @brief Пользовательский словарь изменился, перепроверить документ с новыми словами
+         */
+        void aboutUserDictionaryChanged();
+
+    private:
+        /**
+         * @brief Проверяемый документ
+         */
+        QPointer<QTextDocument> m_document;
+
+        /**
+         * @brief Включена ли проверка
+         */
+        bool m_isEnabled = false;
+
+        /**
+         * @brief Пути к файлам словаря
+         */
+        QString m_affPath;
+        QString m_dicPath;
+
+        /**
+         * @brief Путь к пользовательскому словарю
+         */
+        QString m_userDictionaryPath;
+
+        /**
+         * @brief Слова пользовательского словаря, добавленные в службу проверки
+         */
+        QSet<QString> m_userWords;
+
+        /**
+         * @brief Наблюдатель за изменениями пользовательского словаря
+         */
+        QFileSystemWatcher m_userDictionaryWatcher;
+
+        /**
+         * @brief Общая для всего приложения служба проверки выбранного словаря
+         */
+        std::shared_ptr<SpellService> m_spellService;
+
+        /**
+         * @brief Кодировка словаря
+         */
+        QTextCodec* m_codec = nullptr;
+
+        /**
+         * @brief Поколение проверенных службой слов, с которым проверен индекс
+         *        (меняется при изменении словаря)
+         */
+        unsigned int m_spellServiceGeneration = 0;
+
+        /**
+         * @brief Ошибки, отсортированные по позиции
+         */
+        QVector<Misspelling> m_misspellings;
+
+        /**
+         * @brief Позиции в блоках, которые нужно проверить
+         */
+        QVector<int> m_dirtyPositions;
+
+        /**
+         * @brief Позиции блоков, проверяемых в данный момент
+         */
+        QVector<int> m_checkingPositions;
+
+        /**
+         * @brief Идёт ли проверка
+         */
+        bool m_isChecking = false;
+
+        /**
+         * @brief Ревизия текста, меняется при каждом изменении документа
+         */
+        int m_revision = 0;
+
+        /**
+         * @brief Номер перезапуска, результаты предыдущих проверок отбрасываются
+         */
+        int m_restartsCount = 0;
+
+        /**
+         * @brief Таймер отложенного запуска проверки, чтобы не мешать набору текста
+         */
+        QTimer m_checkTimer;
+    };
+}
+
+#endif // SCRIPTSPELLINGINDEX_H
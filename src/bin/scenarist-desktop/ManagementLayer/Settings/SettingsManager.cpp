@@ -20,6 +20,7 @@
 
 #include <QApplication>
 #include <QFileDialog>
+#include <QSharedPointer>
 #include <QSplitter>
 #include <QStandardItemModel>
 #include <QStandardPaths>
@@ -365,9 +366,9 @@ void SettingsManager::scenarioEditSpellCheckLanguageChanged(int _value)
         //
         // ... покажем прелоадер
         //
-        QLightBoxProgress progress(m_view);
-        progress.showProgress(tr("Dictionary loading"), tr("Please wait, loading of spell checking dictionary can take a few minutes."));
-        progress.setProgressValue(0);
+        QLightBoxProgress* progress = new QLightBoxProgress(m_view);
+        progress->showProgress(tr("Dictionary loading"), tr("Please wait, loading of spell checking dictionary can take a few minutes."));
+        progress->setProgressValue(0);
 
         //
         // ... создаём папку для пользовательских файлов
@@ -376,47 +377,63 @@ void SettingsManager::scenarioEditSpellCheckLanguageChanged(int _value)
         rootFolder.mkpath(hunspellDictionariesFolderPath);
 
         //
-        // ... скачаем словарь
+        // ... скачаем файлы словаря параллельно, показывая их общий прогресс
         //
         const QString hunspellDictionariesFolderUrl = "https://kitscenarist.ru/downloads/hunspell/";
-        //
-        NetworkRequest dictionaryLoader;
-        connect(&dictionaryLoader, &NetworkRequest::downloadProgress, this, [] (int _value) {
-            QLightBoxProgress::setProgressValue(_value);
-        });
-        const QByteArray affFileData = dictionaryLoader.loadSync(hunspellDictionariesFolderUrl + affFileName);
-        bool downloadingAffFileSuccess = affFileData.size() > 0;
-        if (downloadingAffFileSuccess) {
-            QFile affFile(hunspellDictionariesFolderPath + affFileName);
-            affFile.open(QIODevice::WriteOnly);
-            affFile.write(affFileData);
-            affFile.close();
-        }
-        //
-        progress.setProgressValue(0);
-        const QByteArray dicFileData = dictionaryLoader.loadSync(hunspellDictionariesFolderUrl + dicFileName);
-        bool downloadingDicFileSuccess = dicFileData.size() > 100;
-        if (downloadingDicFileSuccess) {
-            QFile dicFile(hunspellDictionariesFolderPath + dicFileName);
-            dicFile.open(QIODevice::WriteOnly);
-            dicFile.write(dicFileData);
-            dicFile.close();
+        const QVector<QUrl> dictionaryUrls = { QUrl(hunspellDictionariesFolderUrl + affFileName),
+                                               QUrl(hunspellDictionariesFolderUrl + dicFileName) };
+        QSharedPointer<QVector<int>> downloadProgresses(new QVector<int>(dictionaryUrls.size(), 0));
+        QVector<NetworkRequest*> dictionaryLoaders;
+        for (int index = 0; index != dictionaryUrls.size(); ++index) {
+            NetworkRequest* dictionaryLoader = new NetworkRequest(this);
+            dictionaryLoader->setPriority(NetworkRequestPriority::Bulk);
+            connect(dictionaryLoader, &NetworkRequest::downloadProgress, this, [downloadProgresses, index] (int _value) {
+                (*downloadProgresses)[index] = _value;
+                int totalProgress = 0;
+                for (int loaderProgress : *downloadProgresses) {
+                    totalProgress += loaderProgress;
+                }
+                QLightBoxProgress::setProgressValue(totalProgress / downloadProgresses->size());
+            });
+            dictionaryLoaders.append(dictionaryLoader);
         }
 
-        //
-        // ... скрываем прогресс
-        //
-        progress.finish();
-
-        //
-        // Если словари не удалось скачать, предупредим об этом пользователя
-        //
-        if (!downloadingAffFileSuccess || !downloadingDicFileSuccess) {
-            QLightBoxMessage::critical(m_view, tr("Can't enable spell checking"),
-                tr("Can't download spelling dictionary. "
-                   "Please check internet connection and retry to activate spell checking"));
-            m_view->setScenarioEditSpellCheck(false);
-        }
+        NetworkRequestLoader::loadAllAsync(dictionaryLoaders, dictionaryUrls, this,
+            [this, progress, hunspellDictionariesFolderPath, affFileName, dicFileName] (const QVector<QByteArray>& _data) {
+            const QByteArray& affFileData = _data.at(0);
+            bool downloadingAffFileSuccess = affFileData.size() > 0;
+            if (downloadingAffFileSuccess) {
+                QFile affFile(hunspellDictionariesFolderPath + affFileName);
+                affFile.open(QIODevice::WriteOnly);
+                affFile.write(affFileData);
+                affFile.close();
+            }
+            //
+            const QByteArray& dicFileData = _data.at(1);
+            bool downloadingDicFileSuccess = dicFileData.size() > 100;
+            if (downloadingDicFileSuccess) {
+                QFile dicFile(hunspellDictionariesFolderPath + dicFileName);
+                dicFile.open(QIODevice::WriteOnly);
+                dicFile.write(dicFileData);
+                dicFile.close();
+            }
+
+            //
+            // ... скрываем прогресс
+            //
+            progress->finish();
+            progress->deleteLater();
+
+            //
+            // Если словари не удалось скачать, предупредим об этом пользователя
+            //
+            if (!downloadingAffFileSuccess || !downloadingDicFileSuccess) {
+                QLightBoxMessage::critical(m_view, tr("Can't enable spell checking"),
+                    tr("Can't download spelling dictionary. "
+                       "Please check internet connection and retry to activate spell checking"));
+                m_view->setScenarioEditSpellCheck(false);
+            }
+        });
     }
 }
 
@@ -31,6 +31,7 @@
 #include <3rd_party/Widgets/QLightBoxWidget/qlightboxmessage.h>
 
 #include <NetworkRequest.h>
+#include <NetworkRequestLoader.h>
 
 #include <QApplication>
 #include <QDesktopServices>
@@ -107,21 +108,33 @@ void StartUpManager::checkCrashReports()
             dialog.setEmail(email);
         }
 
-        bool handled = true;
         if (dialog.exec() == CrashReportDialog::Accepted) {
-            dialog.showProgress();
+            //
+            // Отправляем все отчёты параллельно, не блокируя интерфейс
+            //
+            QVector<NetworkRequest*> requests;
+            QVector<QUrl> urls;
             for (const auto& reportPath : unhandledReportsPaths) {
-                //
-                // Отправляем
-                //
-                NetworkRequest loader;
-                loader.setRequestMethod(NetworkRequestMethod::Post);
-                loader.addRequestAttribute("version", QApplication::applicationVersion());
-                loader.addRequestAttribute("email", dialog.email());
-                loader.addRequestAttribute("message", dialog.message());
-                loader.addRequestAttributeFile("report", reportPath);
-                loader.loadSync("https://kitscenarist.ru/api/app/feedback/");
+                NetworkRequest* loader = new NetworkRequest(this);
+                loader->setRequestMethod(NetworkRequestMethod::Post);
+                loader->setPriority(NetworkRequestPriority::Bulk);
+                loader->addRequestAttribute("version", QApplication::applicationVersion());
+                loader->addRequestAttribute("email", dialog.email());
+                loader->addRequestAttribute("message", dialog.message());
+                loader->addRequestAttributeFile("report", reportPath);
+                requests.append(loader);
+                urls.append(QUrl("https://kitscenarist.ru/api/app/feedback/"));
             }
+            //
+            // ... а после отправки помечаем отчёты, чтобы в слдующий раз на них не обращать внимания.
+            //     Файлы отчётов читаются во время отправки, поэтому переименовывать их раньше нельзя
+            //
+            NetworkRequestLoader::loadAllAsync(requests, urls, this,
+                                              [unhandledReportsPaths, sendedSuffix] (const QVector<QByteArray>&) {
+                for (const auto& reportPath : unhandledReportsPaths) {
+                    QFile::rename(reportPath, reportPath +  "." + sendedSuffix);
+                }
+            });
 
             //
             // Сохраняем email, если ранее не было никакого
@@ -133,22 +146,20 @@ void StartUpManager::checkCrashReports()
                             SettingsStorage::ApplicationSettings);
             }
         } else {
-            handled = false;
-        }
-
-        //
-        // Помечаем отчёты, чтобы в слдующий раз на них не обращать внимания
-        //
-        for (auto& reportPath : unhandledReportsPaths) {
-            QFile::rename(reportPath, reportPath +  "." + (handled ? sendedSuffix : ignoredSuffix));
+            //
+            // Помечаем отчёты, чтобы в слдующий раз на них не обращать внимания
+            //
+            for (const auto& reportPath : unhandledReportsPaths) {
+                QFile::rename(reportPath, reportPath +  "." + ignoredSuffix);
+            }
         }
     }
 }
 
 void StartUpManager::checkNewVersion()
 {
-    NetworkRequest loader;
-    loader.setRequestMethod(NetworkRequestMethod::Post);
+    NetworkRequest* loader = new NetworkRequest(this);
+    loader->setRequestMethod(NetworkRequestMethod::Post);
 
     //
     // Сформируем uuid для приложения, по которому будем идентифицировать данного пользователя
@@ -163,7 +174,7 @@ void StartUpManager::checkNewVersion()
     // Построим ссылку, чтобы учитывать запрос на проверку обновлений
     //
 
-    loader.addRequestAttribute("system_type",
+    loader->addRequestAttribute("system_type",
 #ifdef Q_OS_WIN
                 "windows"
 #elif defined Q_OS_LINUX
@@ -175,14 +186,19 @@ void StartUpManager::checkNewVersion()
 #endif
                 );
 
-    loader.addRequestAttribute("system_name", QSysInfo::prettyProductName().toUtf8().toPercentEncoding());
-    loader.addRequestAttribute("uuid", uuid);
-    loader.addRequestAttribute("application_version", QApplication::applicationVersion());
+    loader->addRequestAttribute("system_name", QSysInfo::prettyProductName().toUtf8().toPercentEncoding());
+    loader->addRequestAttribute("uuid", uuid);
+    loader->addRequestAttribute("application_version", QApplication::applicationVersion());
 
-    QByteArray response = loader.loadSync(UPDATE_URL);
+    NetworkRequestLoader::loadAsync(loader, UPDATE_URL, this, [this] (const QByteArray& _response) {
+        processNewVersionInfo(_response);
+    });
+}
 
-    if (!response.isEmpty()) {
-        QXmlStreamReader responseReader(response);
+void StartUpManager::processNewVersionInfo(const QByteArray& _response)
+{
+    if (!_response.isEmpty()) {
+        QXmlStreamReader responseReader(_response);
 
         const int currentLang =
                 DataStorageLayer::StorageFacade::settingsStorage()->value(
@@ -403,21 +419,28 @@ QString StartUpManager::makeUpdateUrl(const QString& _fileTemplate)
 
 void StartUpManager::downloadUpdate(const QString& _fileTemplate)
 {
-    NetworkRequest loader;
+    NetworkRequest* loader = new NetworkRequest(this);
 
-    connect(&loader, &NetworkRequest::downloadProgress, this, &StartUpManager::downloadProgressForUpdate);
-    connect(this, &StartUpManager::stopDownloadForUpdate, &loader, &NetworkRequest::stop);
+    connect(loader, &NetworkRequest::downloadProgress, this, &StartUpManager::downloadProgressForUpdate);
+    connect(this, &StartUpManager::stopDownloadForUpdate, loader, &NetworkRequest::stop);
 
-    loader.setRequestMethod(NetworkRequestMethod::Post);
-    loader.clearRequestAttributes();
+    loader->setRequestMethod(NetworkRequestMethod::Post);
+    loader->setPriority(NetworkRequestPriority::Bulk);
+    loader->clearRequestAttributes();
 
     //
     // Загружаем установщик
     //
     const QUrl updateInfoUrl(makeUpdateUrl(_fileTemplate));
-    QByteArray response = loader.loadSync(updateInfoUrl);
-    if (response.isEmpty()) {
-        emit errorDownloadForUpdate(updateInfoUrl.toString());
+    NetworkRequestLoader::loadAsync(loader, updateInfoUrl, this, [this, updateInfoUrl] (const QByteArray& _response) {
+        saveUpdate(updateInfoUrl, _response);
+    });
+}
+
+void StartUpManager::saveUpdate(const QUrl& _updateUrl, const QByteArray& _update)
+{
+    if (_update.isEmpty()) {
+        emit errorDownloadForUpdate(_updateUrl.toString());
         return;
     }
 
@@ -425,10 +448,10 @@ void StartUpManager::downloadUpdate(const QString& _fileTemplate)
     // Сохраняем установщик в файл
     //
     const QString tempDirPath = QDir::toNativeSeparators(QStandardPaths::writableLocation(QStandardPaths::TempLocation));
-    m_updateFile = tempDirPath + QDir::separator() + updateInfoUrl.fileName();
+    m_updateFile = tempDirPath + QDir::separator() + _updateUrl.fileName();
     QFile tempFile(m_updateFile);
     if (tempFile.open(QIODevice::WriteOnly)) {
-        tempFile.write(response);
+        tempFile.write(_update);
         tempFile.close();
         emit downloadFinishedForUpdate();
     }
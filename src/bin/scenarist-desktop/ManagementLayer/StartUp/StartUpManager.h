@@ -204,6 +204,16 @@ namespace ManagementLayer
         void downloadUpdate(const QString& _fileTemplate);
 
     private:
+        /**
+         * @brief Обработать информацию о новой версии, полученную с сервера
+         */
+        void processNewVersionInfo(const QByteArray& _response);
+
+        /**
+         * @brief Сохранить загруженный файл с обновлением
+         */
+        void saveUpdate(const QUrl& _updateUrl, const QByteArray& _update);
+
         /**
          * @brief Настроить соединения
          */
@@ -1,6 +1,7 @@
 #include "StatisticsManager.h"
 
 #include <BusinessLayer/ScenarioDocument/ScenarioTemplate.h>
+#include <BusinessLayer/ScenarioDocument/ScenarioTextBlockInfo.h>
 #include <BusinessLayer/Statistics/StatisticsFacade.h>
 #include <BusinessLayer/Statistics/Reports/AbstractReport.h>
 
@@ -12,13 +13,169 @@
 #include <UserInterfaceLayer/Statistics/StatisticsView.h>
 
 #include <QEventLoop>
+#include <QFutureWatcher>
+#include <QScopedPointer>
+#include <QSharedPointer>
 #include <QStringListModel>
+#include <QTextBlock>
+#include <QTextCursor>
 #include <QTextDocument>
+#include <QTextFrame>
+#include <QVector>
+#include <QtConcurrentRun>
 
 using BusinessLogic::ScenarioBlockStyle;
 using ManagementLayer::StatisticsManager;
 using UserInterface::StatisticsView;
 
+namespace {
+    /**
+     * @brief Результат формирования отчёта, или графика
+     */
+    struct StatisticsResult {
+        QString report;
+        BusinessLogic::Plot plot;
+    };
+
+    /**
+     * @brief Ключ отчёта в кэше, однозначно определяемый его параметрами
+     */
+    QString cacheKey(const BusinessLogic::StatisticsParameters& _parameters) {
+        QStringList values;
+        values << QString::number(_parameters.type);
+        if (_parameters.type == BusinessLogic::StatisticsParameters::Report) {
+            values << QString::number(_parameters.reportType);
+        } else {
+            values << QString::number(_parameters.plotType);
+        }
+        values << QString::number(_parameters.summaryText)
+               << QString::number(_parameters.summaryScenes)
+               << QString::number(_parameters.summaryLocations)
+               << QString::number(_parameters.summaryCharacters)
+               << QString::number(_parameters.sceneShowCharacters)
+               << QString::number(_parameters.sceneSortByColumn)
+               << QString::number(_parameters.locationExtendedView)
+               << QString::number(_parameters.locationSortByColumn)
+               << QString::number(_parameters.castShowSpeakingAndNonspeakingScenes)
+               << QString::number(_parameters.castSortByColumn)
+               << _parameters.characterNames.join(QChar::LineFeed)
+               << QString::number(_parameters.storyStructureAnalisysSceneChron)
+               << QString::number(_parameters.storyStructureAnalisysActionChron)
+               << QString::number(_parameters.storyStructureAnalisysDialoguesChron)
+               << QString::number(_parameters.storyStructureAnalisysCharactersCount)
+               << QString::number(_parameters.storyStructureAnalisysDialoguesCount)
+               << _parameters.charactersActivityNames.join(QChar::LineFeed);
+        return values.join(QChar::Null);
+    }
+
+    /**
+     * @brief Копия текста сценария в виде простых данных, не связанных с документом
+     * @note Документ, созданный в потоке интерфейса, нельзя использовать в другом потоке,
+     *       поэтому здесь снимаются только данные, а документ для отчёта собирается уже в рабочем потоке
+     */
+    struct ScenarioSnapshot {
+        /**
+         * @brief Фрагмент блока с единым форматом
+         */
+        struct Fragment {
+            QString text;
+            QTextCharFormat format;
+        };
+
+        /**
+         * @brief Блок текста
+         * @note В данных блока хранятся параметры сцен, поэтому копируем их вместе с текстом
+         */
+        struct Block {
+            QTextBlockFormat format;
+            QTextCharFormat charFormat;
+            QVector<Fragment> fragments;
+            QSharedPointer<BusinessLogic::TextBlockInfo> info;
+        };
+
+        /**
+         * @brief Параметры документа
+         */
+        /** @{ */
+        QFont defaultFont;
+        QTextOption defaultTextOption;
+        QTextFrameFormat rootFrameFormat;
+        QSizeF pageSize;
+        qreal indentWidth = 0;
+        bool useDesignMetrics = false;
+        /** @} */
+
+        /**
+         * @brief Блоки текста
+         */
+        QVector<Block> blocks;
+    };
+
+    /**
+     * @brief Снять копию текста сценария для формирования отчёта
+     */
+    QSharedPointer<ScenarioSnapshot> takeSnapshot(const QTextDocument* _scenario) {
+        QSharedPointer<ScenarioSnapshot> snapshot(new ScenarioSnapshot);
+        snapshot->defaultFont = _scenario->defaultFont();
+        snapshot->defaultTextOption = _scenario->defaultTextOption();
+        snapshot->rootFrameFormat = _scenario->rootFrame()->frameFormat();
+        snapshot->pageSize = _scenario->pageSize();
+        snapshot->indentWidth = _scenario->indentWidth();
+        snapshot->useDesignMetrics = _scenario->useDesignMetrics();
+
+        snapshot->blocks.reserve(_scenario->blockCount());
+        for (QTextBlock block = _scenario->begin(); block.isValid(); block = block.next()) {
+            ScenarioSnapshot::Block blockSnapshot;
+            blockSnapshot.format = block.blockFormat();
+            blockSnapshot.charFormat = block.charFormat();
+            for (QTextBlock::iterator it = block.begin(); !it.atEnd(); ++it) {
+                const QTextFragment fragment = it.fragment();
+                if (fragment.isValid()) {
+                    blockSnapshot.fragments.append({ fragment.text(), fragment.charFormat() });
+                }
+            }
+            if (const auto* blockInfo = dynamic_cast<BusinessLogic::TextBlockInfo*>(block.userData())) {
+                blockSnapshot.info.reset(blockInfo->clone());
+            }
+            snapshot->blocks.append(blockSnapshot);
+        }
+        return snapshot;
+    }
+
+    /**
+     * @brief Собрать документ по копии текста
+     * @note Вызывается в потоке, в котором документ будет использоваться
+     */
+    QTextDocument* restoreSnapshot(const ScenarioSnapshot& _snapshot) {
+        QTextDocument* scenario = new QTextDocument;
+        scenario->setDefaultFont(_snapshot.defaultFont);
+        scenario->setDefaultTextOption(_snapshot.defaultTextOption);
+        scenario->rootFrame()->setFrameFormat(_snapshot.rootFrameFormat);
+        scenario->setPageSize(_snapshot.pageSize);
+        scenario->setIndentWidth(_snapshot.indentWidth);
+        scenario->setUseDesignMetrics(_snapshot.useDesignMetrics);
+
+        QTextCursor cursor(scenario);
+        bool isFirstBlock = true;
+        for (const ScenarioSnapshot::Block& block : _snapshot.blocks) {
+            if (isFirstBlock) {
+                cursor.setBlockFormat(block.format);
+                cursor.setBlockCharFormat(block.charFormat);
+                isFirstBlock = false;
+            } else {
+                cursor.insertBlock(block.format, block.charFormat);
+            }
+            for (const ScenarioSnapshot::Fragment& fragment : block.fragments) {
+                cursor.insertText(fragment.text, fragment.format);
+            }
+            if (!block.info.isNull()) {
+                cursor.block().setUserData(block.info->clone());
+            }
+        }
+        return scenario;
+    }
+}
+
 
 StatisticsManager::StatisticsManager(QObject* _parent, QWidget* _parentWidget) :
     QObject(_parent),
@@ -42,7 +199,15 @@ void StatisticsManager::loadCurrentProject()
     //
     setExportedScenario(0);
     m_needUpdateScenario = true;
+    ++m_scenarioRevision;
+    m_reportsCache.clear();
+    m_plotsCache.clear();
     m_view->setReport(QString::null);
+    //
+    // ... отчёт, который ещё формируется, относится к предыдущему проекту и не будет показан
+    //
+    ++m_lastReportId;
+    m_view->hideProgress();
 
     //
     // Загрузить персонажей
@@ -53,6 +218,13 @@ void StatisticsManager::loadCurrentProject()
 void StatisticsManager::scenarioTextChanged()
 {
     m_needUpdateScenario = true;
+
+    //
+    // Сформированные ранее отчёты больше не актуальны
+    //
+    m_reportsCache.clear();
+    m_plotsCache.clear();
+    ++m_scenarioRevision;
 }
 
 void StatisticsManager::setExportedScenario(QTextDocument* _scenario)
@@ -77,41 +249,91 @@ void StatisticsManager::aboutMakeReport(const BusinessLogic::StatisticsParameter
         emit needNewExportedScenario();
     }
 
-    switch (_parameters.type) {
-        case BusinessLogic::StatisticsParameters::Report: {
-            //
-            // Формируем отчёт
-            //
-            const QString reportHtml = BusinessLogic::StatisticsFacade::makeReport(m_exportedScenario, _parameters);
+    //
+    // Новый запрос отменяет все предыдущие, их результаты не будут показаны
+    //
+    const int reportId = ++m_lastReportId;
+    const bool isReport = _parameters.type == BusinessLogic::StatisticsParameters::Report;
 
-            //
-            // Устанавливаем отчёт в форму
-            //
-            m_view->setReport(reportHtml);
+    //
+    // Если такой отчёт уже формировался по текущему тексту, то просто показываем его
+    //
+    const QString key = cacheKey(_parameters);
+    if (isReport && m_reportsCache.contains(key)) {
+        m_view->setReport(m_reportsCache.value(key));
+        m_view->hideProgress();
+        return;
+    }
+    if (!isReport && m_plotsCache.contains(key)) {
+        m_view->setPlot(m_plotsCache.value(key));
+        m_view->hideProgress();
+        return;
+    }
 
-            break;
-        }
+    //
+    // Формируем отчёт в отдельном потоке по копии текста, чтобы пользователь мог продолжать работу
+    // и чтобы изменения текста не влияли на формируемый отчёт
+    //
+    // ... копией владеет сама задача, поэтому она доживёт до конца формирования отчёта, даже если
+    //     менеджер будет удалён раньше
+    //
+    QSharedPointer<ScenarioSnapshot> scenarioSnapshot;
+    if (m_exportedScenario != nullptr) {
+        scenarioSnapshot = takeSnapshot(m_exportedScenario);
+    }
+    const int scenarioRevision = m_scenarioRevision;
+    QFutureWatcher<StatisticsResult>* watcher = new QFutureWatcher<StatisticsResult>(this);
+    connect(watcher, &QFutureWatcher<StatisticsResult>::finished, this,
+            [this, watcher, scenarioRevision, reportId, isReport, key] {
+        const StatisticsResult result = watcher->result();
+        watcher->deleteLater();
 
-        case BusinessLogic::StatisticsParameters::Plot: {
-            //
-            // Формируем данные
-            //
-            BusinessLogic::Plot plot = BusinessLogic::StatisticsFacade::makePlot(m_exportedScenario, _parameters);
+        //
+        // Запоминаем отчёт, если текст не успел измениться, пока он формировался
+        //
+        if (scenarioRevision == m_scenarioRevision) {
+            if (isReport) {
+                m_reportsCache.insert(key, result.report);
+            } else {
+                m_plotsCache.insert(key, result.plot);
+            }
+        }
 
-            //
-            // Рисуем график по данным
-            //
-            m_view->setPlot(plot);
+        //
+        // Показываем только последний запрошенный отчёт
+        //
+        if (reportId != m_lastReportId) {
+            return;
+        }
 
-            break;
+        if (isReport) {
+            m_view->setReport(result.report);
+        } else {
+            m_view->setPlot(result.plot);
         }
-    }
 
+        //
+        // Закрываем уведомление
+        //
+        m_view->hideProgress();
+    });
+    watcher->setFuture(QtConcurrent::run([scenarioSnapshot, _parameters, isReport] {
+        //
+        // Документ создаётся, используется и удаляется в рабочем потоке
+        //
+        QScopedPointer<QTextDocument> scenario;
+        if (!scenarioSnapshot.isNull()) {
+            scenario.reset(restoreSnapshot(*scenarioSnapshot));
+        }
 
-    //
-    // Закрываем уведомление
-    //
-    m_view->hideProgress();
+        StatisticsResult result;
+        if (isReport) {
+            result.report = BusinessLogic::StatisticsFacade::makeReport(scenario.data(), _parameters);
+        } else {
+            result.plot = BusinessLogic::StatisticsFacade::makePlot(scenario.data(), _parameters);
+        }
+        return result;
+    }));
 }
 
 void StatisticsManager::initView()
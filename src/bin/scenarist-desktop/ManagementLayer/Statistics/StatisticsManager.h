@@ -1,6 +1,9 @@
 #ifndef STATISTICSMANAGER_H
 #define STATISTICSMANAGER_H
 
+#include <BusinessLayer/Statistics/Plots/AbstractPlot.h>
+
+#include <QHash>
 #include <QObject>
 
 class QTextDocument;
@@ -58,6 +61,8 @@ namespace ManagementLayer
 	private slots:
 		/**
 		 * @brief Сформировать отчёт
+		 * @note Отчёт формируется в отдельном потоке по копии текста сценария, а готовые отчёты
+		 *       запоминаются до следующего изменения текста
 		 */
 		void aboutMakeReport(const BusinessLogic::StatisticsParameters& _parameters);
 
@@ -87,6 +92,25 @@ namespace ManagementLayer
 		 * @brief Флаг обозначающий необходимость обновить текст сценария перед построением отчёта
 		 */
 		bool m_needUpdateScenario;
+
+		/**
+		 * @brief Ревизия текста сценария, увеличивается при каждом его изменении
+		 */
+		int m_scenarioRevision = 0;
+
+		/**
+		 * @brief Номер последнего запрошенного отчёта
+		 * @note Отчёты, сформированные по более ранним запросам, не отображаются
+		 */
+		int m_lastReportId = 0;
+
+		/**
+		 * @brief Сформированные для текущей ревизии сценария отчёты и графики
+		 */
+		/** @{ */
+		QHash<QString, QString> m_reportsCache;
+		QHash<QString, BusinessLogic::Plot> m_plotsCache;
+		/** @} */
 	};
 }
 
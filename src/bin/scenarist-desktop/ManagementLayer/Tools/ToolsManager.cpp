@@ -157,12 +157,13 @@ void ToolsManager::loadScriptVersions()
 
 void ToolsManager::compareVersions(int firstVersionIndex, int secondVersionIndex)
 {
-    auto scriptVersion = [] (int versionIndex) {
+    auto scriptVersion = [this] (int versionIndex) {
         const auto versions = DataStorageLayer::StorageFacade::scriptVersionStorage()->all();
         if (versionIndex < versions->rowCount()) {
             return versions->data(versions->index(versionIndex, ScriptVersionsTable::kScriptText),
                                   Qt::DisplayRole).toString();
         }
+        emit currentScriptTextRequested();
         return DataStorageLayer::StorageFacade::scenarioStorage()->current()->text();
     };
 
@@ -44,6 +44,11 @@ namespace ManagementLayer
          */
         void applyScriptRequested(const QString& _xml);
 
+        /**
+         * @brief Нужен актуальный текст текущего сценария из хранилища
+         */
+        void currentScriptTextRequested();
+
     private:
         /**
          * @brief Загрузить список доступных бэкапов из файла
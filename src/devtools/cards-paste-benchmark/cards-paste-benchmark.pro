@@ -0,0 +1,31 @@
+#
+# Benchmark of pasting a full script into an empty project with the cards view open.
+# Builds the desktop application sources with its own main().
+#
+include(../../bin/scenarist-desktop.pro)
+
+TARGET = cards-paste-benchmark
+CONFIG += console
+CONFIG -= app_bundle
+
+VPATH += $$PWD/../../bin
+
+SOURCES -= scenarist-desktop/main.cpp
+SOURCES += $$PWD/main.cpp
+
+win32:RC_FILE =
+macx {
+    ICON =
+    QMAKE_INFO_PLIST =
+}
+
+CONFIG(debug, debug|release) {
+    DESTDIR = $$PWD/../../../build/Debug/devtools/cards-paste-benchmark
+} else {
+    DESTDIR = $$PWD/../../../build/Release/devtools/cards-paste-benchmark
+}
+
+OBJECTS_DIR = $$DESTDIR/.obj
+MOC_DIR = $$DESTDIR/.moc
+RCC_DIR = $$DESTDIR/.qrc
+UI_DIR = $$DESTDIR/.ui
@@ -0,0 +1,109 @@
+#include <ManagementLayer/Scenario/ScenarioCardsManager.h>
+
+#include <BusinessLayer/ScenarioDocument/ScenarioDocument.h>
+#include <BusinessLayer/ScenarioDocument/ScenarioTextDocument.h>
+
+#include <DataLayer/Database/Database.h>
+
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QTemporaryDir>
+#include <QTextCursor>
+#include <QTextStream>
+#include <QWidget>
+
+#include <algorithm>
+
+namespace {
+    /**
+     * @brief Read the script xml from a project file or from a plain xml file
+     */
+    QString readScriptXml(const QString& _path)
+    {
+        if (_path.endsWith(".kitsp", Qt::CaseInsensitive)) {
+            QString xml;
+            {
+                QSqlDatabase database = QSqlDatabase::addDatabase("QSQLITE", "benchmark_source");
+                database.setDatabaseName(_path);
+                if (database.open()) {
+                    QSqlQuery query(database);
+                    query.exec("SELECT text FROM scenario WHERE is_draft = 0");
+                    if (query.next()) {
+                        xml = query.value(0).toString();
+                    }
+                }
+            }
+            QSqlDatabase::removeDatabase("benchmark_source");
+            return xml;
+        }
+
+        QFile file(_path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            return QString();
+        }
+        return QString::fromUtf8(file.readAll());
+    }
+}
+
+
+int main(int argc, char *argv[])
+{
+    QApplication application(argc, argv);
+    QTextStream out(stdout);
+
+    if (application.arguments().size() < 2) {
+        out << "usage: cards-paste-benchmark <project.kitsp | script.xml> [runs]" << endl;
+        return 1;
+    }
+
+    const QString scriptXml = readScriptXml(application.arguments().at(1));
+    if (scriptXml.isEmpty()) {
+        out << "no script text in " << application.arguments().at(1) << endl;
+        return 1;
+    }
+    const int runs = application.arguments().size() > 2 ? application.arguments().at(2).toInt() : 5;
+
+    //
+    // Work in an empty temporary project, so the benchmark never touches the source file
+    //
+    QTemporaryDir projectDir;
+    DatabaseLayer::Database::setCurrentFile(projectDir.filePath("benchmark.kitsp"));
+
+    QWidget window;
+    window.resize(1280, 800);
+    window.show();
+
+    for (int run = 0; run < std::max(runs, 1); ++run) {
+        BusinessLogic::ScenarioDocument script;
+        ManagementLayer::ScenarioCardsManager cardsManager(nullptr, &window);
+        cardsManager.view()->resize(window.size());
+        cardsManager.view()->show();
+        cardsManager.load(script.model(), QString());
+        application.processEvents();
+
+        QElapsedTimer timer;
+        timer.start();
+        QTextCursor cursor(script.document());
+        cursor.beginEditBlock();
+        script.document()->insertFromMime(0, scriptXml);
+        cursor.endEditBlock();
+        const qint64 pasteTime = timer.elapsed();
+
+        //
+        // Let the cards manager apply the batch collected during the paste
+        //
+        application.processEvents();
+        const qint64 totalTime = timer.elapsed();
+
+        out << "run " << run + 1
+            << ": paste " << pasteTime << " ms"
+            << ", cards " << totalTime - pasteTime << " ms"
+            << ", total " << totalTime << " ms"
+            << ", top level items " << script.model()->rowCount() << endl;
+    }
+
+    return 0;
+}
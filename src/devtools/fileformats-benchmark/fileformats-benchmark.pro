@@ -0,0 +1,38 @@
+#
+# Throughput benchmarks of the fileformats library on a corpus of large files
+#
+QT += core gui widgets concurrent
+
+TARGET = fileformats-benchmark
+TEMPLATE = app
+
+CONFIG += c++11 console warn_on
+CONFIG -= app_bundle
+
+CONFIG(debug, debug|release) {
+    DESTDIR = $$PWD/../../../build/Debug/devtools/fileformats-benchmark
+} else {
+    DESTDIR = $$PWD/../../../build/Release/devtools/fileformats-benchmark
+}
+
+OBJECTS_DIR = $$DESTDIR/.obj
+MOC_DIR = $$DESTDIR/.moc
+RCC_DIR = $$DESTDIR/.qrc
+UI_DIR = $$DESTDIR/.ui
+
+#
+# Подключаем библиотеку fileformats
+#
+LIBS += -L$$DESTDIR/../../libs/fileformats/ -lfileformats
+
+INCLUDEPATH += $$PWD/../../libs/fileformats
+DEPENDPATH += $$PWD/../../libs/fileformats
+PRE_TARGETDEPS += $$PWD/../../libs/fileformats
+#
+
+unix {
+LIBS += -lz
+}
+
+SOURCES += \
+    main.cpp
@@ -0,0 +1,214 @@
+#include <docx_writer.h>
+#include <format_manager.h>
+#include <format_reader.h>
+
+#include <QApplication>
+#include <QBuffer>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QFuture>
+#include <QScopedPointer>
+#include <QStringList>
+#include <QTextDocument>
+#include <QTextStream>
+
+namespace {
+    /**
+     * @brief Collect the files with the given suffix from the arguments, directories are expanded
+     */
+    QStringList corpus(const QStringList& _paths, const QString& _suffix)
+    {
+        QStringList files;
+        for (const QString& path : _paths) {
+            const QFileInfo info(path);
+            if (info.isDir()) {
+                const QDir dir(path);
+                for (const QString& name : dir.entryList({ "*." + _suffix }, QDir::Files, QDir::Name)) {
+                    files.append(dir.absoluteFilePath(name));
+                }
+            } else {
+                files.append(path);
+            }
+        }
+        return files;
+    }
+
+    /**
+     * @brief Read a file into the document
+     */
+    bool readFile(const QString& _fileName, QTextDocument* _document, QTextStream& _out)
+    {
+        QFile file(_fileName);
+        if (!file.open(QIODevice::ReadOnly)) {
+            _out << _fileName << ": " << file.errorString() << endl;
+            return false;
+        }
+
+        QScopedPointer<FormatReader> reader(
+            FormatManager::createReader(&file, QFileInfo(_fileName).suffix().toLower()));
+        reader->read(&file, _document);
+        if (reader->hasError()) {
+            _out << _fileName << ": " << reader->errorString() << endl;
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Import every file of the corpus into a new document
+     */
+    int readCorpus(const QStringList& _files, QTextStream& _out)
+    {
+        qint64 totalBytes = 0;
+        qint64 totalTime = 0;
+        for (const QString& fileName : _files) {
+            QTextDocument document;
+            QElapsedTimer timer;
+            timer.start();
+            if (!readFile(fileName, &document, _out)) {
+                return 1;
+            }
+            const qint64 time = timer.elapsed();
+
+            const qint64 size = QFileInfo(fileName).size();
+            totalBytes += size;
+            totalTime += time;
+            _out << QFileInfo(fileName).fileName()
+                 << ": " << size / 1024 << " KB"
+                 << ", " << document.blockCount() << " paragraphs"
+                 << ", " << time << " ms" << endl;
+        }
+
+        _out << "total: " << _files.size() << " files"
+             << ", " << totalBytes / 1024 << " KB"
+             << ", " << totalTime << " ms";
+        if (totalTime > 0) {
+            _out << ", " << (totalBytes * 1000 / totalTime) / 1024 << " KB/s";
+        }
+        _out << endl;
+        return 0;
+    }
+
+    /**
+     * @brief Import all supported files of the directory concurrently with the batch API
+     */
+    int readBatch(const QString& _path, QTextStream& _out)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        QFuture<FormatManager::ReadResult> future = FormatManager::readDirectory(_path);
+        future.waitForFinished();
+        const qint64 time = timer.elapsed();
+
+        int result = 0;
+        qint64 totalBytes = 0;
+        for (const FormatManager::ReadResult& file : future.results()) {
+            if (!file.error.isEmpty()) {
+                _out << file.fileName << ": " << file.error << endl;
+                result = 1;
+                continue;
+            }
+            totalBytes += QFileInfo(file.fileName).size();
+        }
+
+        _out << "batch: " << future.resultCount() << " files"
+             << ", " << totalBytes / 1024 << " KB"
+             << ", " << time << " ms";
+        if (time > 0) {
+            _out << ", " << (totalBytes * 1000 / time) / 1024 << " KB/s";
+        }
+        _out << endl;
+        return result;
+    }
+
+    /**
+     * @brief Export every file of the corpus to DOCX in memory several times
+     */
+    int writeCorpus(const QStringList& _files, int _runs, QTextStream& _out)
+    {
+        int totalPages = 0;
+        qint64 totalTime = 0;
+        for (const QString& fileName : _files) {
+            QTextDocument document;
+            if (!readFile(fileName, &document, _out)) {
+                return 1;
+            }
+            //
+            // A4 page at 72 dpi, only used to count pages
+            //
+            document.setPageSize(QSizeF(595, 842));
+            const int pages = document.pageCount();
+
+            qint64 size = 0;
+            QElapsedTimer timer;
+            timer.start();
+            for (int run = 0; run < _runs; ++run) {
+                QBuffer buffer;
+                buffer.open(QIODevice::WriteOnly);
+                DocxWriter writer;
+                if (!writer.write(&buffer, &document)) {
+                    _out << fileName << ": " << writer.errorString() << endl;
+                    return 1;
+                }
+                size = buffer.size();
+            }
+            const qint64 time = timer.elapsed();
+
+            totalPages += pages * _runs;
+            totalTime += time;
+            _out << QFileInfo(fileName).fileName()
+                 << ": " << pages << " pages"
+                 << ", " << size / 1024 << " KB docx"
+                 << ", " << time / _runs << " ms per export" << endl;
+        }
+
+        _out << "total: " << totalPages << " pages in " << totalTime << " ms";
+        if (totalTime > 0) {
+            _out << ", " << totalPages * 1000 / totalTime << " pages/s";
+        }
+        _out << endl;
+        return 0;
+    }
+}
+
+
+int main(int argc, char *argv[])
+{
+    QApplication application(argc, argv);
+    QTextStream out(stdout);
+
+    QStringList arguments = application.arguments();
+    arguments.removeFirst();
+    const QString mode = arguments.isEmpty() ? QString() : arguments.takeFirst();
+
+    if (mode == "docx-read") {
+        const QStringList files = corpus(arguments, "docx");
+        if (!files.isEmpty()) {
+            return readCorpus(files, out);
+        }
+    } else if (mode == "rtf-read") {
+        const QStringList files = corpus(arguments, "rtf");
+        if (!files.isEmpty()) {
+            return readCorpus(files, out);
+        }
+    } else if (mode == "batch-read") {
+        if (arguments.size() == 1 && QFileInfo(arguments.first()).isDir()) {
+            const int result = readBatch(arguments.first(), out);
+            QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+            return result;
+        }
+    } else if (mode == "docx-write") {
+        const QStringList files = corpus(arguments, "docx");
+        if (!files.isEmpty()) {
+            return writeCorpus(files, 5, out);
+        }
+    }
+
+    out << "usage: fileformats-benchmark docx-read <file.docx | directory>..." << endl
+        << "       fileformats-benchmark rtf-read <file.rtf | directory>..." << endl
+        << "       fileformats-benchmark batch-read <directory>" << endl
+        << "       fileformats-benchmark docx-write <file.docx | directory>..." << endl;
+    return 1;
+}
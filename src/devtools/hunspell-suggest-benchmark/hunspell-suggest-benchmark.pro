@@ -0,0 +1,43 @@
+#
+# Suggestion timings of the hunspell library on the word lists of its tests
+#
+QT += core
+QT -= gui
+
+TARGET = hunspell-suggest-benchmark
+TEMPLATE = app
+
+CONFIG += c++11 console warn_on
+CONFIG -= app_bundle
+
+CONFIG(debug, debug|release) {
+    DESTDIR = $$PWD/../../../build/Debug/devtools/hunspell-suggest-benchmark
+} else {
+    DESTDIR = $$PWD/../../../build/Release/devtools/hunspell-suggest-benchmark
+}
+
+OBJECTS_DIR = $$DESTDIR/.obj
+MOC_DIR = $$DESTDIR/.moc
+RCC_DIR = $$DESTDIR/.qrc
+UI_DIR = $$DESTDIR/.ui
+
+#
+# Подключаем библиотеку HUNSPELL
+#
+LIBS += -L$$DESTDIR/../../libs/hunspell/ -lhunspell
+
+INCLUDEPATH += $$PWD/../../libs/hunspell/src
+DEPENDPATH += $$PWD/../../libs/hunspell
+PRE_TARGETDEPS += $$PWD/../../libs/hunspell
+#
+
+win32 {
+    DEFINES += HUNSPELL_STATIC
+}
+
+unix {
+    LIBS += -lpthread
+}
+
+SOURCES += \
+    main.cpp
@@ -0,0 +1,141 @@
+#include <hunspell/hunspell.hxx>
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QList>
+#include <QStringList>
+#include <QTextStream>
+
+#include <algorithm>
+
+namespace {
+    /**
+     * @brief Timings of the suggestions for one dictionary
+     */
+    struct Result {
+        int wordsCount = 0;
+        int suggestionsCount = 0;
+        qint64 totalNsecs = 0;
+        qint64 worstNsecs = 0;
+    };
+
+    /**
+     * @brief Read the misspelled words, one per line, in the dictionary encoding
+     */
+    QList<QByteArray> readWords(const QString& _fileName)
+    {
+        QList<QByteArray> words;
+        QFile file(_fileName);
+        if (!file.open(QIODevice::ReadOnly)) {
+            return words;
+        }
+        while (!file.atEnd()) {
+            const QByteArray word = file.readLine().trimmed();
+            if (!word.isEmpty()) {
+                words.append(word);
+            }
+        }
+        return words;
+    }
+
+    /**
+     * @brief Ask the suggestions of every word the given number of times
+     */
+    Result benchmark(const QString& _affPath, const QString& _dicPath, const QList<QByteArray>& _words,
+        int _repeats)
+    {
+        Hunspell hunspell(QFile::encodeName(_affPath).constData(), QFile::encodeName(_dicPath).constData());
+
+        Result result;
+        QElapsedTimer timer;
+        for (int repeat = 0; repeat < _repeats; ++repeat) {
+            for (const QByteArray& word : _words) {
+                char** suggestions = nullptr;
+                timer.start();
+                const int count = hunspell.suggest(&suggestions, word.constData());
+                const qint64 elapsed = timer.nsecsElapsed();
+                hunspell.free_list(&suggestions, count);
+
+                ++result.wordsCount;
+                result.suggestionsCount += count;
+                result.totalNsecs += elapsed;
+                result.worstNsecs = std::max(result.worstNsecs, elapsed);
+            }
+        }
+        return result;
+    }
+
+    void print(const QString& _name, const Result& _result, QTextStream& _out)
+    {
+        _out << _name << ": " << _result.wordsCount << " words, " << _result.suggestionsCount
+             << " suggestions, mean "
+             << (_result.wordsCount ? _result.totalNsecs / _result.wordsCount / 1000 : 0)
+             << " us, worst " << _result.worstNsecs / 1000 << " us" << endl;
+    }
+}
+
+
+/**
+ * @brief Time the suggestions of Hunspell
+ * @note Usage:
+ *       hunspell-suggest-benchmark [-r repeats] <tests dir> [name ...]
+ *           the misspelled words of <name>.wrong with <name>.aff and <name>.dic,
+ *           all tests with a word list if no names are given
+ *       hunspell-suggest-benchmark [-r repeats] -w <aff> <dic> <words>
+ *           the words of the file with a real dictionary
+ *       The first run writes the dictionary images next to the dic files
+ */
+int main(int argc, char* argv[])
+{
+    QCoreApplication application(argc, argv);
+    QTextStream out(stdout);
+
+    QStringList arguments = application.arguments().mid(1);
+    int repeats = 1;
+    if (arguments.size() >= 2 && arguments.first() == "-r") {
+        repeats = std::max(1, arguments.at(1).toInt());
+        arguments = arguments.mid(2);
+    }
+
+    if (arguments.size() == 4 && arguments.first() == "-w") {
+        print(QFileInfo(arguments.at(2)).completeBaseName(),
+              benchmark(arguments.at(1), arguments.at(2), readWords(arguments.at(3)), repeats), out);
+        return 0;
+    }
+
+    if (arguments.isEmpty() || arguments.first().startsWith('-')) {
+        out << "usage: hunspell-suggest-benchmark [-r repeats] <tests dir> [name ...]" << endl
+            << "       hunspell-suggest-benchmark [-r repeats] -w <aff> <dic> <words>" << endl;
+        return 2;
+    }
+
+    const QDir testsDir(arguments.takeFirst());
+    QStringList names = arguments;
+    if (names.isEmpty()) {
+        for (const QString& fileName : testsDir.entryList({ "*.wrong" }, QDir::Files, QDir::Name)) {
+            names.append(QFileInfo(fileName).completeBaseName());
+        }
+    }
+
+    Result total;
+    for (const QString& name : names) {
+        const QString affPath = testsDir.filePath(name + ".aff");
+        const QString dicPath = testsDir.filePath(name + ".dic");
+        const QString wrongPath = testsDir.filePath(name + ".wrong");
+        if (!QFile::exists(affPath) || !QFile::exists(dicPath) || !QFile::exists(wrongPath)) {
+            continue;
+        }
+
+        const Result result = benchmark(affPath, dicPath, readWords(wrongPath), repeats);
+        print(name, result, out);
+        total.wordsCount += result.wordsCount;
+        total.suggestionsCount += result.suggestionsCount;
+        total.totalNsecs += result.totalNsecs;
+        total.worstNsecs = std::max(total.worstNsecs, result.worstNsecs);
+    }
+    print("total", total, out);
+    return 0;
+}
@@ -0,0 +1,127 @@
+#include <mythes.h>
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QList>
+#include <QScopedPointer>
+#include <QStringList>
+#include <QTextStream>
+
+namespace {
+    /**
+     * @brief Read the words to look up, one per line
+     * @note Without a words file every word of the text index is looked up
+     */
+    QList<QByteArray> readWords(const QString& _fileName, bool _isIndex)
+    {
+        QList<QByteArray> words;
+        QFile file(_fileName);
+        if (!file.open(QIODevice::ReadOnly)) {
+            return words;
+        }
+
+        //
+        // Text index starts with the encoding and the count of entries, then "word|offset" lines
+        //
+        if (_isIndex) {
+            file.readLine();
+            file.readLine();
+        }
+        while (!file.atEnd()) {
+            QByteArray line = file.readLine().trimmed();
+            if (_isIndex) {
+                line = line.left(line.indexOf('|'));
+            }
+            if (!line.isEmpty()) {
+                words.append(line);
+            }
+        }
+        return words;
+    }
+
+    /**
+     * @brief Construct the thesaurus and report how long it took
+     */
+    MyThes* load(const QByteArray& _idxPath, const QByteArray& _datPath, const char* _title, QTextStream& _out)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        MyThes* thesaurus = new MyThes(_idxPath.constData(), _datPath.constData());
+        _out << _title << ": " << timer.nsecsElapsed() / 1000 << " us" << endl;
+        return thesaurus;
+    }
+
+    /**
+     * @brief Look up every word and report the time and the total count of meanings
+     */
+    int lookup(MyThes* _thesaurus, const QList<QByteArray>& _words, const char* _title, QTextStream& _out)
+    {
+        int meaningsCount = 0;
+        QElapsedTimer timer;
+        timer.start();
+        for (const QByteArray& word : _words) {
+            mentry* meanings = nullptr;
+            const int count = _thesaurus->Lookup(word.constData(), word.size(), &meanings);
+            meaningsCount += count;
+            _thesaurus->CleanUpAfterLookup(&meanings, count);
+        }
+        const qint64 elapsed = timer.nsecsElapsed();
+        _out << _title << ": " << _words.size() << " words, " << meaningsCount << " meanings in "
+             << elapsed / 1000 << " us";
+        if (!_words.isEmpty()) {
+            _out << ", " << elapsed / _words.size() << " ns/word";
+        }
+        _out << endl;
+        return meaningsCount;
+    }
+}
+
+
+/**
+ * @brief Time loading of the thesaurus with and without the binary index and the lookups in it
+ * @note Usage: mythes-benchmark <th.idx> <th.dat> [words.txt]
+ */
+int main(int argc, char* argv[])
+{
+    QCoreApplication application(argc, argv);
+    QTextStream out(stdout);
+
+    const QStringList arguments = application.arguments().mid(1);
+    if (arguments.size() < 2) {
+        out << "usage: mythes-benchmark <th.idx> <th.dat> [words.txt]" << endl;
+        return 2;
+    }
+
+    const QByteArray idxPath = arguments.at(0).toLocal8Bit();
+    const QByteArray datPath = arguments.at(1).toLocal8Bit();
+    const QList<QByteArray> words = arguments.size() > 2
+                                    ? readWords(arguments.at(2), false)
+                                    : readWords(arguments.at(0), true);
+
+    //
+    // First load converts the text index and saves the binary one next to it,
+    // the second one maps the saved binary index
+    //
+    QFile::remove(arguments.at(0) + ".bin");
+    QScopedPointer<MyThes> cold(load(idxPath, datPath, "load with conversion", out));
+    if (cold->get_th_encoding() == nullptr) {
+        out << "can't load " << arguments.at(0) << endl;
+        return 1;
+    }
+    const int coldMeanings = lookup(cold.data(), words, "lookup", out);
+    cold.reset();
+
+    QScopedPointer<MyThes> warm(load(idxPath, datPath, "load of binary index", out));
+    const int warmMeanings = lookup(warm.data(), words, "lookup", out);
+    lookup(warm.data(), words, "repeated lookup", out);
+
+    //
+    // Both indexes should give the same answers
+    //
+    if (coldMeanings != warmMeanings) {
+        out << "meanings differ: " << coldMeanings << " vs " << warmMeanings << endl;
+        return 1;
+    }
+    return 0;
+}
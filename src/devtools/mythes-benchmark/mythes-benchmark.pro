@@ -0,0 +1,35 @@
+#
+# Load and lookup timings of the mythes thesaurus
+#
+QT += core
+QT -= gui
+
+TARGET = mythes-benchmark
+TEMPLATE = app
+
+CONFIG += c++11 console warn_on
+CONFIG -= app_bundle
+
+CONFIG(debug, debug|release) {
+    DESTDIR = $$PWD/../../../build/Debug/devtools/mythes-benchmark
+} else {
+    DESTDIR = $$PWD/../../../build/Release/devtools/mythes-benchmark
+}
+
+OBJECTS_DIR = $$DESTDIR/.obj
+MOC_DIR = $$DESTDIR/.moc
+RCC_DIR = $$DESTDIR/.qrc
+UI_DIR = $$DESTDIR/.ui
+
+#
+# Подключаем библиотеку mythes
+#
+LIBS += -L$$DESTDIR/../../libs/mythes/ -lmythes
+
+INCLUDEPATH += $$PWD/../../libs/mythes
+DEPENDPATH += $$PWD/../../libs/mythes
+PRE_TARGETDEPS += $$PWD/../../libs/mythes
+#
+
+SOURCES += \
+    main.cpp
@@ -0,0 +1,257 @@
+#include <NetworkRequest.h>
+#include <NetworkRequestLoader.h>
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QHostAddress>
+#include <QSharedPointer>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTextStream>
+#include <QTimer>
+#include <QUrl>
+#include <QVector>
+
+#include <algorithm>
+
+namespace {
+    /**
+     * @brief How long the stand-in server holds every response, in ms
+     */
+    const int kResponseDelay = 300;
+
+    /**
+     * @brief Number of urls loaded at once
+     */
+    const int kRequestsCount = 8;
+
+    /**
+     * @brief Local HTTP server answering "response <path>" to every GET after a fixed delay
+     */
+    class StandInServer
+    {
+    public:
+        StandInServer()
+        {
+            QObject::connect(&m_server, &QTcpServer::newConnection, [this] {
+                while (QTcpSocket* socket = m_server.nextPendingConnection()) {
+                    handleConnection(socket);
+                }
+            });
+        }
+
+        bool listen()
+        {
+            return m_server.listen(QHostAddress::LocalHost);
+        }
+
+        QUrl url(int _index) const
+        {
+            return QUrl(QString("http://127.0.0.1:%1/%2").arg(m_server.serverPort()).arg(_index));
+        }
+
+        static QByteArray body(int _index)
+        {
+            return "response " + QByteArray::number(_index);
+        }
+
+        /**
+         * @brief Max number of requests the server was holding at the same time
+         */
+        int peakActiveCount() const
+        {
+            return m_peakActiveCount;
+        }
+
+        void resetPeak()
+        {
+            m_peakActiveCount = m_activeCount;
+        }
+
+    private:
+        void handleConnection(QTcpSocket* _socket)
+        {
+            QObject::connect(_socket, &QTcpSocket::disconnected, _socket, &QTcpSocket::deleteLater);
+
+            struct Connection {
+                QByteArray request;
+                bool isActive = false;
+            };
+            QSharedPointer<Connection> connection(new Connection);
+
+            QObject::connect(_socket, &QTcpSocket::readyRead, _socket, [this, _socket, connection] {
+                connection->request.append(_socket->readAll());
+                if (connection->isActive
+                    || !connection->request.contains("\r\n\r\n")) {
+                    return;
+                }
+
+                //
+                // Request line looks like "GET /<index> HTTP/1.1"
+                //
+                const QList<QByteArray> requestLine =
+                    connection->request.left(connection->request.indexOf("\r\n")).split(' ');
+                const QByteArray path = requestLine.value(1).mid(1);
+
+                connection->isActive = true;
+                ++m_activeCount;
+                m_peakActiveCount = std::max(m_peakActiveCount, m_activeCount);
+
+                QTimer::singleShot(kResponseDelay, _socket, [this, _socket, connection, path] {
+                    const QByteArray responseBody = "response " + path;
+                    _socket->write("HTTP/1.1 200 OK\r\n"
+                                   "Content-Type: text/plain\r\n"
+                                   "Connection: close\r\n"
+                                   "Content-Length: " + QByteArray::number(responseBody.size()) + "\r\n"
+                                   "\r\n");
+                    _socket->write(responseBody);
+                    _socket->disconnectFromHost();
+                    connection->isActive = false;
+                    --m_activeCount;
+                });
+            });
+            //
+            // The client may drop the connection before the answer, e.g. when the request is stopped
+            //
+            QObject::connect(_socket, &QTcpSocket::disconnected, [this, connection] {
+                if (connection->isActive) {
+                    connection->isActive = false;
+                    --m_activeCount;
+                }
+            });
+        }
+
+    private:
+        QTcpServer m_server;
+        int m_activeCount = 0;
+        int m_peakActiveCount = 0;
+    };
+
+    /**
+     * @brief Spin the event loop for the given time
+     */
+    void wait(int _msecs)
+    {
+        QEventLoop loop;
+        QTimer::singleShot(_msecs, &loop, &QEventLoop::quit);
+        loop.exec();
+    }
+
+    /**
+     * @brief Load every url at once and check that the results came back in order and in parallel
+     */
+    bool checkParallelDownloads(StandInServer& _server, QTextStream& _out)
+    {
+        QVector<NetworkRequest*> requests;
+        QVector<QUrl> urls;
+        for (int index = 0; index < kRequestsCount; ++index) {
+            requests.append(new NetworkRequest);
+            urls.append(_server.url(index));
+        }
+
+        _server.resetPeak();
+        QVector<QByteArray> results;
+        bool isDone = false;
+        QEventLoop loop;
+        QElapsedTimer timer;
+        timer.start();
+        NetworkRequestLoader::loadAllAsync(requests, urls, &loop, [&] (const QVector<QByteArray>& _results) {
+            results = _results;
+            isDone = true;
+            loop.quit();
+        });
+        QTimer::singleShot(kResponseDelay * kRequestsCount * 4, &loop, &QEventLoop::quit);
+        loop.exec();
+        const qint64 elapsed = timer.elapsed();
+
+        bool isOk = isDone;
+        if (!isDone) {
+            _out << "parallel: loadAllAsync did not finish" << endl;
+        }
+        for (int index = 0; index < results.size(); ++index) {
+            if (results.at(index) != StandInServer::body(index)) {
+                _out << "parallel: result " << index << " is \"" << results.at(index) << "\"" << endl;
+                isOk = false;
+            }
+        }
+        //
+        // Sequential loading would take at least the delay times the number of requests
+        //
+        if (_server.peakActiveCount() < 2
+            || elapsed >= kResponseDelay * kRequestsCount) {
+            _out << "parallel: requests were not loaded in parallel" << endl;
+            isOk = false;
+        }
+
+        _out << "parallel: " << kRequestsCount << " requests in " << elapsed << " ms, "
+             << _server.peakActiveCount() << " at once" << endl;
+        return isOk;
+    }
+
+    /**
+     * @brief Explicit stop finishes the request with an error exactly once
+     */
+    bool checkExplicitStop(StandInServer& _server, QTextStream& _out)
+    {
+        NetworkRequest request;
+        int errorsCount = 0;
+        int finishedCount = 0;
+        QObject::connect(&request, &NetworkRequest::error, [&errorsCount] { ++errorsCount; });
+        QObject::connect(&request, &NetworkRequest::finished, [&finishedCount] { ++finishedCount; });
+
+        request.loadAsync(_server.url(0));
+        request.stop();
+        wait(kResponseDelay * 2);
+
+        const bool isOk = errorsCount == 1 && finishedCount == 1;
+        _out << "stop: " << errorsCount << " errors, " << finishedCount << " finished" << endl;
+        return isOk;
+    }
+
+    /**
+     * @brief Reconfiguring a queued request drops it silently, without error and finished
+     */
+    bool checkSilentSetters(StandInServer& _server, QTextStream& _out)
+    {
+        NetworkRequest request;
+        int errorsCount = 0;
+        int finishedCount = 0;
+        QObject::connect(&request, &NetworkRequest::error, [&errorsCount] { ++errorsCount; });
+        QObject::connect(&request, &NetworkRequest::finished, [&finishedCount] { ++finishedCount; });
+
+        request.loadAsync(_server.url(0));
+        request.setLoadingTimeout(request.loadingTimeout());
+        request.clearRequestAttributes();
+        wait(kResponseDelay * 2);
+
+        const bool isOk = errorsCount == 0 && finishedCount == 0;
+        _out << "setters: " << errorsCount << " errors, " << finishedCount << " finished" << endl;
+        return isOk;
+    }
+}
+
+
+/**
+ * @brief Check the webloader queue against a local HTTP stand-in server
+ * @note Exits with a non-zero code if any check fails
+ */
+int main(int argc, char* argv[])
+{
+    QCoreApplication application(argc, argv);
+    QTextStream out(stdout);
+
+    StandInServer server;
+    if (!server.listen()) {
+        out << "can't start the stand-in server" << endl;
+        return 2;
+    }
+
+    bool isOk = checkParallelDownloads(server, out);
+    isOk = checkExplicitStop(server, out) && isOk;
+    isOk = checkSilentSetters(server, out) && isOk;
+
+    NetworkRequest::stopAllConnections();
+    out << (isOk ? "OK" : "FAILED") << endl;
+    return isOk ? 0 : 1;
+}
@@ -0,0 +1,35 @@
+#
+# Parallel downloads of the webloader library against a local HTTP stand-in server
+#
+QT += core network xml
+QT -= gui
+
+TARGET = webloader-parallel-test
+TEMPLATE = app
+
+CONFIG += c++11 console warn_on
+CONFIG -= app_bundle
+
+CONFIG(debug, debug|release) {
+    DESTDIR = $$PWD/../../../build/Debug/devtools/webloader-parallel-test
+} else {
+    DESTDIR = $$PWD/../../../build/Release/devtools/webloader-parallel-test
+}
+
+OBJECTS_DIR = $$DESTDIR/.obj
+MOC_DIR = $$DESTDIR/.moc
+RCC_DIR = $$DESTDIR/.qrc
+UI_DIR = $$DESTDIR/.ui
+
+#
+# Подключаем библиотеку webloader
+#
+LIBS += -L$$DESTDIR/../../libs/webloader/ -lwebloader
+
+INCLUDEPATH += $$PWD/../../libs/webloader/src
+DEPENDPATH += $$PWD/../../libs/webloader/src
+PRE_TARGETDEPS += $$PWD/../../libs/webloader/src
+#
+
+SOURCES += \
+    main.cpp
@@ -23,10 +23,18 @@
 
 #include "qtzip/QtZipReader"
 
+#include <QFuture>
+#include <QScopedPointer>
 #include <QTextDocument>
 #include <QXmlStreamAttributes>
+#include <QtConcurrentRun>
 
 namespace {
+    /**
+     * @brief Как часто сообщать о прогрессе чтения и проверять его прерывание, мс
+     */
+    const int PROGRESS_INTERVAL = 100;
+
     qreal pixelsFromTwips(qint32 _twips)
     {
         qreal inches = _twips / 1440.0;
@@ -98,14 +106,22 @@ void DocxReader::Comment::insertIfReady(const QTextCursor& _cursor) const
 
 //-----------------------------------------------------------------------------
 
-DocxReader::DocxReader() :
-    m_in_block(false)
+DocxReader::DocxReader(QtZipReader* archive) :
+    m_in_block(false),
+    m_document_size(0),
+    m_archive(archive)
 {
     m_xml.setNamespaceProcessing(false);
 }
 
 //-----------------------------------------------------------------------------
 
+DocxReader::~DocxReader()
+{
+}
+
+//-----------------------------------------------------------------------------
+
 bool DocxReader::canRead(QIODevice* device)
 {
     return QtZipReader::canRead(device);
@@ -118,29 +134,67 @@ void DocxReader::readData(QIODevice* device)
     m_in_block = m_cursor.document()->blockCount();
     m_current_style.block_format = m_cursor.blockFormat();
 
-    // Open archive
-    QtZipReader zip(device);
+    // Open archive, unless it was opened already while detecting the format
+    if (m_archive.isNull()) {
+        m_archive.reset(new QtZipReader(device));
+    }
+    QtZipReader& zip = *m_archive;
 
     // Read archive
     if (zip.isReadable()) {
-        const QString files[] = {
-            QString::fromLatin1("word/styles.xml"),
-            QString::fromLatin1("word/comments.xml"),
-            QString::fromLatin1("word/document.xml")
-        };
-        for (int i = 0; i < 3; ++i) {
-            QByteArray data = zip.fileData(files[i]);
-            if (data.isEmpty()) {
-                continue;
-            }
-            m_xml.addData(data);
+        //
+        // Стили и комментарии разбираем в отдельных потоках, каждый своим читателем,
+        // стили нужны для текста сразу, а комментарии только после того, как он будет прочитан
+        //
+        DocxReader styles_reader;
+        styles_reader.m_current_style = m_current_style;
+        QFuture<void> styles_future;
+        const QByteArray styles_data = zip.fileData(QString::fromLatin1("word/styles.xml"));
+        if (!styles_data.isEmpty()) {
+            styles_reader.m_xml.addData(styles_data);
+            styles_future = QtConcurrent::run(&styles_reader, &DocxReader::readContent);
+        }
+
+        DocxReader comments_reader;
+        QFuture<void> comments_future;
+        const QByteArray comments_data = zip.fileData(QString::fromLatin1("word/comments.xml"));
+        if (!comments_data.isEmpty()) {
+            comments_reader.m_xml.addData(comments_data);
+            comments_future = QtConcurrent::run(&comments_reader, &DocxReader::readContent);
+        }
+
+        styles_future.waitForFinished();
+        if (styles_reader.m_xml.hasError()) {
+            m_error = styles_reader.m_xml.errorString();
+        } else {
+            m_styles = styles_reader.m_styles;
+            m_current_style = styles_reader.m_current_style;
+        }
+
+        //
+        // Текст документа читаем потоком прямо из архива, не распаковывая его целиком
+        //
+        QScopedPointer<QIODevice> document(zip.fileDevice(QString::fromLatin1("word/document.xml")));
+        if (!hasError() && !document.isNull() && (document->size() > 0)) {
+            m_document_size = document->size();
+            m_progress_timer.start();
+            m_xml.setDevice(document.data());
             readContent();
             if (m_xml.hasError()) {
                 m_error = m_xml.errorString();
-                break;
             }
             m_xml.clear();
         }
+
+        comments_future.waitForFinished();
+        if (!hasError()) {
+            if (comments_reader.m_xml.hasError()) {
+                m_error = comments_reader.m_xml.errorString();
+            } else {
+                m_comments = comments_reader.m_comments;
+                insertComments();
+            }
+        }
     } else {
         m_error = tr("Unable to open archive.");
     }
@@ -148,7 +202,9 @@ void DocxReader::readData(QIODevice* device)
     // Close archive
     zip.close();
 
-    QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
+    if (!hasError()) {
+        reportProgress(1, 1);
+    }
 }
 
 //-----------------------------------------------------------------------------
@@ -372,7 +428,7 @@ void DocxReader::readBody()
         } else if ((m_xml.qualifiedName() == "w:commentRangeEnd")
                    || (m_xml.qualifiedName() == "w:bookmarkEnd")) {
             m_current_comment.end_position = m_cursor.position();
-            m_current_comment.insertIfReady(m_cursor);
+            queueComment();
 
             m_xml.skipCurrentElement();
         } else {
@@ -417,7 +473,7 @@ void DocxReader::readParagraph()
             } else if ((m_xml.qualifiedName() == "w:commentRangeEnd")
                        || (m_xml.qualifiedName() == "w:bookmarkEnd")) {
                 m_current_comment.end_position = m_cursor.position();
-                m_current_comment.insertIfReady(m_cursor);
+                queueComment();
 
                 m_xml.skipCurrentElement();
             } else if (m_xml.tokenType() != QXmlStreamReader::EndElement) {
@@ -432,7 +488,26 @@ void DocxReader::readParagraph()
         m_current_style = m_previous_styles.pop();
     }
 
-    QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
+    updateProgress();
+}
+
+//-----------------------------------------------------------------------------
+
+void DocxReader::updateProgress()
+{
+    //
+    // Сообщаем о прогрессе не на каждый абзац, а с заданным интервалом
+    //
+    if (!m_progress_timer.isValid() || !m_progress_timer.hasExpired(PROGRESS_INTERVAL)) {
+        return;
+    }
+    m_progress_timer.restart();
+
+    if (isCanceled()) {
+        m_xml.raiseError(tr("Import canceled."));
+        return;
+    }
+    reportProgress(m_xml.characterOffset(), m_document_size);
 }
 
 //-----------------------------------------------------------------------------
@@ -556,11 +631,8 @@ void DocxReader::readRun()
                 m_cursor.insertText(QChar(0x2013), m_current_style.char_format);
                 m_xml.skipCurrentElement();
             } else if (m_xml.qualifiedName() == "w:commentReference") {
-                const QString comment_id = m_xml.attributes().value("w:id").toString();
-                m_current_comment.text = m_comments.value(comment_id).text;
-                m_current_comment.author = m_comments.value(comment_id).author;
-                m_current_comment.date = m_comments.value(comment_id).date;
-                m_current_comment.insertIfReady(m_cursor);
+                m_current_comment.id = m_xml.attributes().value("w:id").toString();
+                queueComment();
                 m_xml.skipCurrentElement();
             } else if (m_xml.tokenType() != QXmlStreamReader::EndElement) {
                 m_xml.skipCurrentElement();
@@ -691,3 +763,36 @@ void DocxReader::readText()
 
 //-----------------------------------------------------------------------------
 
+void DocxReader::queueComment()
+{
+    //
+    // Текст комментариев может быть ещё не прочитан, поэтому запоминаем только их положение
+    //
+    if (m_current_comment.start_position != -1
+        && m_current_comment.end_position != -1
+        && !m_current_comment.id.isEmpty()) {
+        m_pending_comments.append(m_current_comment);
+    }
+}
+
+//-----------------------------------------------------------------------------
+
+void DocxReader::insertComments()
+{
+    if (m_pending_comments.isEmpty()) {
+        return;
+    }
+
+    m_cursor.joinPreviousEditBlock();
+    for (Comment comment : m_pending_comments) {
+        const Comment source = m_comments.value(comment.id);
+        comment.text = source.text;
+        comment.author = source.author;
+        comment.date = source.date;
+        comment.insertIfReady(m_cursor);
+    }
+    m_cursor.endEditBlock();
+    m_pending_comments.clear();
+}
+
+//-----------------------------------------------------------------------------
@@ -23,12 +23,17 @@
 #include "format_reader.h"
 
 #include <QCoreApplication>
+#include <QElapsedTimer>
 #include <QHash>
+#include <QList>
+#include <QScopedPointer>
 #include <QStack>
 #include <QTextBlockFormat>
 #include <QTextCharFormat>
 #include <QXmlStreamReader>
 
+class QtZipReader;
+
 class DocxReader : public FormatReader
 {
 	Q_DECLARE_TR_FUNCTIONS(DocxReader)
@@ -55,6 +60,7 @@ class DocxReader : public FormatReader
 	public:
 		int start_position;
 		int end_position;
+		QString id;
 		QString text;
 		QString author;
 		QString date;
@@ -66,6 +72,7 @@ class DocxReader : public FormatReader
 		void clear() {
 			start_position = -1;
 			end_position = -1;
+			id.clear();
 			text.clear();
 			author.clear();
 			date.clear();
@@ -75,7 +82,9 @@ class DocxReader : public FormatReader
 	};
 
 public:
-	DocxReader();
+	// Takes ownership of the archive if it was already opened while detecting the format
+	explicit DocxReader(QtZipReader* archive = 0);
+	~DocxReader();
 
 	enum { Type = 4 };
 	int type() const
@@ -97,6 +106,9 @@ private:
 	void readRun();
 	void readRunProperties(Style& style, bool allowstyles = true);
 	void readText();
+	void queueComment();
+	void insertComments();
+	void updateProgress();
 
 private:
 	QXmlStreamReader m_xml;
@@ -107,8 +119,15 @@ private:
 
 	QHash<QString, Comment> m_comments;
 	Comment m_current_comment;
+	QList<Comment> m_pending_comments;
 
 	bool m_in_block;
+
+	// size of the document text being read, progress is measured against it
+	qint64 m_document_size;
+	QElapsedTimer m_progress_timer;
+
+	QScopedPointer<QtZipReader> m_archive;
 };
 
 #endif
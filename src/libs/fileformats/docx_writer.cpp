@@ -22,6 +22,7 @@
 #include "qtzip/QtZipWriter"
 
 #include <QBuffer>
+#include <QScopedPointer>
 #include <QTextBlock>
 #include <QTextBlockFormat>
 #include <QTextCharFormat>
@@ -29,8 +30,26 @@
 
 //-----------------------------------------------------------------------------
 
+namespace {
+	/**
+	 * @brief Размер порции XML, после накопления которой она сжимается в архив
+	 */
+	const int CHUNK_SIZE = 64 * 1024;
+}
+
+//-----------------------------------------------------------------------------
+
 DocxWriter::DocxWriter() :
-	m_strict(false)
+	m_strict(false),
+	m_paragraph_element(QString::fromLatin1("w:p")),
+	m_paragraph_properties_element(QString::fromLatin1("w:pPr")),
+	m_run_element(QString::fromLatin1("w:r")),
+	m_run_properties_element(QString::fromLatin1("w:rPr")),
+	m_text_element(QString::fromLatin1("w:t")),
+	m_tab_element(QString::fromLatin1("w:tab")),
+	m_break_element(QString::fromLatin1("w:br")),
+	m_space_attribute(QString::fromLatin1("xml:space")),
+	m_preserve_value(QString::fromLatin1("preserve"))
 {
 }
 
@@ -62,8 +81,19 @@ bool DocxWriter::write(QIODevice* device, const QTextDocument* document)
 		"<Relationship Target=\"styles.xml\" Id=\"docRId0\" Type=\"http://schemas.openxmlformats.org/officeDocument/2006/relationships/styles\"/>"
 		"</Relationships>");
 
-	zip.addFile(QString::fromLatin1("word/document.xml"),
-		writeDocument(document));
+	//
+	// Текст документа сериализуется прямо в сжимаемый элемент архива,
+	// не собирая его целиком в памяти
+	//
+	QScopedPointer<QIODevice> document_device(zip.fileDevice(QString::fromLatin1("word/document.xml")));
+	if (document_device.isNull()) {
+		return false;
+	}
+	const bool document_written = writeDocument(document_device.data(), document);
+	document_device->close();
+	if (!document_written) {
+		return false;
+	}
 
 	zip.addFile(QString::fromLatin1("word/styles.xml"),
 		"<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>"
@@ -164,10 +194,11 @@ bool DocxWriter::write(QIODevice* device, const QTextDocument* document)
 
 //-----------------------------------------------------------------------------
 
-QByteArray DocxWriter::writeDocument(const QTextDocument* document)
+bool DocxWriter::writeDocument(QIODevice* device, const QTextDocument* document)
 {
-	QByteArray data;
-	QBuffer buffer(&data);
+	m_chunk.reserve(CHUNK_SIZE * 2);
+	m_chunk.resize(0);
+	QBuffer buffer(&m_chunk);
 	buffer.open(QIODevice::WriteOnly);
 	m_xml.setDevice(&buffer);
 	m_xml.setCodec("UTF-8");
@@ -177,44 +208,82 @@ QByteArray DocxWriter::writeDocument(const QTextDocument* document)
 	m_xml.writeStartElement(QString::fromLatin1("w:document"));
 	m_xml.writeStartElement(QString::fromLatin1("w:body"));
 
-	for (QTextBlock block = document->begin(); block.isValid(); block = block.next()) {
+	bool success = true;
+	for (QTextBlock block = document->begin(); success && block.isValid(); block = block.next()) {
 		writeParagraph(block);
+		success = flushDocument(device, CHUNK_SIZE);
 	}
 
 	m_xml.writeEndElement();
 	m_xml.writeEndElement();
 
 	m_xml.writeEndDocument();
+	success = success && flushDocument(device, 0);
+	m_xml.setDevice(0);
 	buffer.close();
 
-	return data;
+	//
+	// Не держим в памяти буфер после выгрузки большого документа
+	//
+	if (m_chunk.capacity() > CHUNK_SIZE * 2) {
+		m_chunk = QByteArray();
+	}
+
+	if (!success) {
+		m_error = device->errorString();
+	}
+	return success;
+}
+
+//-----------------------------------------------------------------------------
+
+bool DocxWriter::flushDocument(QIODevice* device, int threshold)
+{
+	if (m_chunk.size() <= threshold) {
+		return true;
+	}
+
+	const bool success = device->write(m_chunk) == m_chunk.size();
+
+	//
+	// Переиспользуем уже выделенную память буфера для следующей порции
+	//
+	m_chunk.resize(0);
+	QBuffer* buffer = static_cast<QBuffer*>(m_xml.device());
+	buffer->seek(0);
+
+	return success;
 }
 
 //-----------------------------------------------------------------------------
 
 void DocxWriter::writeParagraph(const QTextBlock& block)
 {
-	m_xml.writeStartElement(QString::fromLatin1("w:p"));
+	m_xml.writeStartElement(m_paragraph_element);
 	writeParagraphProperties(block.blockFormat(), block.charFormat());
 
+	//
+	// Текст блока берётся один раз, фрагменты адресуются в нём по смещению
+	//
+	const QString text = block.text();
+	const int block_position = block.position();
 	for (QTextBlock::iterator iter = block.begin(); !(iter.atEnd()); ++iter) {
-		m_xml.writeStartElement(QString::fromLatin1("w:r"));
+		m_xml.writeStartElement(m_run_element);
 
 		QTextFragment fragment = iter.fragment();
 		writeRunProperties(fragment.charFormat());
 
-		QString text = fragment.text();
-		int start = 0;
-		int count = text.length();
-		for (int i = 0; i < count; ++i) {
+		int start = fragment.position() - block_position;
+		int count = start + fragment.length();
+		for (int i = start; i < count; ++i) {
 			QChar c = text.at(i);
 			if (c.unicode() == 0x0009) {
 				writeText(text, start, i);
-				m_xml.writeEmptyElement(QString::fromLatin1("w:tab"));
+				m_xml.writeEmptyElement(m_tab_element);
 				start = i + 1;
 			} else if (c.unicode() == 0x2028) {
 				writeText(text, start, i);
-				m_xml.writeEmptyElement(QString::fromLatin1("w:br"));
+				m_xml.writeEmptyElement(m_break_element);
 				start = i + 1;
 			}
 		}
@@ -231,9 +300,9 @@ void DocxWriter::writeParagraph(const QTextBlock& block)
 void DocxWriter::writeText(const QString& text, int start, int end)
 {
 	if (start < end) {
-		m_xml.writeStartElement(QString::fromLatin1("w:t"));
-		m_xml.writeAttribute(QString::fromLatin1("xml:space"), QString::fromLatin1("preserve"));
-		m_xml.writeCharacters(text.mid(start, end - start));
+		m_xml.writeStartElement(m_text_element);
+		m_xml.writeAttribute(m_space_attribute, m_preserve_value);
+		m_xml.writeCharacters(QString::fromRawData(text.constData() + start, end - start));
 		m_xml.writeEndElement();
 	}
 }
@@ -246,39 +315,39 @@ void DocxWriter::writeParagraphProperties(const QTextBlockFormat& block_format,
 
 	int heading = block_format.property(QTextFormat::UserProperty).toInt();
 	if (heading) {
-		writePropertyElement(QString::fromLatin1("w:pPr"), empty);
+		writePropertyElement(m_paragraph_properties_element, empty);
 		m_xml.writeEmptyElement(QString::fromLatin1("w:pStyle"));
 		m_xml.writeAttribute(QString::fromLatin1("w:val"), QString("Heading%1").arg(heading));
 	}
 
 	bool rtl = block_format.layoutDirection() == Qt::RightToLeft;
 	if (rtl) {
-		writePropertyElement(QString::fromLatin1("w:pPr"), empty);
+		writePropertyElement(m_paragraph_properties_element, empty);
 		m_xml.writeEmptyElement(QString::fromLatin1("w:textDirection"));
 		m_xml.writeAttribute(QString::fromLatin1("w:val"), QString::fromLatin1("rl"));
 	}
 
 	Qt::Alignment align = block_format.alignment();
 	if (rtl && (align & Qt::AlignLeft)) {
-		writePropertyElement(QString::fromLatin1("w:pPr"), empty);
+		writePropertyElement(m_paragraph_properties_element, empty);
 		m_xml.writeEmptyElement(QString::fromLatin1("w:jc"));
 		m_xml.writeAttribute(QString::fromLatin1("w:val"), m_strict ? QString::fromLatin1("start") : QString::fromLatin1("left"));
 	} else if (align & Qt::AlignRight) {
-		writePropertyElement(QString::fromLatin1("w:pPr"), empty);
+		writePropertyElement(m_paragraph_properties_element, empty);
 		m_xml.writeEmptyElement(QString::fromLatin1("w:jc"));
 		m_xml.writeAttribute(QString::fromLatin1("w:val"), m_strict ? QString::fromLatin1("end") : QString::fromLatin1("right"));
 	} else if (align & Qt::AlignCenter) {
-		writePropertyElement(QString::fromLatin1("w:pPr"), empty);
+		writePropertyElement(m_paragraph_properties_element, empty);
 		m_xml.writeEmptyElement(QString::fromLatin1("w:jc"));
 		m_xml.writeAttribute(QString::fromLatin1("w:val"), QString::fromLatin1("center"));
 	} else if (align & Qt::AlignJustify) {
-		writePropertyElement(QString::fromLatin1("w:pPr"), empty);
+		writePropertyElement(m_paragraph_properties_element, empty);
 		m_xml.writeEmptyElement(QString::fromLatin1("w:jc"));
 		m_xml.writeAttribute(QString::fromLatin1("w:val"), QString::fromLatin1("both"));
 	}
 
 	if (block_format.indent() > 0) {
-		writePropertyElement(QString::fromLatin1("w:pPr"), empty);
+		writePropertyElement(m_paragraph_properties_element, empty);
 		m_xml.writeEmptyElement(QString::fromLatin1("w:ind"));
 		QString indent = QString::number(block_format.indent() * 720);
 		if (m_strict) {
@@ -290,7 +359,7 @@ void DocxWriter::writeParagraphProperties(const QTextBlockFormat& block_format,
 		}
 	}
 
-	empty &= writeRunProperties(char_format, QString::fromLatin1("w:pPr"));
+	empty &= writeRunProperties(char_format, m_paragraph_properties_element);
 
 	if (!empty) {
 		m_xml.writeEndElement();
@@ -304,32 +373,32 @@ bool DocxWriter::writeRunProperties(const QTextCharFormat& char_format, const QS
 	bool empty = true;
 
 	if (char_format.fontWeight() == QFont::Bold) {
-		writePropertyElement(QString::fromLatin1("w:rPr"), parent_element, empty);
+		writePropertyElement(m_run_properties_element, parent_element, empty);
 		m_xml.writeEmptyElement(QString::fromLatin1("w:b"));
 	}
 
 	if (char_format.fontItalic()) {
-		writePropertyElement(QString::fromLatin1("w:rPr"), parent_element, empty);
+		writePropertyElement(m_run_properties_element, parent_element, empty);
 		m_xml.writeEmptyElement(QString::fromLatin1("w:i"));
 	}
 
 	if (char_format.fontUnderline()) {
-		writePropertyElement(QString::fromLatin1("w:rPr"), parent_element, empty);
+		writePropertyElement(m_run_properties_element, parent_element, empty);
 		m_xml.writeEmptyElement(QString::fromLatin1("w:u"));
 		m_xml.writeAttribute(QString::fromLatin1("w:val"), QString::fromLatin1("single"));
 	}
 
 	if (char_format.fontStrikeOut()) {
-		writePropertyElement(QString::fromLatin1("w:rPr"), parent_element, empty);
+		writePropertyElement(m_run_properties_element, parent_element, empty);
 		m_xml.writeEmptyElement(QString::fromLatin1("w:strike"));
 	}
 
 	if (char_format.verticalAlignment() == QTextCharFormat::AlignSuperScript) {
-		writePropertyElement(QString::fromLatin1("w:rPr"), parent_element, empty);
+		writePropertyElement(m_run_properties_element, parent_element, empty);
 		m_xml.writeEmptyElement(QString::fromLatin1("w:vertAlign"));
 		m_xml.writeAttribute(QString::fromLatin1("w:val"), QString::fromLatin1("superscript"));
 	} else if (char_format.verticalAlignment() == QTextCharFormat::AlignSubScript) {
-		writePropertyElement(QString::fromLatin1("w:rPr"), parent_element, empty);
+		writePropertyElement(m_run_properties_element, parent_element, empty);
 		m_xml.writeEmptyElement(QString::fromLatin1("w:vertAlign"));
 		m_xml.writeAttribute(QString::fromLatin1("w:val"), QString::fromLatin1("subscript"));
 	}
@@ -45,9 +45,10 @@ public:
 	bool write(QIODevice* device, const QTextDocument* document);
 
 private:
-	QByteArray writeDocument(const QTextDocument* document);
+	bool writeDocument(QIODevice* device, const QTextDocument* document);
 	void writeParagraph(const QTextBlock& block);
 	void writeText(const QString& text, int start, int end);
+	bool flushDocument(QIODevice* device, int threshold);
 	void writeParagraphProperties(const QTextBlockFormat& block_format, const QTextCharFormat& char_format);
 	bool writeRunProperties(const QTextCharFormat& char_format, const QString& parent_element = QString());
 	void writePropertyElement(const QString& element, bool& empty);
@@ -57,6 +58,20 @@ private:
 	QXmlStreamWriter m_xml;
 	bool m_strict;
 	QString m_error;
+
+	// XML is collected in a reusable chunk and then written into the zip entry
+	QByteArray m_chunk;
+
+	// element names used for every paragraph and run
+	const QString m_paragraph_element;
+	const QString m_paragraph_properties_element;
+	const QString m_run_element;
+	const QString m_run_properties_element;
+	const QString m_text_element;
+	const QString m_tab_element;
+	const QString m_break_element;
+	const QString m_space_attribute;
+	const QString m_preserve_value;
 };
 
 #endif
@@ -7,6 +7,7 @@ DEFINES += FILEFORMATS_LIBRARY
 # Build configuration
 #
 CONFIG += qt thread warn_on staticlib
+QT += concurrent
 
 #
 # Конфигурируем расположение файлов сборки
@@ -24,47 +24,173 @@
 #include "rtf_reader.h"
 #include "txt_reader.h"
 
+#include "qtzip/QtZipReader"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
 #include <QStringList>
+#include <QTextDocument>
+#include <QThread>
+#include <QThreadStorage>
+#include <QtConcurrentMap>
+
+namespace {
+	enum Format {
+		OdtFormat,
+		DocxFormat,
+		RtfFormat,
+		TxtFormat
+	};
+
+	struct ReaderHandlers
+	{
+		std::function<void(int)> progress;
+		std::function<bool()> canceled;
+	};
+
+	QThreadStorage<ReaderHandlers> reader_handlers;
+
+	// Detects the format from the contents in one pass. For archives the header and
+	// the central directory are read once, and the opened archive is returned in
+	// archive so the reader doesn't parse it again.
+	Format detectFormat(QIODevice* device, const QString& type, QScopedPointer<QtZipReader>& archive)
+	{
+		// ODT stores an uncompressed mimetype as its first entry
+		static const QByteArray odt_mimetype("mimetypeapplication/vnd.oasis.opendocument.text");
+		const QByteArray header = device->peek(30 + odt_mimetype.size());
+
+		if (header.startsWith("PK\x03\x04")) {
+			if (header.mid(30) == odt_mimetype) {
+				return OdtFormat;
+			}
+
+			archive.reset(new QtZipReader(device));
+			const QStringList files = archive->fileList();
+			if (files.contains(QString::fromLatin1("word/document.xml"))) {
+				return DocxFormat;
+			} else if (files.contains(QString::fromLatin1("content.xml"))) {
+				return OdtFormat;
+			}
+
+			// Unknown archive, trust file extension and then assume Office Open XML as before
+			return (type == "odt") ? OdtFormat : DocxFormat;
+		} else if (header.startsWith("{\\rtf")) {
+			return RtfFormat;
+		}
+		return TxtFormat;
+	}
+
+	// Reads one file into a new document
+	struct ReadFile
+	{
+		typedef FormatManager::ReadResult result_type;
+
+		explicit ReadFile(QThread* target_thread) :
+			m_target_thread(target_thread)
+		{
+		}
+
+		FormatManager::ReadResult operator()(const QString& fileName) const
+		{
+			FormatManager::ReadResult result;
+			result.fileName = fileName;
+
+			QFile file(fileName);
+			if (!file.open(QIODevice::ReadOnly)) {
+				result.error = file.errorString();
+				return result;
+			}
+
+			QTextDocument* document = new QTextDocument;
+			QScopedPointer<FormatReader> reader(FormatManager::createReader(&file, QFileInfo(fileName).suffix().toLower()));
+			reader->read(&file, document);
+			result.error = reader->errorString();
+
+			// Document is built in a pool thread, hand it over to the one waiting for results
+			document->moveToThread(m_target_thread);
+			result.document = QSharedPointer<QTextDocument>(document, &QObject::deleteLater);
+			return result;
+		}
+
+	private:
+		QThread* m_target_thread;
+	};
+}
 
 //-----------------------------------------------------------------------------
 
 FormatReader* FormatManager::createReader(QIODevice* device, const QString& type)
 {
+	QScopedPointer<QtZipReader> archive;
 	FormatReader* reader = 0;
-
-	// Try file extension first
-	if (type == "odt") {
-		if (OdtReader::canRead(device)) {
-			reader = new OdtReader;
-		}
-	} else if (type == "docx") {
-		if (DocxReader::canRead(device)) {
-			reader = new DocxReader;
-		}
-	} else if (type == "rtf") {
-		if (RtfReader::canRead(device)) {
+	switch (detectFormat(device, type, archive)) {
+		case OdtFormat:
+			reader = new OdtReader(archive.take());
+			break;
+		case DocxFormat:
+			reader = new DocxReader(archive.take());
+			break;
+		case RtfFormat:
 			reader = new RtfReader;
-		}
-	}
-
-	// Fall back to finding format from contents
-	if (!reader) {
-		if (OdtReader::canRead(device)) {
-			reader = new OdtReader;
-		} else if (DocxReader::canRead(device)) {
-			reader = new DocxReader;
-		} else if (RtfReader::canRead(device)) {
-			reader = new RtfReader;
-		} else {
+			break;
+		case TxtFormat:
+		default:
 			reader = new TxtReader;
-		}
+			break;
 	}
 
+	if (reader_handlers.hasLocalData()) {
+		const ReaderHandlers& handlers = reader_handlers.localData();
+		reader->setProgressHandler(handlers.progress);
+		reader->setCancelHandler(handlers.canceled);
+	}
 	return reader;
 }
 
 //-----------------------------------------------------------------------------
 
+void FormatManager::setReaderHandlers(const std::function<void(int)>& progress, const std::function<bool()>& canceled)
+{
+	ReaderHandlers handlers;
+	handlers.progress = progress;
+	handlers.canceled = canceled;
+	reader_handlers.setLocalData(handlers);
+}
+
+//-----------------------------------------------------------------------------
+
+void FormatManager::clearReaderHandlers()
+{
+	reader_handlers.setLocalData(ReaderHandlers());
+}
+
+//-----------------------------------------------------------------------------
+
+QFuture<FormatManager::ReadResult> FormatManager::readFiles(const QStringList& fileNames)
+{
+	return QtConcurrent::mapped(fileNames, ReadFile(QThread::currentThread()));
+}
+
+//-----------------------------------------------------------------------------
+
+QFuture<FormatManager::ReadResult> FormatManager::readDirectory(const QString& path)
+{
+	QStringList name_filters;
+	foreach (const QString& type, types()) {
+		name_filters.append(QLatin1String("*.") + type);
+	}
+
+	const QDir dir(path);
+	QStringList fileNames;
+	foreach (const QString& fileName, dir.entryList(name_filters, QDir::Files | QDir::Readable, QDir::Name)) {
+		fileNames.append(dir.absoluteFilePath(fileName));
+	}
+	return readFiles(fileNames);
+}
+
+//-----------------------------------------------------------------------------
+
 QString FormatManager::filter(const QString& type)
 {
 	if (type == "odt") {
@@ -23,16 +23,42 @@
 class FormatReader;
 
 #include <QCoreApplication>
+#include <QFuture>
+#include <QSharedPointer>
 #include <QString>
 
+#include <functional>
+
 class QIODevice;
 class QStringList;
+class QTextDocument;
 
 
 class FormatManager
 {
 public:
+	// Result of reading one file in a batch
+	struct ReadResult
+	{
+		QString fileName;
+		QSharedPointer<QTextDocument> document;
+		QString error;
+	};
+
 	static FormatReader* createReader(QIODevice* device, const QString& type = QString());
+
+	// Handlers given to every reader created on the calling thread, so callers that
+	// don't create readers themselves can still follow progress and cancel reading
+	static void setReaderHandlers(const std::function<void(int)>& progress, const std::function<bool()>& canceled);
+	static void clearReaderHandlers();
+
+	// Reads the files concurrently, each into its own document. The documents belong
+	// to the calling thread. Canceling the future skips the files not started yet.
+	static QFuture<ReadResult> readFiles(const QStringList& fileNames);
+
+	// Reads all supported files of the directory concurrently
+	static QFuture<ReadResult> readDirectory(const QString& path);
+
 	static QString filter(const QString& type);
 	static QStringList filters(const QString& type = QString());
 	static bool isRichText(const QString& filename);
@@ -20,15 +20,23 @@
 #ifndef FORMAT_READER_H
 #define FORMAT_READER_H
 
+#include <QAtomicInt>
 #include <QString>
 #include <QTextCursor>
 
+#include <functional>
+
 class QIODevice;
 class QTextDocument;
 
 class FormatReader
 {
 public:
+	FormatReader() :
+		m_progress(-1)
+	{
+	}
+
 	virtual ~FormatReader()
 	{
 	}
@@ -48,6 +56,29 @@ public:
 		return !m_error.isEmpty();
 	}
 
+	// Receives the percentage of data read, called on the reading thread
+	void setProgressHandler(const std::function<void(int)>& handler)
+	{
+		m_progress_handler = handler;
+	}
+
+	// Polled on the reading thread, reading stops once it returns true
+	void setCancelHandler(const std::function<bool()>& handler)
+	{
+		m_cancel_handler = handler;
+	}
+
+	// Safe to call from any thread
+	void cancel()
+	{
+		m_canceled.storeRelease(1);
+	}
+
+	bool isCanceled() const
+	{
+		return (m_canceled.loadAcquire() != 0) || (m_cancel_handler && m_cancel_handler());
+	}
+
 	void read(QIODevice* device, QTextDocument* document)
 	{
 		m_cursor = QTextCursor(document);
@@ -66,11 +97,30 @@ public:
 		return Type;
 	}
 
+protected:
+	void reportProgress(qint64 done, qint64 total)
+	{
+		if (!m_progress_handler || total <= 0) {
+			return;
+		}
+		const int progress = int(qBound<qint64>(0, done * 100 / total, 100));
+		if (progress != m_progress) {
+			m_progress = progress;
+			m_progress_handler(progress);
+		}
+	}
+
 protected:
 	QTextCursor m_cursor;
 	QString m_error;
 	QByteArray m_encoding;
 
+private:
+	std::function<void(int)> m_progress_handler;
+	std::function<bool()> m_cancel_handler;
+	int m_progress;
+	QAtomicInt m_canceled;
+
 private:
 	virtual void readData(QIODevice* device) = 0;
 };
@@ -21,6 +21,7 @@
 
 #include "qtzip/QtZipReader"
 
+#include <QScopedPointer>
 #include <QTextDocument>
 
 namespace {
@@ -33,14 +34,29 @@ namespace {
 
 //-----------------------------------------------------------------------------
 
-OdtReader::OdtReader() :
-	m_in_block(true)
+namespace {
+	// How often to report progress and check for cancellation, in ms
+	const int PROGRESS_INTERVAL = 100;
+}
+
+//-----------------------------------------------------------------------------
+
+OdtReader::OdtReader(QtZipReader* archive) :
+	m_in_block(true),
+	m_content_size(0),
+	m_archive(archive)
 {
 	m_xml.setNamespaceProcessing(false);
 }
 
 //-----------------------------------------------------------------------------
 
+OdtReader::~OdtReader()
+{
+}
+
+//-----------------------------------------------------------------------------
+
 bool OdtReader::canRead(QIODevice* device)
 {
 	return QtZipReader::canRead(device) &&
@@ -54,24 +70,34 @@ void OdtReader::readData(QIODevice* device)
 	m_in_block = m_cursor.document()->blockCount();
 	m_block_format = m_cursor.blockFormat();
 
-	// Open archive
-	QtZipReader zip(device);
+	// Open archive, unless it was opened already while detecting the format
+	if (m_archive.isNull()) {
+		m_archive.reset(new QtZipReader(device));
+	}
+	QtZipReader& zip = *m_archive;
 
 	// Read archive
 	if (zip.isReadable()) {
 		const QString files[] = { QString::fromLatin1("styles.xml"), QString::fromLatin1("content.xml") };
 		for (int i = 0; i < 2; ++i) {
-			QByteArray data = zip.fileData(files[i]);
-			if (data.isEmpty()) {
+			// Inflate straight into the parser instead of extracting the whole file
+			QScopedPointer<QIODevice> data(zip.fileDevice(files[i]));
+			if (data.isNull() || (data->size() == 0)) {
 				continue;
 			}
-			m_xml.addData(data);
+			// Progress is measured on content only, styles are tiny in comparison
+			m_content_size = (i == 1) ? data->size() : 0;
+			m_progress_timer.start();
+			m_xml.setDevice(data.data());
 			readDocument();
-			if (m_xml.hasError()) {
+			const bool has_error = m_xml.hasError();
+			if (has_error) {
 				m_error = m_xml.errorString();
-				break;
 			}
 			m_xml.clear();
+			if (has_error) {
+				break;
+			}
 		}
 	} else {
 		m_error = tr("Unable to open archive.");
@@ -80,7 +106,9 @@ void OdtReader::readData(QIODevice* device)
 	// Close archive
 	zip.close();
 
-	QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
+	if (!hasError()) {
+		reportProgress(1, 1);
+	}
 }
 
 //-----------------------------------------------------------------------------
@@ -395,7 +423,23 @@ void OdtReader::readParagraph(int level)
 	readText();
 	m_in_block = false;
 
-	QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
+	updateProgress();
+}
+
+//-----------------------------------------------------------------------------
+
+void OdtReader::updateProgress()
+{
+	if (!m_progress_timer.hasExpired(PROGRESS_INTERVAL)) {
+		return;
+	}
+	m_progress_timer.restart();
+
+	if (isCanceled()) {
+		m_xml.raiseError(tr("Import canceled."));
+		return;
+	}
+	reportProgress(m_xml.characterOffset(), m_content_size);
 }
 
 //-----------------------------------------------------------------------------
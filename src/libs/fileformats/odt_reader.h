@@ -23,15 +23,21 @@
 #include "format_reader.h"
 
 #include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QScopedPointer>
 #include <QStack>
 #include <QXmlStreamReader>
 
+class QtZipReader;
+
 class OdtReader : public FormatReader
 {
 	Q_DECLARE_TR_FUNCTIONS(OdtReader)
 
 public:
-	OdtReader();
+	// Takes ownership of the archive if it was already opened while detecting the format
+	explicit OdtReader(QtZipReader* archive = 0);
+	~OdtReader();
 
 	enum { Type = 3 };
 	int type() const
@@ -53,6 +59,7 @@ private:
 	void readParagraph(int level = 0);
 	void readSpan();
 	void readText();
+	void updateProgress();
 
 private:
 	QXmlStreamReader m_xml;
@@ -72,6 +79,12 @@ private:
 	QTextBlockFormat m_block_format;
 
 	bool m_in_block;
+
+	// size of the document text being read, progress is measured against it
+	qint64 m_content_size;
+	QElapsedTimer m_progress_timer;
+
+	QScopedPointer<QtZipReader> m_archive;
 };
 
 #endif
@@ -43,6 +43,10 @@
 #include "qtzipwriter.h"
 #include <QDateTime>
 #include <QDir>
+#include <QFuture>
+#include <QQueue>
+#include <QThreadPool>
+#include <QtConcurrentRun>
 #include <QtDebug>
 #include <QtEndian>
 #include <QtGlobal>
@@ -231,35 +235,6 @@ static int inflate(Bytef *dest, ulong *destLen, const Bytef *source, ulong sourc
 	return err;
 }
 
-static int deflate (Bytef *dest, ulong *destLen, const Bytef *source, ulong sourceLen)
-{
-	z_stream stream;
-	int err;
-
-	stream.next_in = (Bytef*)source;
-	stream.avail_in = (uInt)sourceLen;
-	stream.next_out = dest;
-	stream.avail_out = (uInt)*destLen;
-	if ((uLong)stream.avail_out != *destLen) return Z_BUF_ERROR;
-
-	stream.zalloc = (alloc_func)0;
-	stream.zfree = (free_func)0;
-	stream.opaque = (voidpf)0;
-
-	err = deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
-	if (err != Z_OK) return err;
-
-	err = deflate(&stream, Z_FINISH);
-	if (err != Z_STREAM_END) {
-		deflateEnd(&stream);
-		return err == Z_OK ? Z_BUF_ERROR : err;
-	}
-	*destLen = stream.total_out;
-
-	err = deflateEnd(&stream);
-	return err;
-}
-
 static QFile::Permissions modeToPermissions(quint32 mode)
 {
 	QFile::Permissions ret;
@@ -540,13 +515,160 @@ class QtZipReaderPrivate : public QtZipPrivate
 {
 public:
 	QtZipReaderPrivate(QIODevice *device, bool ownDev)
-		: QtZipPrivate(device, ownDev), status(QtZipReader::NoError)
+		: QtZipPrivate(device, ownDev), status(QtZipReader::NoError), mapped(0), mapTried(false)
 	{
 	}
 
 	void scanFiles();
+	bool findEntryData(const QString &fileName, qint64 *start, int *compressedSize, int *uncompressedSize, int *compressionMethod);
+	const uchar *mappedData();
+	void unmap();
 
 	QtZipReader::Status status;
+	uchar *mapped;
+	bool mapTried;
+};
+
+/*
+	Sequential device that inflates a single archive entry chunk by chunk.
+	Only a fixed size input buffer is kept, the uncompressed data goes straight
+	to the caller's buffer.
+*/
+class QtZipEntryDevice : public QIODevice
+{
+public:
+	QtZipEntryDevice(QIODevice *archive, const uchar *mapped, qint64 start, int compressedSize, int uncompressedSize, bool deflated)
+		: archive(archive), mapped(mapped), position(start), remaining(compressedSize),
+		  uncompressedSize(uncompressedSize), deflated(deflated), initialized(false), finished(false)
+	{
+		stream.next_in = 0;
+		stream.avail_in = 0;
+		stream.zalloc = (alloc_func)0;
+		stream.zfree = (free_func)0;
+		stream.opaque = (voidpf)0;
+		if (deflated) {
+			// when the archive is mapped the compressed data is inflated in place
+			if (mapped) {
+				stream.next_in = (Bytef*)(mapped + position);
+				stream.avail_in = (uInt)remaining;
+				position += remaining;
+				remaining = 0;
+			} else {
+				input.resize(64 * 1024);
+			}
+			initialized = inflateInit2(&stream, -MAX_WBITS) == Z_OK;
+			if (!initialized) {
+				qWarning("QtZip: Failed to initialize inflate stream");
+				finished = true;
+			}
+		} else {
+			// stored entry may have trailing data, never read more than the file itself
+			remaining = qMin(compressedSize, uncompressedSize);
+		}
+	}
+
+	~QtZipEntryDevice()
+	{
+		if (initialized)
+			inflateEnd(&stream);
+	}
+
+	bool isSequential() const
+	{
+		return true;
+	}
+
+	qint64 size() const
+	{
+		return uncompressedSize;
+	}
+
+	bool atEnd() const
+	{
+		return (finished || (!deflated && remaining == 0)) && QIODevice::atEnd();
+	}
+
+protected:
+	qint64 readData(char *data, qint64 maxSize)
+	{
+		if (!deflated) {
+			const qint64 length = qMin(maxSize, remaining);
+			if (length == 0)
+				return 0;
+			if (mapped) {
+				memcpy(data, mapped + position, length);
+				position += length;
+				remaining -= length;
+				return length;
+			}
+			archive->seek(position);
+			const qint64 read = archive->read(data, length);
+			if (read <= 0) {
+				setErrorString(QLatin1String("QtZip: Failed to read entry data"));
+				return -1;
+			}
+			position += read;
+			remaining -= read;
+			return read;
+		}
+
+		if (finished)
+			return 0;
+
+		stream.next_out = (Bytef*)data;
+		stream.avail_out = (uInt)qMin<qint64>(maxSize, 0x7fffffff);
+		const uInt capacity = stream.avail_out;
+		while (stream.avail_out > 0) {
+			if (stream.avail_in == 0 && remaining > 0) {
+				archive->seek(position);
+				const qint64 read = archive->read(input.data(), qMin<qint64>(input.size(), remaining));
+				if (read <= 0) {
+					setErrorString(QLatin1String("QtZip: Failed to read entry data"));
+					return -1;
+				}
+				position += read;
+				remaining -= read;
+				stream.next_in = (Bytef*)input.data();
+				stream.avail_in = (uInt)read;
+			}
+
+			const int res = inflate(&stream, Z_NO_FLUSH);
+			if (res == Z_STREAM_END) {
+				finished = true;
+				break;
+			}
+			if (res == Z_BUF_ERROR && stream.avail_in == 0 && remaining == 0) {
+				qWarning("QtZip: Z_DATA_ERROR: Input data is corrupted");
+				setErrorString(QLatin1String("QtZip: Input data is corrupted"));
+				finished = true;
+				break;
+			}
+			if (res != Z_OK && res != Z_BUF_ERROR) {
+				qWarning("QtZip: Failed to inflate entry data, error %d", res);
+				setErrorString(QLatin1String("QtZip: Failed to inflate entry data"));
+				finished = true;
+				return -1;
+			}
+		}
+		return capacity - stream.avail_out;
+	}
+
+	qint64 writeData(const char *, qint64)
+	{
+		return -1;
+	}
+
+private:
+	QIODevice *archive;
+	const uchar *mapped;
+	qint64 position;
+	qint64 remaining;
+	qint64 uncompressedSize;
+	bool deflated;
+	bool initialized;
+	bool finished;
+	z_stream stream;
+	QByteArray input;
 };
 
 class QtZipWriterPrivate : public QtZipPrivate
@@ -556,13 +678,15 @@ public:
 		: QtZipPrivate(device, ownDev),
 		status(QtZipWriter::NoError),
 		permissions(QFile::ReadOwner | QFile::WriteOwner),
-		compressionPolicy(QtZipWriter::AlwaysCompress)
+		compressionPolicy(QtZipWriter::AlwaysCompress),
+		currentEntry(0)
 	{
 	}
 
 	QtZipWriter::Status status;
 	QFile::Permissions permissions;
 	QtZipWriter::CompressionPolicy compressionPolicy;
+	QIODevice *currentEntry;
 
 	enum EntryType { Directory, File, Symlink };
 
@@ -674,108 +798,328 @@ void QtZipReaderPrivate::scanFiles()
 	}
 }
 
-void QtZipWriterPrivate::addEntry(EntryType type, const QString &fileName, const QByteArray &contents/*, QFile::Permissions permissions, QtZip::Method m*/)
+const uchar *QtZipReaderPrivate::mappedData()
 {
-#ifndef NDEBUG
-	static const char *entryTypes[] = {
-		"directory",
-		"file     ",
-		"symlink  " };
-	ZDEBUG() << "adding" << entryTypes[type] <<":" << fileName.toUtf8().data() << (type == 2 ? QByteArray(" -> " + contents).constData() : "");
-#endif
+	if (mapTried)
+		return mapped;
+
+	mapTried = true;
+	QFile *file = qobject_cast<QFile*>(device);
+	if (file != 0 && file->isOpen() && file->size() > 0)
+		mapped = file->map(0, file->size());
+	return mapped;
+}
 
-	if (! (device->isOpen() || device->open(QIODevice::WriteOnly))) {
-		status = QtZipWriter::FileOpenError;
-		return;
+void QtZipReaderPrivate::unmap()
+{
+	if (mapped) {
+		static_cast<QFile*>(device)->unmap(mapped);
+		mapped = 0;
 	}
-	device->seek(start_of_directory);
+	mapTried = false;
+}
 
-	// don't compress small files
-	QtZipWriter::CompressionPolicy compression = compressionPolicy;
-	if (compressionPolicy == QtZipWriter::AutoCompress) {
-		if (contents.length() < 64)
-			compression = QtZipWriter::NeverCompress;
-		else
-			compression = QtZipWriter::AlwaysCompress;
+bool QtZipReaderPrivate::findEntryData(const QString &fileName, qint64 *start, int *compressedSize, int *uncompressedSize, int *compressionMethod)
+{
+	scanFiles();
+	int i;
+	for (i = 0; i < fileHeaders.size(); ++i) {
+		if (QString::fromLocal8Bit(fileHeaders.at(i).file_name) == fileName)
+			break;
 	}
+	if (i == fileHeaders.size())
+		return false;
 
-	FileHeader header;
-	memset(&header.h, 0, sizeof(CentralFileHeader));
-	writeUInt(header.h.signature, 0x02014b50);
-
-	writeUShort(header.h.version_needed, ZIP_VERSION);
-	writeUInt(header.h.uncompressed_size, contents.length());
-	writeMSDosDate(header.h.last_mod_file, QDateTime::currentDateTime());
-	QByteArray data = contents;
-	if (compression == QtZipWriter::AlwaysCompress) {
-		writeUShort(header.h.compression_method, CompressionMethodDeflated);
-
-	   ulong len = contents.length();
-		// shamelessly copied form zlib
-		len += (len >> 12) + (len >> 14) + 11;
-		int res;
-		do {
-			data.resize(len);
-			res = deflate((uchar*)data.data(), &len, (const uchar*)contents.constData(), contents.length());
-
-			switch (res) {
-			case Z_OK:
-				data.resize(len);
-				break;
-			case Z_MEM_ERROR:
-				qWarning("QtZip: Z_MEM_ERROR: Not enough memory to compress file, skipping");
-				data.resize(0);
-				break;
-			case Z_BUF_ERROR:
-				len *= 2;
-				break;
-			}
-		} while (res == Z_BUF_ERROR);
+	const FileHeader &header = fileHeaders.at(i);
+
+	ushort version_needed = readUShort(header.h.version_needed);
+	if (version_needed > ZIP_VERSION) {
+		qWarning("QtZip: .ZIP specification version %d implementationis needed to extract the data.", version_needed);
+		return false;
 	}
-// TODO add a check if data.length() > contents.length().  Then try to store the original and revert the compression method to be uncompressed
-	writeUInt(header.h.compressed_size, data.length());
-	uint crc_32 = ::crc32(0, 0, 0);
-	crc_32 = ::crc32(crc_32, (const uchar *)contents.constData(), contents.length());
-	writeUInt(header.h.crc_32, crc_32);
 
-	// if bit 11 is set, the filename and comment fields must be encoded using UTF-8
-	ushort general_purpose_bits = Utf8Names; // always use utf-8
-	writeUShort(header.h.general_purpose_bits, general_purpose_bits);
+	ushort general_purpose_bits = readUShort(header.h.general_purpose_bits);
+	*compressedSize = readUInt(header.h.compressed_size);
+	*uncompressedSize = readUInt(header.h.uncompressed_size);
+	int offset = readUInt(header.h.offset_local_header);
 
-	const bool inUtf8 = (general_purpose_bits & Utf8Names) != 0;
-	header.file_name = inUtf8 ? fileName.toUtf8() : fileName.toLocal8Bit();
-	if (header.file_name.size() > 0xffff) {
-		qWarning("QtZip: Filename is too long, chopping it to 65535 bytes");
-		header.file_name = header.file_name.left(0xffff); // ### don't break the utf-8 sequence, if any
+	if (*compressedSize < 0 || *uncompressedSize < 0 || offset < 0) {
+		qWarning("QtZip: Entry sizes or offset are out of the supported range.");
+		return false;
+	}
+
+	LocalFileHeader lh;
+	if (!device->seek(offset) || device->read((char *)&lh, sizeof(LocalFileHeader)) != sizeof(LocalFileHeader)) {
+		qWarning("QtZip: Failed to read the local file header.");
+		return false;
+	}
+	uint skip = readUShort(lh.file_name_length) + readUShort(lh.extra_field_length);
+	*start = device->pos() + skip;
+	*compressionMethod = readUShort(lh.compression_method);
+
+	if ((general_purpose_bits & Encrypted) != 0) {
+		qWarning("QtZip: Unsupported encryption method is needed to extract the data.");
+		return false;
+	}
+
+	// the sizes come from the central directory, the entry data must fit into the archive
+	// because the mapped archive is read without any further checks
+	if (*start < 0 || *start + *compressedSize > device->size()) {
+		qWarning("QtZip: Entry data is out of the archive bounds.");
+		return false;
+	}
+
+	return true;
+}
+
+/*
+	Deflates one block of an entry as an independent raw deflate stream, primed
+	with the tail of the previous block. Every block but the last one ends on a
+	byte boundary without the final bit set, so the compressed blocks can simply
+	be concatenated, the same way pigz does it.
+*/
+static QByteArray deflateBlock(const QByteArray &block, const QByteArray &dictionary, bool last)
+{
+	z_stream stream;
+	memset(&stream, 0, sizeof(z_stream));
+	if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+		return QByteArray();
+	if (!dictionary.isEmpty())
+		deflateSetDictionary(&stream, (const Bytef*)dictionary.constData(), dictionary.size());
+
+	QByteArray data;
+	data.resize(int(deflateBound(&stream, block.size())) + 16);
+	stream.next_in = (Bytef*)block.constData();
+	stream.avail_in = block.size();
+	const int flush = last ? Z_FINISH : Z_SYNC_FLUSH;
+	forever {
+		stream.next_out = (Bytef*)data.data() + stream.total_out;
+		stream.avail_out = data.size() - stream.total_out;
+		const int res = deflate(&stream, flush);
+		if (res == Z_STREAM_ERROR) {
+			deflateEnd(&stream);
+			return QByteArray();
+		}
+		if (last ? (res == Z_STREAM_END) : (stream.avail_in == 0 && stream.avail_out != 0))
+			break;
+		data.resize(data.size() * 2);
+	}
+	data.resize(stream.total_out);
+	deflateEnd(&stream);
+	return data;
+}
+
+/*
+	Sequential device which writes a single archive entry. Written data is cut
+	into blocks which are deflated on the global thread pool, while the number
+	of blocks in flight is bounded, so memory use doesn't depend on entry size.
+	The local header is written up front and patched with the real sizes and
+	checksum when the device is closed.
+*/
+class QtZipEntryWriter : public QIODevice
+{
+public:
+	QtZipEntryWriter(QtZipWriterPrivate *d, QtZipWriterPrivate::EntryType type, const QString &fileName)
+		: d(d), type(type), fileName(fileName), compressed(false), crc(0), size(0), compressedSize(0),
+		  maxPendingBlocks(qMax(2, QThreadPool::globalInstance()->maxThreadCount() * 2))
+	{
+	}
+
+	~QtZipEntryWriter()
+	{
+		if (isOpen())
+			close();
 	}
-	if (header.file_comment.size() + header.file_name.size() > 0xffff) {
-		qWarning("QtZip: File comment is too long, chopping it to 65535 bytes");
-		header.file_comment.truncate(0xffff - header.file_name.size()); // ### don't break the utf-8 sequence, if any
+
+	bool isSequential() const
+	{
+		return true;
 	}
-	writeUShort(header.h.file_name_length, header.file_name.length());
-	//h.extra_field_length[2];
-
-	writeUShort(header.h.version_made, HostUnix << 8);
-	//uchar internal_file_attributes[2];
-	//uchar external_file_attributes[4];
-	quint32 mode = permissionsToMode(permissions);
-	switch (type) {
-		case File: mode |= S_IFREG; break;
-		case Directory: mode |= S_IFDIR; break;
-		case Symlink: mode |= S_IFLNK; break;
+
+	bool open(OpenMode mode)
+	{
+		// entries are written one after another, so a streamed entry that is still open is finished first
+		if (d->currentEntry != 0 && d->currentEntry != this)
+			d->currentEntry->close();
+
+		if (! (d->device->isOpen() || d->device->open(QIODevice::WriteOnly))) {
+			d->status = QtZipWriter::FileOpenError;
+			return false;
+		}
+		d->device->seek(d->start_of_directory);
+
+		// small entries are decided on when closing, they always fit into the first block
+		compressed = d->compressionPolicy != QtZipWriter::NeverCompress;
+		crc = ::crc32(0, 0, 0);
+		size = 0;
+		compressedSize = 0;
+
+		memset(&header.h, 0, sizeof(CentralFileHeader));
+		writeUInt(header.h.signature, 0x02014b50);
+		writeUShort(header.h.version_needed, ZIP_VERSION);
+		writeMSDosDate(header.h.last_mod_file, QDateTime::currentDateTime());
+
+		// if bit 11 is set, the filename and comment fields must be encoded using UTF-8
+		ushort general_purpose_bits = Utf8Names; // always use utf-8
+		writeUShort(header.h.general_purpose_bits, general_purpose_bits);
+
+		const bool inUtf8 = (general_purpose_bits & Utf8Names) != 0;
+		header.file_name = inUtf8 ? fileName.toUtf8() : fileName.toLocal8Bit();
+		if (header.file_name.size() > 0xffff) {
+			qWarning("QtZip: Filename is too long, chopping it to 65535 bytes");
+			header.file_name = header.file_name.left(0xffff); // ### don't break the utf-8 sequence, if any
+		}
+		if (header.file_comment.size() + header.file_name.size() > 0xffff) {
+			qWarning("QtZip: File comment is too long, chopping it to 65535 bytes");
+			header.file_comment.truncate(0xffff - header.file_name.size()); // ### don't break the utf-8 sequence, if any
+		}
+		writeUShort(header.h.file_name_length, header.file_name.length());
+		//h.extra_field_length[2];
+
+		writeUShort(header.h.version_made, HostUnix << 8);
+		//uchar internal_file_attributes[2];
+		//uchar external_file_attributes[4];
+		quint32 fileMode = permissionsToMode(d->permissions);
+		switch (type) {
+			case QtZipWriterPrivate::File: fileMode |= S_IFREG; break;
+			case QtZipWriterPrivate::Directory: fileMode |= S_IFDIR; break;
+			case QtZipWriterPrivate::Symlink: fileMode |= S_IFLNK; break;
+		}
+		writeUInt(header.h.external_file_attributes, fileMode << 16);
+		writeUInt(header.h.offset_local_header, d->start_of_directory);
+
+		LocalFileHeader h = header.h.toLocalHeader();
+		d->device->write((const char *)&h, sizeof(LocalFileHeader));
+		d->device->write(header.file_name);
+
+		d->currentEntry = this;
+		return QIODevice::open(mode | QIODevice::Unbuffered);
+	}
+
+	void close()
+	{
+		if (!isOpen())
+			return;
+
+		// don't compress small files
+		if (d->compressionPolicy == QtZipWriter::AutoCompress && pendingBlocks.isEmpty() && compressedSize == 0
+			&& block.size() < 64)
+			compressed = false;
+
+		if (compressed) {
+			// the last block is usually the only one, so there is no point to hand it to the pool
+			const QByteArray data = deflateBlock(block, dictionary, true);
+			writeCompressedBlocks(0);
+			writeBlock(data);
+		} else {
+			writeBlock(block);
+		}
+		block.clear();
+		dictionary.clear();
+
+		// patch the local header with the real sizes
+		writeUShort(header.h.compression_method, compressed ? CompressionMethodDeflated : CompressionMethodStored);
+		writeUInt(header.h.crc_32, crc);
+		writeUInt(header.h.uncompressed_size, size);
+		writeUInt(header.h.compressed_size, compressedSize);
+		const qint64 end = d->device->pos();
+		LocalFileHeader h = header.h.toLocalHeader();
+		d->device->seek(readUInt(header.h.offset_local_header));
+		d->device->write((const char *)&h, sizeof(LocalFileHeader));
+		d->device->seek(end);
+
+		d->fileHeaders.append(header);
+		d->start_of_directory = end;
+		d->currentEntry = 0;
+
+		QIODevice::close();
+	}
+
+protected:
+	qint64 readData(char *, qint64)
+	{
+		return -1;
+	}
+
+	qint64 writeData(const char *data, qint64 length)
+	{
+		crc = ::crc32(crc, (const uchar *)data, length);
+		size += length;
+
+		if (!compressed) {
+			writeBlock(QByteArray::fromRawData(data, length));
+			return length;
+		}
+
+		qint64 written = 0;
+		while (written < length) {
+			const qint64 chunk = qMin<qint64>(length - written, BlockSize - block.size());
+			block.append(data + written, chunk);
+			written += chunk;
+			if (block.size() == BlockSize) {
+				// keep the number of blocks in flight bounded
+				writeCompressedBlocks(maxPendingBlocks - 1);
+				pendingBlocks.enqueue(QtConcurrent::run(deflateBlock, block, dictionary, false));
+				dictionary = block.right(DictionarySize);
+				block.clear();
+			}
+		}
+		return length;
+	}
+
+private:
+	enum {
+		BlockSize = 128 * 1024,
+		DictionarySize = 32 * 1024
+	};
+
+	void writeCompressedBlocks(int keepPending)
+	{
+		while (pendingBlocks.size() > keepPending)
+			writeBlock(pendingBlocks.dequeue().result());
+	}
+
+	void writeBlock(const QByteArray &data)
+	{
+		if (compressed && data.isEmpty()) {
+			qWarning("QtZip: Failed to compress file data");
+			d->status = QtZipWriter::FileError;
+			return;
+		}
+		if (d->device->write(data) != data.size())
+			d->status = QtZipWriter::FileWriteError;
+		compressedSize += data.size();
 	}
-	writeUInt(header.h.external_file_attributes, mode << 16);
-	writeUInt(header.h.offset_local_header, start_of_directory);
 
+	QtZipWriterPrivate *d;
+	QtZipWriterPrivate::EntryType type;
+	QString fileName;
+	FileHeader header;
+	bool compressed;
+	uint crc;
+	qint64 size;
+	qint64 compressedSize;
+	const int maxPendingBlocks;
+	QByteArray block;
+	QByteArray dictionary;
+	QQueue<QFuture<QByteArray> > pendingBlocks;
+};
 
-	fileHeaders.append(header);
+void QtZipWriterPrivate::addEntry(EntryType type, const QString &fileName, const QByteArray &contents/*, QFile::Permissions permissions, QtZip::Method m*/)
+{
+#ifndef NDEBUG
+	static const char *entryTypes[] = {
+		"directory",
+		"file     ",
+		"symlink  " };
+	ZDEBUG() << "adding" << entryTypes[type] <<":" << fileName.toUtf8().data() << (type == 2 ? QByteArray(" -> " + contents).constData() : "");
+#endif
 
-	LocalFileHeader h = header.h.toLocalHeader();
-	device->write((const char *)&h, sizeof(LocalFileHeader));
-	device->write(header.file_name);
-	device->write(data);
-	start_of_directory = device->pos();
-	dirtyFileTree = true;
+	QtZipEntryWriter entry(this, type, fileName);
+	if (!entry.open(QIODevice::WriteOnly))
+		return;
+	entry.write(contents);
+	entry.close();
 }
 
 //////////////////////////////  Reader
@@ -977,82 +1321,65 @@ QtZipReader::FileInfo QtZipReader::entryInfoAt(int index) const
 */
 QByteArray QtZipReader::fileData(const QString &fileName) const
 {
-	d->scanFiles();
-	int i;
-	for (i = 0; i < d->fileHeaders.size(); ++i) {
-		if (QString::fromLocal8Bit(d->fileHeaders.at(i).file_name) == fileName)
-			break;
-	}
-	if (i == d->fileHeaders.size())
-		return QByteArray();
-
-	FileHeader header = d->fileHeaders.at(i);
-
-	ushort version_needed = readUShort(header.h.version_needed);
-	if (version_needed > ZIP_VERSION) {
-		qWarning("QtZip: .ZIP specification version %d implementationis needed to extract the data.", version_needed);
+	QScopedPointer<QIODevice> entry(fileDevice(fileName));
+	if (entry.isNull())
 		return QByteArray();
-	}
 
-	ushort general_purpose_bits = readUShort(header.h.general_purpose_bits);
-	int compressed_size = readUInt(header.h.compressed_size);
-	int uncompressed_size = readUInt(header.h.uncompressed_size);
-	int start = readUInt(header.h.offset_local_header);
-	//qDebug("uncompressing file %d: local header at %d", i, start);
-
-	d->device->seek(start);
-	LocalFileHeader lh;
-	d->device->read((char *)&lh, sizeof(LocalFileHeader));
-	uint skip = readUShort(lh.file_name_length) + readUShort(lh.extra_field_length);
-	d->device->seek(d->device->pos() + skip);
-
-	int compression_method = readUShort(lh.compression_method);
-	//qDebug("file=%s: compressed_size=%d, uncompressed_size=%d", fileName.toLocal8Bit().data(), compressed_size, uncompressed_size);
-
-	if ((general_purpose_bits & Encrypted) != 0) {
-		qWarning("QtZip: Unsupported encryption method is needed to extract the data.");
-		return QByteArray();
+	// the size from the directory is only a hint, grow the buffer if it lies
+	// and never trust it with a huge allocation up front
+	static const qint64 maxSizeHint = 16 * 1024 * 1024;
+	QByteArray data;
+	data.resize(int(qBound<qint64>(1, entry->size(), maxSizeHint)));
+	qint64 total = 0;
+	forever {
+		if (total == data.size()) {
+			char extra;
+			const qint64 read = entry->read(&extra, 1);
+			if (read < 0)
+				return QByteArray();
+			if (read == 0)
+				break;
+			data.resize(data.size() * 2);
+			data[int(total++)] = extra;
+			continue;
+		}
+		const qint64 read = entry->read(data.data() + total, data.size() - total);
+		if (read < 0)
+			return QByteArray();
+		if (read == 0)
+			break;
+		total += read;
 	}
+	data.truncate(total);
+	return data;
+}
 
-	//qDebug("file at %lld", d->device->pos());
-	QByteArray compressed = d->device->read(compressed_size);
-	if (compression_method == CompressionMethodStored) {
-		// no compression
-		compressed.truncate(uncompressed_size);
-		return compressed;
-	} else if (compression_method == CompressionMethodDeflated) {
-		// Deflate
-		//qDebug("compressed=%d", compressed.size());
-		compressed.truncate(compressed_size);
-		QByteArray baunzip;
-		ulong len = qMax(uncompressed_size,  1);
-		int res;
-		do {
-			baunzip.resize(len);
-			res = inflate((uchar*)baunzip.data(), &len,
-						  (uchar*)compressed.constData(), compressed_size);
-
-			switch (res) {
-			case Z_OK:
-				if ((int)len != baunzip.size())
-					baunzip.resize(len);
-				break;
-			case Z_MEM_ERROR:
-				qWarning("QtZip: Z_MEM_ERROR: Not enough memory");
-				break;
-			case Z_BUF_ERROR:
-				len *= 2;
-				break;
-			case Z_DATA_ERROR:
-				qWarning("QtZip: Z_DATA_ERROR: Input data is corrupted");
-				break;
-			}
-		} while (res == Z_BUF_ERROR);
-		return baunzip;
+/*!
+	Returns a sequential device which inflates the contents of \a fileName
+	from the zip archive chunk by chunk, or 0 if the file can't be extracted.
+	The whole file is never held in memory, so the device can be fed straight
+	into a QXmlStreamReader. If the archive is a local file it is memory-mapped
+	and inflated in place, otherwise it is read through a small fixed buffer.
+	The caller takes ownership of the device, which must not outlive the reader.
+*/
+QIODevice* QtZipReader::fileDevice(const QString &fileName) const
+{
+	qint64 start = 0;
+	int compressed_size = 0;
+	int uncompressed_size = 0;
+	int compression_method = 0;
+	if (!d->findEntryData(fileName, &start, &compressed_size, &uncompressed_size, &compression_method))
+		return 0;
+
+	if (compression_method != CompressionMethodStored && compression_method != CompressionMethodDeflated) {
+		qWarning("QtZip: Unsupported compression method %d is needed to extract the data.", compression_method);
+		return 0;
 	}
 
-	qWarning("QtZip: Unsupported compression method %d is needed to extract the data.", compression_method);
-	return QByteArray();
+	QtZipEntryDevice *entry = new QtZipEntryDevice(d->device, d->mappedData(), start, compressed_size, uncompressed_size,
+		compression_method == CompressionMethodDeflated);
+	entry->open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+	return entry;
 }
 
 /*!
@@ -1136,6 +1463,7 @@ QtZipReader::Status QtZipReader::status() const
 */
 void QtZipReader::close()
 {
+	d->unmap();
 	d->device->close();
 }
 
@@ -1331,8 +1659,8 @@ void QtZipWriter::addFile(const QString &fileName, const QByteArray &data)
 
 /*!
 	Add a file to the archive with \a device as the source of the contents.
-	The contents returned from QIODevice::readAll() will be used as the
-	filedata.
+	The contents of the device are read and compressed in chunks until
+	the end of the device is reached.
 	The file will be stored in the archive using the \a fileName which
 	includes the full path in the archive.
 */
@@ -1348,11 +1676,41 @@ void QtZipWriter::addFile(const QString &fileName, QIODevice *device)
 			return;
 		}
 	}
-	d->addEntry(QtZipWriterPrivate::File, QDir::fromNativeSeparators(fileName), device->readAll());
+	QtZipEntryWriter entry(d, QtZipWriterPrivate::File, QDir::fromNativeSeparators(fileName));
+	if (entry.open(QIODevice::WriteOnly)) {
+		char buffer[64 * 1024];
+		qint64 read;
+		while ((read = device->read(buffer, sizeof(buffer))) > 0)
+			entry.write(buffer, read);
+		entry.close();
+	}
 	if (opened)
 		device->close();
 }
 
+/*!
+	Returns a device through which the contents of a new file are written
+	to the archive, without having to keep the whole file in memory.
+	The file will be stored in the archive using the \a fileName which
+	includes the full path in the archive, with the current creation
+	permissions and compression policy. Large files are compressed in
+	parallel blocks.
+
+	The file is complete when the device is closed or deleted. Adding
+	another file or directory, or calling close(), closes the device if it
+	is still open. The caller takes ownership of the device.
+	Returns 0 if the archive can't be written.
+*/
+QIODevice* QtZipWriter::fileDevice(const QString &fileName)
+{
+	QtZipEntryWriter *entry = new QtZipEntryWriter(d, QtZipWriterPrivate::File, QDir::fromNativeSeparators(fileName));
+	if (!entry->open(QIODevice::WriteOnly)) {
+		delete entry;
+		return 0;
+	}
+	return entry;
+}
+
 /*!
 	Create a new directory in the archive with the specified \a dirName and
 	the \a permissions;
@@ -1381,6 +1739,9 @@ void QtZipWriter::addSymLink(const QString &fileName, const QString &destination
 */
 void QtZipWriter::close()
 {
+	if (d->currentEntry != 0)
+		d->currentEntry->close();
+
 	if (!(d->device->openMode() & QIODevice::WriteOnly)) {
 		d->device->close();
 		return;
@@ -93,6 +93,11 @@ public:
 		(reader->*m_insert_text_func)(text);
 	}
 
+	bool insertsDocumentText() const
+	{
+		return m_insert_text_func == &RtfReader::insertText;
+	}
+
 	bool isEmpty() const
 	{
 		return m_functions.isEmpty();
@@ -153,6 +158,8 @@ RtfReader::RtfReader() :
 	m_codec(0),
 	m_decoder(0)
 {
+	m_pending_text.reserve(8192);
+
 	if (functions.isEmpty()) {
 		functions.setInsertText(&RtfReader::insertText);
 
@@ -332,6 +339,9 @@ void RtfReader::readData(QIODevice* device)
 		// Open file
 		m_cursor.beginEditBlock();
 		m_token.setDevice(device);
+		m_token.setProgressHandler([this](int progress) {
+			reportProgress(progress, 100);
+		});
 
 		// Check file type
 		m_token.readNext();
@@ -347,8 +357,17 @@ void RtfReader::readData(QIODevice* device)
 
 		// Parse file contents
 		while (!m_states.isEmpty() && m_token.hasNext()) {
+			if (isCanceled()) {
+				throw tr("Import canceled.");
+			}
+
 			m_token.readNext();
 
+			// Decode pending text in one piece before any token that may change formatting or encoding
+			if (m_token.type() != TextToken && m_token.hex().isEmpty()) {
+				flushText();
+			}
+
 			if ((m_token.type() != EndGroupToken) && !m_in_block) {
 				m_cursor.insertBlock(m_state.block_format);
 				m_in_block = true;
@@ -365,13 +384,21 @@ void RtfReader::readData(QIODevice* device)
 				}
 			} else if (m_token.type() == TextToken) {
 				if (!m_state.ignore_text) {
-					m_state.functions->insertText(this, m_decoder->toUnicode(m_token.text()));
+					if (m_state.functions->insertsDocumentText()) {
+						m_pending_text.append(m_token.text());
+					} else {
+						flushText();
+						m_state.functions->insertText(this, m_decoder->toUnicode(m_token.text()));
+					}
 				}
 			}
 		}
+		flushText();
 	} catch (const QString& error) {
 		m_error = error;
 	}
+	m_pending_text.resize(0);
+	m_token.setDevice(0);
 	m_cursor.endEditBlock();
 }
 
@@ -399,9 +426,19 @@ void RtfReader::ignoreText(qint32)
 
 //-----------------------------------------------------------------------------
 
+void RtfReader::flushText()
+{
+	if (!m_pending_text.isEmpty()) {
+		m_cursor.insertText(m_decoder->toUnicode(m_pending_text));
+		m_pending_text.resize(0);
+	}
+}
+
+//-----------------------------------------------------------------------------
+
 void RtfReader::insertHexSymbol(qint32)
 {
-	m_cursor.insertText(m_decoder->toUnicode(m_token.hex()));
+	m_pending_text.append(m_token.hex());
 }
 
 //-----------------------------------------------------------------------------
@@ -49,6 +49,7 @@ public:
 
 private:
 	void readData(QIODevice* device);
+	void flushText();
 	void endBlock(qint32);
 	void ignoreGroup(qint32);
 	void ignoreText(qint32);
@@ -120,6 +121,9 @@ private:
 
 	QTextCodec* m_codec;
 	QTextDecoder* m_decoder;
+
+	// Text and hex characters that are not decoded and inserted yet
+	QByteArray m_pending_text;
 	QTextCodec* m_codepage;
 	QVector<QTextCodec*> m_codepages;
 };
@@ -24,26 +24,74 @@
 
 #include "rtf_tokenizer.h"
 
-#include <QCoreApplication>
+#include <QFileDevice>
 #include <QIODevice>
 
+#include <climits>
+#include <cstring>
+
+namespace {
+	// Read buffer size for devices that can't be memory-mapped
+	const int BUFFER_SIZE = 64 * 1024;
+
+	// How often progress is checked in a mapped file
+	const int PROGRESS_STEP = 64 * 1024;
+
+	inline bool isLetter(char c)
+	{
+		return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+	}
+
+	inline bool isDigit(char c)
+	{
+		return c >= '0' && c <= '9';
+	}
+
+	inline int hexDigit(char c)
+	{
+		if (c >= '0' && c <= '9') {
+			return c - '0';
+		} else if (c >= 'a' && c <= 'f') {
+			return c - 'a' + 10;
+		} else if (c >= 'A' && c <= 'F') {
+			return c - 'A' + 10;
+		}
+		return -1;
+	}
+}
+
 //-----------------------------------------------------------------------------
 
 RtfTokenizer::RtfTokenizer() :
 	m_device(0),
+	m_mapped_file(0),
+	m_mapped(0),
+	m_token_start(0),
 	m_position(0),
+	m_end(0),
+	m_start_offset(0),
+	m_size(0),
+	m_progress_mark(0),
+	m_progress(-1),
+	m_type(TextToken),
 	m_value(0),
 	m_has_value(false)
 {
-	m_buffer.reserve(8192);
-	m_text.reserve(8192);
+	m_hex.reserve(1);
+}
+
+//-----------------------------------------------------------------------------
+
+RtfTokenizer::~RtfTokenizer()
+{
+	unmap();
 }
 
 //-----------------------------------------------------------------------------
 
 bool RtfTokenizer::hasNext() const
 {
-	return (m_position < m_buffer.size() - 1) || !m_device->atEnd();
+	return (m_position < m_end) || (!m_mapped && m_device && !m_device->atEnd());
 }
 
 //-----------------------------------------------------------------------------
@@ -52,7 +100,7 @@ void RtfTokenizer::readNext()
 {
 	// Reset values
 	m_type = TextToken;
-	m_hex.clear();
+	m_hex.resize(0);
 	m_text.resize(0);
 	m_value = 0;
 	m_has_value = false;
@@ -60,9 +108,14 @@ void RtfTokenizer::readNext()
 		return;
 	}
 
+	if (m_mapped && m_position >= m_progress_mark) {
+		reportProgress();
+	}
+
 	// Read first character
 	char c;
 	do {
+		m_token_start = m_position;
 		c = next();
 	} while (c == '\n' || c == '\r');
 
@@ -76,59 +129,70 @@ void RtfTokenizer::readNext()
 
 		c = next();
 
-		if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) {
+		if (isLetter(c)) {
 			// Read control word
-			while ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) {
-				m_text.append(c);
+			while (isLetter(c)) {
 				c = next();
 			}
+			const int word_end = m_position - m_token_start - 1;
 
 			// Read integer value
 			int sign = (c != '-') ? 1 : -1;
 			if (sign == -1) {
 				c = next();
 			}
-			QByteArray value;
-			while (isdigit(c)) {
-				value.append(c);
+			qint64 value = 0;
+			bool overflow = false;
+			while (isDigit(c)) {
+				m_has_value = true;
+				if (!overflow) {
+					value = value * 10 + (c - '0');
+					overflow = value > INT_MAX;
+				}
 				c = next();
 			}
-			m_has_value = !value.isEmpty();
-			m_value = value.toInt() * sign;
+			m_value = overflow ? 0 : qint32(value) * sign;
 
 			// Eat space after control word
 			if (c != ' ') {
 				--m_position;
 			}
 
+			setText(1, word_end);
+
 			// Eat binary value
 			if (m_text == "bin") {
-				if (m_value > 0) {
-					for (int i = 0; i < m_value; i++) {
-						c = next();
+				qint64 remaining = qMax(m_value, 0);
+				while (remaining > 0) {
+					if (m_position == m_end && !refill()) {
+						throw tr("Unexpectedly reached end of file.");
 					}
+					const qint64 step = qMin<qint64>(remaining, m_end - m_position);
+					m_position += step;
+					m_token_start = m_position;
+					remaining -= step;
 				}
 				return readNext();
 			}
 		} else if (c == '\'') {
 			// Read hexadecimal value
-			m_text.append(c);
-			QByteArray hex(2, 0);
-			hex[0] = next();
-			hex[1] = next();
-			m_hex.append(hex.toInt(0, 16));
+			const int high = hexDigit(next());
+			const int low = hexDigit(next());
+			setText(1, 2);
+			m_hex.resize(1);
+			m_hex[0] = (high < 0 || low < 0) ? 0 : char((high << 4) | low);
 		} else {
 			// Read escaped character
-			m_text.append(c);
+			setText(1, 2);
 		}
 	} else {
 		// Read text
 		m_type = TextToken;
 		while (c != '\\' && c != '{' && c != '}' && c != '\n' && c != '\r') {
-			m_text.append(c);
 			c = next();
 		}
 		m_position--;
+		setText(0, m_position - m_token_start);
 	}
 }
 
@@ -136,25 +200,115 @@ void RtfTokenizer::readNext()
 
 void RtfTokenizer::setDevice(QIODevice* device)
 {
+	unmap();
+
 	m_device = device;
+	m_token_start = m_position = m_end = 0;
+	m_text.resize(0);
+	m_progress = -1;
+	m_start_offset = 0;
+	m_size = 0;
+	if (!m_device) {
+		return;
+	}
+
+	if (!m_device->isSequential()) {
+		m_start_offset = m_device->pos();
+		m_size = m_device->size() - m_start_offset;
+	}
+
+	// Map the whole file, then the data is never copied
+	QFileDevice* file = qobject_cast<QFileDevice*>(m_device);
+	if (file && m_size > 0) {
+		m_mapped = file->map(m_start_offset, m_size);
+		if (m_mapped) {
+			m_mapped_file = file;
+			m_token_start = m_position = reinterpret_cast<const char*>(m_mapped);
+			m_end = m_position + m_size;
+			m_progress_mark = m_position;
+			return;
+		}
+	}
+
+	m_buffer.resize(BUFFER_SIZE);
 }
 
 //-----------------------------------------------------------------------------
 
-char RtfTokenizer::next()
+void RtfTokenizer::setProgressHandler(const std::function<void(int)>& handler)
 {
-	m_position++;
-	if (m_position >= m_buffer.size()) {
-		m_buffer.resize(8192);
-		int size = m_device->read(m_buffer.data(), m_buffer.size());
-		if (size < 1) {
-			throw tr("Unexpectedly reached end of file.");
-		}
-		m_buffer.resize(size);
-		m_position = 0;
-		QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
+	m_progress_handler = handler;
+}
+
+//-----------------------------------------------------------------------------
+
+bool RtfTokenizer::refill()
+{
+	if (m_mapped || !m_device) {
+		return false;
+	}
+
+	// Move the unfinished token to the start of the buffer to keep its text contiguous
+	const int keep = m_position - m_token_start;
+	if (keep >= m_buffer.size() / 2) {
+		QByteArray buffer(m_buffer.size() * 2, Qt::Uninitialized);
+		memcpy(buffer.data(), m_token_start, keep);
+		m_buffer = buffer;
+	} else if (keep > 0) {
+		memmove(m_buffer.data(), m_token_start, keep);
+	}
+	char* data = m_buffer.data();
+	m_token_start = data;
+	m_position = m_end = data + keep;
+
+	const qint64 size = m_device->read(data + keep, m_buffer.size() - keep);
+	if (size < 1) {
+		return false;
+	}
+	m_end += size;
+
+	reportProgress();
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+
+void RtfTokenizer::setText(int start, int end)
+{
+	m_text.setRawData(m_token_start + start, end - start);
+}
+
+//-----------------------------------------------------------------------------
+
+void RtfTokenizer::reportProgress()
+{
+	if (m_mapped) {
+		m_progress_mark = m_position + PROGRESS_STEP;
+	}
+	if (!m_progress_handler || m_size <= 0) {
+		return;
+	}
+
+	const qint64 done = m_mapped
+		? (m_position - reinterpret_cast<const char*>(m_mapped))
+		: (m_device->pos() - m_start_offset - (m_end - m_position));
+	const int progress = int(qBound<qint64>(0, done * 100 / m_size, 100));
+	if (progress != m_progress) {
+		m_progress = progress;
+		m_progress_handler(m_progress);
+	}
+}
+
+//-----------------------------------------------------------------------------
+
+void RtfTokenizer::unmap()
+{
+	if (m_mapped) {
+		m_text.resize(0);
+		m_mapped_file->unmap(m_mapped);
+		m_mapped = 0;
+		m_mapped_file = 0;
 	}
-	return m_buffer.at(m_position);
 }
 
 //-----------------------------------------------------------------------------
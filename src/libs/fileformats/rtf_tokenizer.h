@@ -22,6 +22,9 @@
 
 #include <QByteArray>
 #include <QCoreApplication>
+
+#include <functional>
+class QFileDevice;
 class QIODevice;
 
 enum RtfTokenType
@@ -32,30 +35,54 @@ enum RtfTokenType
 	TextToken
 };
 
+// Files are memory-mapped as a whole, other devices are read into a sliding
+// buffer. Token text is not copied but points into that data, so text() and
+// hex() are only valid until the next call of readNext().
 class RtfTokenizer
 {
 	Q_DECLARE_TR_FUNCTIONS(RtfTokenizer)
 
 public:
 	RtfTokenizer();
+	~RtfTokenizer();
 
 	bool hasNext() const;
 	bool hasValue() const;
-	QByteArray hex() const;
-	QByteArray text() const;
+	const QByteArray& hex() const;
+	const QByteArray& text() const;
 	RtfTokenType type() const;
 	qint32 value() const;
 
 	void readNext();
 	void setDevice(QIODevice* device);
 
+	// Receives the percentage of data parsed so far
+	void setProgressHandler(const std::function<void(int)>& handler);
+
 private:
 	char next();
+	bool refill();
+	void setText(int start, int end);
+	void reportProgress();
+	void unmap();
 
 private:
 	QIODevice* m_device;
+	QFileDevice* m_mapped_file;
+	uchar* m_mapped;
 	QByteArray m_buffer;
-	int m_position;
+
+	// Start of the current token, next character and end of available data
+	const char* m_token_start;
+	const char* m_position;
+	const char* m_end;
+
+	// Progress
+	std::function<void(int)> m_progress_handler;
+	qint64 m_start_offset;
+	qint64 m_size;
+	const char* m_progress_mark;
+	int m_progress;
 
 	RtfTokenType m_type;
 	QByteArray m_hex;
@@ -69,12 +96,12 @@ inline bool RtfTokenizer::hasValue() const
 	return m_has_value;
 }
 
-inline QByteArray RtfTokenizer::hex() const
+inline const QByteArray& RtfTokenizer::hex() const
 {
 	return m_hex;
 }
 
-inline QByteArray RtfTokenizer::text() const
+inline const QByteArray& RtfTokenizer::text() const
 {
 	return m_text;
 }
@@ -89,4 +116,12 @@ inline qint32 RtfTokenizer::value() const
 	return m_value;
 }
 
+inline char RtfTokenizer::next()
+{
+	if (m_position == m_end && !refill()) {
+		throw tr("Unexpectedly reached end of file.");
+	}
+	return *m_position++;
+}
+
 #endif
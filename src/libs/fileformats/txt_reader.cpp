@@ -44,9 +44,14 @@ void TxtReader::readData(QIODevice* device)
 	}
 	stream.setCodec(codec);
 
+	const qint64 size = device->isSequential() ? 0 : device->size();
 	while (!stream.atEnd()) {
+		if (isCanceled()) {
+			m_error = tr("Import canceled.");
+			break;
+		}
 		m_cursor.insertText(stream.read(0x4000));
-		QCoreApplication::processEvents(QEventLoop::ExcludeUserInputEvents);
+		reportProgress(device->pos(), size);
 	}
 
 	m_cursor.endEditBlock();
@@ -22,8 +22,12 @@
 
 #include "format_reader.h"
 
+#include <QCoreApplication>
+
 class TxtReader : public FormatReader
 {
+	Q_DECLARE_TR_FUNCTIONS(TxtReader)
+
 public:
 	TxtReader();
 
@@ -4,7 +4,7 @@ TEMPLATE = lib
 #
 # Build configuration
 #
-CONFIG += qt thread warn_on staticlib
+CONFIG += qt thread warn_on staticlib c++11
 QT -= core gui
 
 #
@@ -75,7 +75,8 @@ HEADERS += \
     src/hunspell/hunzip.hxx \
     src/hunspell/w_char.hxx \
     src/hunspell/replist.hxx \
-    src/hunspell/hunvisapi.h
+    src/hunspell/hunvisapi.h \
+    src/hunspell/spellservice.hxx
 
 #
 # Исходные тексты
@@ -94,4 +95,5 @@ SOURCES += \
     src/hunspell/filemgr.cxx \
     src/hunspell/hunzip.cxx \
     src/hunspell/replist.cxx \
+    src/hunspell/spellservice.cxx \
     src/hunspell/utf_info.cxx
@@ -5,6 +5,7 @@
 #include <string.h>
 #include <stdio.h> 
 #include <ctype.h>
+#include <mutex>
 
 #include "csutil.hxx"
 #include "atypes.hxx"
@@ -45,6 +46,8 @@ struct unicode_info2 {
 
 static struct unicode_info2 * utf_tbl = NULL;
 static int utf_tbl_count = 0; // utf_tbl can be used by multiple Hunspell instances
+// Hunspell instances can be created and deleted in different threads
+static std::mutex utf_tbl_mutex;
 
 /* only UTF-16 (BMP) implementation */
 char * u16_u8(char * dest, int size, const w_char * src, int srclen) {
@@ -5616,6 +5619,7 @@ int get_lang_num(const char * lang) {
 #ifndef OPENOFFICEORG
 #ifndef MOZILLA_CLIENT
 int initialize_utf_tbl() {
+  std::lock_guard<std::mutex> lock(utf_tbl_mutex);
   utf_tbl_count++;
   if (utf_tbl) return 0;
   utf_tbl = (unicode_info2 *) malloc(CONTSIZE * sizeof(unicode_info2));
@@ -5638,6 +5642,7 @@ int initialize_utf_tbl() {
 #endif
 
 void free_utf_tbl() {
+  std::lock_guard<std::mutex> lock(utf_tbl_mutex);
   if (utf_tbl_count > 0) utf_tbl_count--;
   if (utf_tbl && (utf_tbl_count == 0)) {
     free(utf_tbl);
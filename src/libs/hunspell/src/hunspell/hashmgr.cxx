@@ -5,6 +5,17 @@
 #include <string.h>
 #include <stdio.h> 
 #include <ctype.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#else
+#include <process.h>
+#endif
 
 #include "hashmgr.hxx"
 #include "csutil.hxx"
@@ -15,7 +26,13 @@
 HashMgr::HashMgr(const char * tpath, const char * apath, const char * key)
 {
   tablesize = 0;
+  tablecount = 0;
   tableptr = NULL;
+  walksize = 0;
+  walkptr = NULL;
+  image = NULL;
+  imagesize = 0;
+  imagemapped = 0;
   flag_mode = FLAG_CHAR;
   complexprefixes = 0;
   utf8 = 0;
@@ -31,6 +48,8 @@ HashMgr::HashMgr(const char * tpath, const char * apath, const char * key)
   numaliasm = 0;
   aliasm = NULL;
   forbiddenword = FORBIDDENWORD; // forbidden word signing flag
+  // precompiled image is not used for encrypted dictionaries
+  if (!key && load_image(tpath, apath) == 0) return;
   load_config(apath, key);
   int ec = load_tables(tpath, key);
   if (ec) {
@@ -40,8 +59,14 @@ HashMgr::HashMgr(const char * tpath, const char * apath, const char * key)
       free(tableptr);
       tableptr = NULL;
     }
+    if (walkptr) {
+      free(walkptr);
+      walkptr = NULL;
+    }
     tablesize = 0;
-  }
+    tablecount = 0;
+    walksize = 0;
+  } else if (!key) save_image(tpath, apath);
 }
 
 
@@ -54,16 +79,27 @@ HashMgr::~HashMgr()
       struct hentry * pt = tableptr[i];
       struct hentry * nt = NULL;
       while(pt) {
-        nt = pt->next;
-        if (pt->astr && (!aliasf || TESTAFF(pt->astr, ONLYUPCASEFLAG, pt->alen))) free(pt->astr);
-        free(pt);
+        nt = pt->next_homonym;
+        // records and flags of the image are released with the image
+        if (pt->astr && !in_image(pt->astr) &&
+          (!aliasf || TESTAFF(pt->astr, ONLYUPCASEFLAG, pt->alen))) free(pt->astr);
+        if (!in_image(pt)) free(pt);
         pt = nt;
       }
     }
-    free(tableptr);
+    if (!in_image(tableptr)) free(tableptr);
   }
+  if (walkptr && !in_image(walkptr)) free(walkptr);
   tablesize = 0;
+  tablecount = 0;
+  walksize = 0;
+  release_image();
+  free_config();
+}
 
+// free affix file settings and restore their defaults
+void HashMgr::free_config()
+{
   if (aliasf) {
     for (int j = 0; j < (numaliasf); j++) free(aliasf[j]);
     free(aliasf);
@@ -94,29 +130,124 @@ HashMgr::~HashMgr()
 #ifdef MOZILLA_CLIENT
     delete [] csconv;
 #endif
+
+  flag_mode = FLAG_CHAR;
+  complexprefixes = 0;
+  utf8 = 0;
+  langnum = 0;
+  lang = NULL;
+  enc = NULL;
+  csconv = 0;
+  ignorechars = NULL;
+  ignorechars_utf16 = NULL;
+  ignorechars_utf16_len = 0;
+  numaliasf = 0;
+  aliasf = NULL;
+  aliasflen = NULL;
+  numaliasm = 0;
+  aliasm = NULL;
+  forbiddenword = FORBIDDENWORD;
 }
 
 // lookup a root word in the hashtable
 
 struct hentry * HashMgr::lookup(const char *word) const
 {
-    struct hentry * dp;
-    if (tableptr) {
-       dp = tableptr[hash(word)];
-       if (!dp) return NULL;
-       for (  ;  dp != NULL;  dp = dp->next) {
-          if (strcmp(word, dp->word) == 0) return dp;
-       }
-    }
+    if (tableptr) return *find_slot(word);
     return NULL;
 }
 
+// slot of the word or the empty slot, where it would be stored (linear probing)
+struct hentry ** HashMgr::find_slot(const char * word) const
+{
+    unsigned int mask = (unsigned int) tablesize - 1;
+    unsigned int i = hash(word) & mask;
+    while (tableptr[i] && strcmp(word, tableptr[i]->word) != 0) i = (i + 1) & mask;
+    return tableptr + i;
+}
+
+// resize the hash table, size must be a power of two
+int HashMgr::grow_table(int size)
+{
+    struct hentry ** oldptr = tableptr;
+    int oldsize = tablesize;
+    tableptr = (struct hentry **) calloc(size, sizeof(struct hentry *));
+    if (!tableptr) {
+        tableptr = oldptr;
+        return 1;
+    }
+    tablesize = size;
+    for (int i = 0; i < oldsize; i++) {
+        if (oldptr[i]) *find_slot(oldptr[i]->word) = oldptr[i];
+    }
+    if (oldptr && !in_image(oldptr)) free(oldptr);
+    return 0;
+}
+
+// link the word record into the hash table after its homonyms
+int HashMgr::link_word(struct hentry * hp)
+{
+    hp->next_homonym = NULL;
+    // keep load factor under 3/4
+    if ((tablecount + 1) * 4 > tablesize * 3 &&
+      grow_table(tablesize ? tablesize * 2 : 64)) return 1;
+
+    struct hentry ** slot = find_slot(HENTRY_WORD(hp));
+    struct hentry * dp = *slot;
+    if (!dp) {
+        *slot = hp;
+        tablecount++;
+        return 0;
+    }
+    while (dp->next_homonym) dp = dp->next_homonym;
+    dp->next_homonym = hp;
+    return 0;
+}
+
+// Walk table
+//
+// walk_hashtable() goes through the buckets of the chained hash table of
+// the original Hunspell (same size and hash function), so the ngram
+// suggestions meet equally scored words in the same order as before.
+// The buckets only link the records through hentry::next, lookups use
+// the open addressing table.
+
+int HashMgr::init_walk(int wordcount)
+{
+    if (wordcount > (1 << 28)) wordcount = 1 << 28;
+    int size = wordcount + 5 + USERWORD;
+    if ((size % 2) == 0) size++;
+    walkptr = (struct hentry **) calloc(size, sizeof(struct hentry *));
+    if (!walkptr) return 1;
+    walksize = size;
+    return 0;
+}
+
+unsigned int HashMgr::walk_hash(const char * word) const
+{
+    long  hv = 0;
+    for (int i=0; i < 4  &&  *word != 0; i++)
+        hv = (hv << 8) | (*word++);
+    while (*word != 0) {
+      ROTATE(hv,ROTATE_LEN);
+      hv ^= (*word++);
+    }
+    return (unsigned long) hv % walksize;
+}
+
+// append the word record to its walk bucket
+void HashMgr::link_walk(struct hentry * hp)
+{
+    struct hentry ** dp = walkptr + walk_hash(HENTRY_WORD(hp));
+    while (*dp) dp = &((*dp)->next);
+    *dp = hp;
+}
+
 // add a word to the hash table (private)
 int HashMgr::add_word(const char * word, int wbl, int wcl, unsigned short * aff,
     int al, const char * desc, bool onlyupcase)
 {
-    bool upcasehomonym = false;
-    int descl = desc ? (aliasm ? sizeof(short) : strlen(desc) + 1) : 0;
+    int descl = desc ? (aliasm ? sizeof(char *) : strlen(desc) + 1) : 0;
     // variable-length hash record with word and optional fields
     struct hentry* hp = 
 	(struct hentry *) malloc (sizeof(struct hentry) + wbl + descl);
@@ -134,13 +265,11 @@ int HashMgr::add_word(const char * word, int wbl, int wcl, unsigned short * aff,
         if (utf8) reverseword_utf(hpw); else reverseword(hpw);
     }
 
-    int i = hash(hpw);
-
     hp->blen = (unsigned char) wbl;
     hp->clen = (unsigned char) wcl;
     hp->alen = (short) al;
     hp->astr = aff;
-    hp->next = NULL;      
+    hp->next = NULL;
     hp->next_homonym = NULL;
 
     // store the description string or its pointer
@@ -159,53 +288,39 @@ int HashMgr::add_word(const char * word, int wbl, int wcl, unsigned short * aff,
 	if (strstr(HENTRY_DATA(hp), MORPH_PHON)) hp->var += H_OPT_PHON;
     } else hp->var = 0;
 
-       struct hentry * dp = tableptr[i];
-       if (!dp) {
-         tableptr[i] = hp;
-         return 0;
-       }
-       while (dp->next != NULL) {
-         if ((!dp->next_homonym) && (strcmp(hp->word, dp->word) == 0)) {
-    	    // remove hidden onlyupcase homonym
-            if (!onlyupcase) {
-		if ((dp->astr) && TESTAFF(dp->astr, ONLYUPCASEFLAG, dp->alen)) {
-		    free(dp->astr);
-		    dp->astr = hp->astr;
-		    dp->alen = hp->alen;
-		    free(hp);
-		    return 0;
-		} else {
-    		    dp->next_homonym = hp;
-    		}
-            } else {
-        	upcasehomonym = true;
-            }
-         }
-         dp=dp->next;
-       }
-       if (strcmp(hp->word, dp->word) == 0) {
-    	    // remove hidden onlyupcase homonym
-            if (!onlyupcase) {
-		if ((dp->astr) && TESTAFF(dp->astr, ONLYUPCASEFLAG, dp->alen)) {
-		    free(dp->astr);
-		    dp->astr = hp->astr;
-		    dp->alen = hp->alen;
-		    free(hp);
-		    return 0;
-		} else {
-    		    dp->next_homonym = hp;
-    		}
-            } else {
-        	upcasehomonym = true;
-            }
-       }
-       if (!upcasehomonym) {
-    	    dp->next = hp;
-       } else {
-    	    // remove hidden onlyupcase homonym
-    	    if (hp->astr) free(hp->astr);
-    	    free(hp);
-       }
+    // keep load factor under 3/4
+    if (((tablecount + 1) * 4 > tablesize * 3 &&
+      grow_table(tablesize ? tablesize * 2 : 64)) ||
+      (!walkptr && init_walk(0))) {
+        free(hp);
+        return 1;
+    }
+
+    struct hentry ** slot = find_slot(hpw);
+    struct hentry * dp = *slot;
+    if (!dp) {
+        *slot = hp;
+        tablecount++;
+        link_walk(hp);
+        return 0;
+    }
+    if (onlyupcase) {
+        // remove hidden onlyupcase homonym
+        if (hp->astr) free(hp->astr);
+        free(hp);
+        return 0;
+    }
+    while (dp->next_homonym) dp = dp->next_homonym;
+    // remove hidden onlyupcase homonym
+    if ((dp->astr) && TESTAFF(dp->astr, ONLYUPCASEFLAG, dp->alen)) {
+        if (!in_image(dp->astr)) free(dp->astr);
+        dp->astr = hp->astr;
+        dp->alen = hp->alen;
+        free(hp);
+        return 0;
+    }
+    dp->next_homonym = hp;
+    link_walk(hp);
     return 0;
 }     
 
@@ -340,14 +455,20 @@ int HashMgr::add_with_affix(const char * word, const char * example)
 struct hentry * HashMgr::walk_hashtable(int &col, struct hentry * hp) const
 {  
   if (hp && hp->next != NULL) return hp->next;
-  for (col++; col < tablesize; col++) {
-    if (tableptr[col]) return tableptr[col];
+  for (col++; col < walksize; col++) {
+    if (walkptr[col]) return walkptr[col];
   }
   // null at end and reset to start
   col = -1;
   return NULL;
 }
 
+// number of walk buckets, walk_hashtable() columns are less than it
+int HashMgr::get_tablesize() const
+{
+  return walksize;
+}
+
 // load a munched word list and build a hash table on the fly
 int HashMgr::load_tables(const char * tpath, const char * key)
 {
@@ -376,22 +497,19 @@ int HashMgr::load_tables(const char * tpath, const char * key)
     // warning: dic file begins with byte order mark: possible incompatibility with old Hunspell versions
   }
 
-  tablesize = atoi(ts);
-  if (tablesize == 0) {
+  int wordcount = atoi(ts);
+  if (wordcount <= 0) {
     HUNSPELL_WARNING(stderr, "error: line 1: missing or bad word count in the dic file\n");
     delete dict;
     return 4;
   }
-  tablesize = tablesize + 5 + USERWORD;
-  if ((tablesize %2) == 0) tablesize++;
-
-  // allocate the hash table
-  tableptr = (struct hentry **) malloc(tablesize * sizeof(struct hentry *));
-  if (! tableptr) {
+  // allocate the hash table (grows in add_word(), if the count is wrong)
+  int size = 64;
+  while (size < (1 << 28) && size / 4 * 3 < wordcount + USERWORD) size *= 2;
+  if (grow_table(size) || init_walk(wordcount)) {
     delete dict;
     return 3;
   }
-  for (int i=0; i<tablesize; i++) tableptr[i] = NULL;
 
   // loop through all words on much list and add to hash
   // table and create word and affix strings
@@ -474,19 +592,17 @@ int HashMgr::load_tables(const char * tpath, const char * key)
   return 0;
 }
 
-// the hash function is a simple load and rotate
-// algorithm borrowed
+// FNV-1a hash function, the table index is in the lower bits
+// (image files depend on it, see IMAGE_VERSION)
 
-int HashMgr::hash(const char * word) const
+unsigned int HashMgr::hash(const char * word) const
 {
-    long  hv = 0;
-    for (int i=0; i < 4  &&  *word != 0; i++)
-        hv = (hv << 8) | (*word++);
-    while (*word != 0) {
-      ROTATE(hv,ROTATE_LEN);
-      hv ^= (*word++);
+    unsigned int hv = 2166136261U;
+    for (; *word; word++) {
+        hv ^= (unsigned char) *word;
+        hv *= 16777619U;
     }
-    return (unsigned long) hv % tablesize;
+    return hv;
 }
 
 int HashMgr::decode_flags(unsigned short ** result, char * flags, FileMgr * af) {
@@ -926,3 +1042,499 @@ char * HashMgr::get_aliasm(int index) {
     HUNSPELL_WARNING(stderr, "error: bad morph. alias index: %d\n", index);
     return NULL;
 }
+
+// Precompiled dictionary image
+//
+// The image caches the parsed dic file and the affix file settings read
+// by load_config() in "<dic path>.himg". It consists of the header, the
+// settings, the walk buckets, the word records in the hentry layout (in
+// walk order) and the flat flag vector array. Pointers of the records and
+// of the walk buckets are stored as offsets and relocated once after
+// mapping the file, the open addressing table is rebuilt from the records:
+//   walk bucket, next: record offset + 1 (0 for NULL)
+//   astr: (flag offset + 1) << 1 or (flag alias index + 1) << 1 | 1
+//   morph. alias pointer (H_OPT_ALIASM): morph. alias index + 1
+// Records are checked while relocating them, a damaged image is ignored
+// and the dic file is parsed again.
+
+#define IMAGE_MAGIC "HUNIMG\0\0"
+#define IMAGE_VERSION 2
+#define IMAGE_BYTEORDER 0x01020304
+#define IMAGE_SUFFIX ".himg"
+#define IMAGE_ALIGN(n) (((n) + sizeof(void *) - 1) & ~(sizeof(void *) - 1))
+
+struct image_header {
+    char magic[8];
+    int version;
+    int byteorder;
+    int ptrsize;
+    int hentrysize;
+    long long affsize;
+    long long affmtime;
+    long long dicsize;
+    long long dicmtime;
+    int flag_mode;
+    int complexprefixes;
+    int utf8;
+    int langnum;
+    int forbiddenword;
+    int numaliasf;
+    int numaliasm;
+    int tablesize;
+    int tablecount;
+    int walksize;
+    long long config;   // offset of the affix file settings
+    long long walk;     // offset of the walk buckets
+    long long entries;  // offset of the word records
+    long long flags;    // offset of the flag vectors
+    long long flagslen; // number of flags
+    long long size;     // size of the image
+};
+
+// pointer to index map for the alias tables
+struct image_alias {
+    const void * p;
+    int index;
+};
+
+static int image_alias_cmp(const void * a, const void * b)
+{
+    const void * pa = ((const struct image_alias *) a)->p;
+    const void * pb = ((const struct image_alias *) b)->p;
+    return (pa < pb) ? -1 : ((pa > pb) ? 1 : 0);
+}
+
+static int image_alias_find(const struct image_alias * table, int n, const void * p)
+{
+    struct image_alias key;
+    key.p = p;
+    key.index = 0;
+    struct image_alias * found = (struct image_alias *)
+        bsearch(&key, table, n, sizeof(struct image_alias), image_alias_cmp);
+    return found ? found->index : -1;
+}
+
+static struct image_alias * image_alias_table(void ** p, int n)
+{
+    struct image_alias * table = (struct image_alias *) malloc((n ? n : 1) * sizeof(struct image_alias));
+    if (!table) return NULL;
+    for (int i = 0; i < n; i++) {
+        table[i].p = p[i];
+        table[i].index = i;
+    }
+    qsort(table, n, sizeof(struct image_alias), image_alias_cmp);
+    return table;
+}
+
+static int image_file_stat(const char * path, long long * size, long long * mtime)
+{
+    struct stat st;
+    if (stat(path, &st) != 0) return 1;
+    *size = (long long) st.st_size;
+    *mtime = (long long) st.st_mtime;
+    return 0;
+}
+
+// size of the word record in the image (without alignment)
+static size_t image_record_size(struct hentry * hp)
+{
+    size_t len = offsetof(struct hentry, word) + hp->blen + 1;
+    if (hp->var & H_OPT_ALIASM) len += sizeof(char *);
+    else if (hp->var & H_OPT) len += strlen(HENTRY_WORD(hp) + hp->blen + 1) + 1;
+    return len;
+}
+
+static int image_write_string(FILE * f, const char * s)
+{
+    int len = s ? (int) strlen(s) : -1;
+    if (fwrite(&len, sizeof(int), 1, f) != 1) return 1;
+    return (len > 0 && fwrite(s, 1, len, f) != (size_t) len);
+}
+
+static int image_write_padding(FILE * f)
+{
+    static const char zeros[sizeof(void *)] = {0};
+    long pos = ftell(f);
+    if (pos < 0) return 1;
+    size_t len = IMAGE_ALIGN((size_t) pos) - (size_t) pos;
+    return (len && fwrite(zeros, 1, len, f) != len);
+}
+
+int HashMgr::in_image(const void * p) const
+{
+    return image && (const char *) p >= image && (const char *) p < image + imagesize;
+}
+
+void HashMgr::release_image()
+{
+    if (!image) return;
+#ifndef _WIN32
+    if (imagemapped) munmap(image, imagesize);
+    else
+#endif
+    free(image);
+    image = NULL;
+    imagesize = 0;
+    imagemapped = 0;
+}
+
+// size of the word record at pos of the image entries, 0 if it is damaged
+static size_t image_record_check(const char * entries, size_t entriessize, size_t pos)
+{
+    if (pos % sizeof(void *) || pos > entriessize ||
+      entriessize - pos < sizeof(struct hentry)) return 0;
+    const struct hentry * hp = (const struct hentry *) (entries + pos);
+    size_t len = offsetof(struct hentry, word) + hp->blen + 1;
+    if (entriessize - pos < len || hp->alen < 0 ||
+      strlen(HENTRY_WORD(hp)) != hp->blen) return 0;
+    if (hp->var & H_OPT_ALIASM) {
+        len += sizeof(char *);
+        if (entriessize - pos < len) return 0;
+    } else if (hp->var & H_OPT) {
+        const char * desc = (const char *) memchr(entries + pos + len, '\0', entriessize - pos - len);
+        if (!desc) return 0;
+        len = desc - (entries + pos) + 1;
+    }
+    return len;
+}
+
+// write the image of the loaded dictionary, it's a cache, so errors are ignored
+int HashMgr::save_image(const char * tpath, const char * apath)
+{
+    struct image_header h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, IMAGE_MAGIC, sizeof(h.magic));
+    h.version = IMAGE_VERSION;
+    h.byteorder = IMAGE_BYTEORDER;
+    h.ptrsize = (int) sizeof(void *);
+    h.hentrysize = (int) sizeof(struct hentry);
+    if (!tableptr || !walkptr || image_file_stat(apath, &h.affsize, &h.affmtime) ||
+      image_file_stat(tpath, &h.dicsize, &h.dicmtime)) return 1;
+    h.flag_mode = flag_mode;
+    h.complexprefixes = complexprefixes;
+    h.utf8 = utf8;
+    h.langnum = langnum;
+    h.forbiddenword = forbiddenword;
+    h.numaliasf = numaliasf;
+    h.numaliasm = numaliasm;
+    h.tablesize = tablesize;
+    h.tablecount = tablecount;
+    h.walksize = walksize;
+
+    struct image_alias * flagaliases = image_alias_table((void **) aliasf, numaliasf);
+    struct image_alias * morphaliases = image_alias_table((void **) aliasm, numaliasm);
+    uintptr_t * buckets = (uintptr_t *) calloc(walksize ? walksize : 1, sizeof(uintptr_t));
+    unsigned short * flags = NULL;
+    char * record = NULL;
+    size_t recordsize = 0;
+    char * path = (char *) malloc(strlen(tpath) + strlen(IMAGE_SUFFIX) + 1);
+    char * tmppath = (char *) malloc(strlen(tpath) + strlen(IMAGE_SUFFIX) + 48);
+    FILE * f = NULL;
+    int ec = 1;
+    if (!flagaliases || !morphaliases || !buckets || !path || !tmppath) goto cleanup;
+    sprintf(path, "%s%s", tpath, IMAGE_SUFFIX);
+    // unique name: other processes may write the image of the same dictionary
+    sprintf(tmppath, "%s.%ld.%lx.tmp", path, (long) getpid(), (unsigned long) (uintptr_t) this);
+
+    {
+        // first pass: record offsets and size of the flag array
+        size_t entriessize = 0;
+        for (int i = 0; i < walksize; i++) {
+            if (!walkptr[i]) continue;
+            buckets[i] = entriessize + 1;
+            for (struct hentry * hp = walkptr[i]; hp; hp = hp->next) {
+                entriessize += IMAGE_ALIGN(image_record_size(hp));
+                if (hp->astr && image_alias_find(flagaliases, numaliasf, hp->astr) < 0) h.flagslen += hp->alen;
+            }
+        }
+        flags = (unsigned short *) malloc((h.flagslen ? h.flagslen : 1) * sizeof(unsigned short));
+        if (!flags) goto cleanup;
+
+        f = fopen(tmppath, "wb");
+        if (!f) goto cleanup;
+        if (fwrite(&h, sizeof(h), 1, f) != 1 || image_write_padding(f)) goto cleanup;
+
+        // affix file settings
+        h.config = ftell(f);
+        if (image_write_string(f, enc) || image_write_string(f, lang) ||
+          image_write_string(f, ignorechars)) goto cleanup;
+        if (fwrite(&ignorechars_utf16_len, sizeof(int), 1, f) != 1) goto cleanup;
+        if (ignorechars_utf16_len > 0 && fwrite(ignorechars_utf16, sizeof(unsigned short),
+          ignorechars_utf16_len, f) != (size_t) ignorechars_utf16_len) goto cleanup;
+        for (int j = 0; j < numaliasf; j++) {
+            if (fwrite(&aliasflen[j], sizeof(unsigned short), 1, f) != 1) goto cleanup;
+            if (aliasflen[j] && fwrite(aliasf[j], sizeof(unsigned short), aliasflen[j], f) != aliasflen[j]) goto cleanup;
+        }
+        for (int j = 0; j < numaliasm; j++) {
+            if (image_write_string(f, aliasm[j])) goto cleanup;
+        }
+        if (image_write_padding(f)) goto cleanup;
+
+        h.walk = ftell(f);
+        if (fwrite(buckets, sizeof(uintptr_t), walksize, f) != (size_t) walksize) goto cleanup;
+
+        // second pass: word records and their flags
+        h.entries = ftell(f);
+        size_t offset = 1;
+        long long flagpos = 0;
+        for (int i = 0; i < walksize; i++) {
+            for (struct hentry * hp = walkptr[i]; hp; hp = hp->next) {
+                size_t len = image_record_size(hp);
+                size_t alignedlen = IMAGE_ALIGN(len);
+                if (alignedlen > recordsize) {
+                    free(record);
+                    recordsize = alignedlen * 2;
+                    record = (char *) malloc(recordsize);
+                    if (!record) goto cleanup;
+                }
+                memset(record, 0, alignedlen);
+                memcpy(record, hp, len);
+                struct hentry * rp = (struct hentry *) record;
+                uintptr_t astr = 0;
+                if (hp->astr) {
+                    int index = image_alias_find(flagaliases, numaliasf, hp->astr);
+                    if (index >= 0) {
+                        astr = ((uintptr_t) (index + 1) << 1) | 1;
+                    } else {
+                        astr = (uintptr_t) (flagpos + 1) << 1;
+                        if (hp->alen) memcpy(flags + flagpos, hp->astr, hp->alen * sizeof(unsigned short));
+                        flagpos += hp->alen;
+                    }
+                }
+                rp->astr = (unsigned short *) astr;
+                offset += alignedlen;
+                rp->next = (struct hentry *) (hp->next ? offset : 0);
+                rp->next_homonym = NULL;
+                if (hp->var & H_OPT_ALIASM) {
+                    int index = image_alias_find(morphaliases, numaliasm,
+                        get_stored_pointer(HENTRY_WORD(hp) + hp->blen + 1));
+                    store_pointer(HENTRY_WORD(rp) + rp->blen + 1, (char *) (uintptr_t) (index + 1));
+                }
+                if (fwrite(record, 1, alignedlen, f) != alignedlen) goto cleanup;
+            }
+        }
+        if (image_write_padding(f)) goto cleanup;
+
+        h.flags = ftell(f);
+        if (h.flagslen && fwrite(flags, sizeof(unsigned short), h.flagslen, f) != (size_t) h.flagslen) goto cleanup;
+        h.size = ftell(f);
+        if (fseek(f, 0, SEEK_SET) != 0 || fwrite(&h, sizeof(h), 1, f) != 1) goto cleanup;
+    }
+    if (fclose(f) == 0) {
+#ifdef _WIN32
+        ::remove(path);
+#endif
+        if (rename(tmppath, path) == 0) ec = 0;
+    }
+    f = NULL;
+
+cleanup:
+    if (f) fclose(f);
+    if (ec) ::remove(tmppath);
+    free(flagaliases);
+    free(morphaliases);
+    free(buckets);
+    free(flags);
+    free(record);
+    free(path);
+    free(tmppath);
+    return ec;
+}
+
+// settings string of the image, returns position after it or NULL on error
+static const char * image_read_string(const char * p, const char * end, char ** s)
+{
+    int len;
+    *s = NULL;
+    if (end - p < (ptrdiff_t) sizeof(int)) return NULL;
+    memcpy(&len, p, sizeof(int));
+    p += sizeof(int);
+    if (len < 0) return p;
+    if (end - p < len) return NULL;
+    *s = (char *) malloc(len + 1);
+    if (!*s) return NULL;
+    memcpy(*s, p, len);
+    (*s)[len] = '\0';
+    return p + len;
+}
+
+// map the up-to-date image of the dictionary and relocate its pointers
+int HashMgr::load_image(const char * tpath, const char * apath)
+{
+    struct image_header h;
+    long long affsize, affmtime, dicsize, dicmtime;
+    if (image_file_stat(apath, &affsize, &affmtime) ||
+      image_file_stat(tpath, &dicsize, &dicmtime)) return 1;
+
+    char * path = (char *) malloc(strlen(tpath) + strlen(IMAGE_SUFFIX) + 1);
+    if (!path) return 1;
+    sprintf(path, "%s%s", tpath, IMAGE_SUFFIX);
+    long long size = 0;
+    long long mtime = 0;
+    int ec = image_file_stat(path, &size, &mtime) || size < (long long) sizeof(h);
+    if (!ec) {
+        imagesize = (size_t) size;
+#ifndef _WIN32
+        // private writable mapping: only pages with the relocated pointers are copied
+        int fd = open(path, O_RDONLY);
+        if (fd >= 0) {
+            void * p = mmap(NULL, imagesize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                image = (char *) p;
+                imagemapped = 1;
+            }
+            close(fd);
+        }
+#else
+        FILE * f = fopen(path, "rb");
+        if (f) {
+            image = (char *) malloc(imagesize);
+            if (image && fread(image, 1, imagesize, f) != imagesize) release_image();
+            fclose(f);
+        }
+#endif
+    }
+    free(path);
+    if (ec || !image) {
+        imagesize = 0;
+        return 1;
+    }
+
+    memcpy(&h, image, sizeof(h));
+    if (memcmp(h.magic, IMAGE_MAGIC, sizeof(h.magic)) != 0 || h.version != IMAGE_VERSION ||
+      h.byteorder != IMAGE_BYTEORDER || h.ptrsize != (int) sizeof(void *) ||
+      h.hentrysize != (int) sizeof(struct hentry) || h.size != (long long) imagesize ||
+      h.affsize != affsize || h.affmtime != affmtime ||
+      h.dicsize != dicsize || h.dicmtime != dicmtime ||
+      h.tablesize <= 0 || (h.tablesize & (h.tablesize - 1)) != 0 ||
+      h.numaliasf < 0 || h.numaliasm < 0 || h.flagslen < 0 ||
+      h.tablecount < 0 || h.tablecount > h.tablesize ||
+      h.walksize <= 0 || (h.walk | h.entries) % (long long) sizeof(void *) != 0 ||
+      h.config < (long long) sizeof(h) || h.config > h.walk ||
+      h.walk + (long long) (h.walksize * sizeof(uintptr_t)) > h.entries ||
+      h.entries > h.flags || h.flags + h.flagslen * (long long) sizeof(unsigned short) > h.size) {
+        release_image();
+        return 1;
+    }
+
+    // affix file settings
+    flag_mode = (flag) h.flag_mode;
+    complexprefixes = h.complexprefixes;
+    langnum = h.langnum;
+    forbiddenword = (unsigned short) h.forbiddenword;
+    const char * p = image + h.config;
+    const char * configend = image + h.walk;
+    p = image_read_string(p, configend, &enc);
+    if (p) p = image_read_string(p, configend, &lang);
+    if (p) p = image_read_string(p, configend, &ignorechars);
+    if (p && configend - p >= (ptrdiff_t) sizeof(int)) {
+        memcpy(&ignorechars_utf16_len, p, sizeof(int));
+        p += sizeof(int);
+        if (ignorechars_utf16_len < 0 ||
+          configend - p < (ptrdiff_t) (ignorechars_utf16_len * sizeof(unsigned short))) p = NULL;
+        else if (ignorechars_utf16_len > 0) {
+            ignorechars_utf16 = (unsigned short *) malloc(ignorechars_utf16_len * sizeof(unsigned short));
+            if (ignorechars_utf16) {
+                memcpy(ignorechars_utf16, p, ignorechars_utf16_len * sizeof(unsigned short));
+                p += ignorechars_utf16_len * sizeof(unsigned short);
+            } else p = NULL;
+        }
+    } else p = NULL;
+    if (p && h.numaliasf) {
+        aliasf = (unsigned short **) calloc(h.numaliasf, sizeof(unsigned short *));
+        aliasflen = (unsigned short *) calloc(h.numaliasf, sizeof(unsigned short));
+        if (aliasf && aliasflen) numaliasf = h.numaliasf; else p = NULL;
+        for (int j = 0; p && j < numaliasf; j++) {
+            if (configend - p < (ptrdiff_t) sizeof(unsigned short)) { p = NULL; break; }
+            memcpy(&aliasflen[j], p, sizeof(unsigned short));
+            p += sizeof(unsigned short);
+            size_t len = aliasflen[j] * sizeof(unsigned short);
+            if (configend - p < (ptrdiff_t) len) { p = NULL; break; }
+            aliasf[j] = (unsigned short *) malloc(len ? len : sizeof(unsigned short));
+            if (!aliasf[j]) { p = NULL; break; }
+            memcpy(aliasf[j], p, len);
+            p += len;
+        }
+    }
+    if (p && h.numaliasm) {
+        aliasm = (char **) calloc(h.numaliasm, sizeof(char *));
+        if (aliasm) numaliasm = h.numaliasm; else p = NULL;
+        for (int j = 0; p && j < numaliasm; j++) p = image_read_string(p, configend, &aliasm[j]);
+    }
+    if (h.utf8) {
+        utf8 = 1;
+#ifndef OPENOFFICEORG
+#ifndef MOZILLA_CLIENT
+        initialize_utf_tbl();
+#endif
+#endif
+    } else if (enc) csconv = get_current_cs(enc);
+    if (csconv == NULL) csconv = get_current_cs(SPELL_ENCODING);
+    if (!p) {
+        free_config();
+        release_image();
+        return 1;
+    }
+
+    // relocate the walk buckets and the word records and link the records
+    // into the hash table; records were written in walk order, so every offset
+    // has to point past the previous record: damaged images can't share or loop records
+    char * entries = image + h.entries;
+    size_t entriessize = (size_t) (h.flags - h.entries);
+    size_t minpos = 0;
+    unsigned short * flags = (unsigned short *) (image + h.flags);
+    walkptr = (struct hentry **) (image + h.walk);
+    walksize = h.walksize;
+    int damaged = grow_table(h.tablesize);
+    for (int i = 0; !damaged && i < walksize; i++) {
+        uintptr_t offset;
+        memcpy(&offset, &walkptr[i], sizeof(uintptr_t));
+        struct hentry ** next = &walkptr[i];
+        while (offset) {
+            size_t pos = offset - 1;
+            size_t len = (pos >= minpos) ? image_record_check(entries, entriessize, pos) : 0;
+            if (!len) {
+                damaged = 1;
+                break;
+            }
+            minpos = pos + len;
+            struct hentry * hp = (struct hentry *) (entries + pos);
+            *next = hp;
+            uintptr_t astr = (uintptr_t) hp->astr;
+            if (astr & 1) {
+                size_t index = (astr >> 1) - 1;
+                hp->astr = (index < (size_t) numaliasf) ? aliasf[index] : NULL;
+                if (hp->astr) hp->alen = aliasflen[index];
+            } else if (astr) {
+                size_t index = (astr >> 1) - 1;
+                hp->astr = (index + hp->alen <= (size_t) h.flagslen) ? flags + index : NULL;
+            }
+            if (!hp->astr) hp->alen = 0;
+            if (hp->var & H_OPT_ALIASM) {
+                size_t index = (size_t) (uintptr_t) get_stored_pointer(HENTRY_WORD(hp) + hp->blen + 1);
+                store_pointer(HENTRY_WORD(hp) + hp->blen + 1,
+                    (index > 0 && index <= (size_t) numaliasm) ? aliasm[index - 1] : NULL);
+            }
+            offset = (uintptr_t) hp->next;
+            next = &hp->next;
+            *next = NULL;
+            if (link_word(hp)) {
+                damaged = 1;
+                break;
+            }
+        }
+    }
+    if (damaged || tablecount != h.tablecount) {
+        HUNSPELL_WARNING(stderr, "error: damaged dictionary image, it is ignored\n");
+        if (tableptr) free(tableptr);
+        tableptr = NULL;
+        tablesize = 0;
+        tablecount = 0;
+        walkptr = NULL;
+        walksize = 0;
+        free_config();
+        release_image();
+        return 1;
+    }
+    return 0;
+}
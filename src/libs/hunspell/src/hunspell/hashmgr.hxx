@@ -12,8 +12,11 @@ enum flag { FLAG_CHAR, FLAG_LONG, FLAG_NUM, FLAG_UNI };
 
 class LIBHUNSPELL_DLL_EXPORTED HashMgr
 {
-  int               tablesize;
-  struct hentry **  tableptr;
+  int               tablesize;  // open addressing table size (power of two)
+  int               tablecount; // number of used slots
+  struct hentry **  tableptr;   // first homonym of each word
+  int               walksize;   // buckets of the chained table walked by walk_hashtable()
+  struct hentry **  walkptr;
   flag              flag_mode;
   int               complexprefixes;
   int               utf8;
@@ -30,15 +33,18 @@ class LIBHUNSPELL_DLL_EXPORTED HashMgr
   unsigned short *  aliasflen;
   int               numaliasm; // morphological desciption `compression' with aliases
   char **           aliasm;
-
+  char *            image;      // precompiled dictionary (see save_image())
+  size_t            imagesize;
+  int               imagemapped;
 
 public:
   HashMgr(const char * tpath, const char * apath, const char * key = NULL);
   ~HashMgr();
 
   struct hentry * lookup(const char *) const;
-  int hash(const char *) const;
+  unsigned int hash(const char *) const;
   struct hentry * walk_hashtable(int & col, struct hentry * hp) const;
+  int get_tablesize() const;
 
   int add(const char * word);
   int add_with_affix(const char * word, const char * pattern);
@@ -62,6 +68,17 @@ private:
     unsigned short * flags, int al, char * dp, int captype);
   int parse_aliasm(char * line, FileMgr * af);
   int remove_forbidden_flag(const char * word);
+  struct hentry ** find_slot(const char * word) const;
+  int grow_table(int size);
+  int link_word(struct hentry * hp);
+  unsigned int walk_hash(const char * word) const;
+  int init_walk(int wordcount);
+  void link_walk(struct hentry * hp);
+  int in_image(const void * p) const;
+  void free_config();
+  int load_image(const char * tpath, const char * apath);
+  int save_image(const char * tpath, const char * apath);
+  void release_image();
 
 };
 
@@ -23,8 +23,8 @@ struct hentry
   unsigned char clen; // word length in characters (different for UTF-8 enc.)
   short    alen;      // length of affix flag vector
   unsigned short * astr;  // affix flag vector
-  struct   hentry * next; // next word with same hash code
-  struct   hentry * next_homonym; // next homonym word (with same hash code)
+  struct   hentry * next; // next word with same walk hash code (see walk_hashtable())
+  struct   hentry * next_homonym; // next homonym word (same word, other flags)
   char     var;       // variable fields (only for special pronounciation yet)
   char     word[1];   // variable-length word (8-bit or UTF-8 encoding)
 };
@@ -0,0 +1,161 @@
+#include <map>
+
+#include "spellservice.hxx"
+#include "hunspell.hxx"
+
+std::shared_ptr<SpellService> SpellService::instance(const char * affpath, const char * dpath)
+{
+    static std::mutex registry_mutex;
+    static std::map<std::string, std::weak_ptr<SpellService> > registry;
+
+    std::string key = std::string(affpath) + '\n' + dpath;
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    std::shared_ptr<SpellService> service = registry[key].lock();
+    if (!service) {
+        service.reset(new SpellService(affpath, dpath));
+        registry[key] = service;
+    }
+    // forget dictionaries, which are no longer used
+    for (std::map<std::string, std::weak_ptr<SpellService> >::iterator it = registry.begin();
+      it != registry.end(); ) {
+        if (it->second.expired()) it = registry.erase(it); else ++it;
+    }
+    return service;
+}
+
+SpellService::SpellService(const char * affpath, const char * dpath)
+  : engine(new Hunspell(affpath, dpath)), gen(0)
+{
+    const char * enc = engine->get_dic_encoding();
+    if (enc) encoding = enc;
+}
+
+SpellService::~SpellService()
+{
+    delete engine;
+}
+
+bool SpellService::spell(const std::string & word)
+{
+    bool verdict;
+    if (find(word, verdict)) return verdict;
+
+    std::lock_guard<std::mutex> lock(engine_mutex);
+    if (!find(word, verdict)) {
+        verdict = engine->spell(word.c_str()) != 0;
+        store(word, verdict);
+    }
+    return verdict;
+}
+
+void SpellService::spell(const std::vector<std::string> & words, std::vector<char> & verdicts)
+{
+    verdicts.assign(words.size(), 0);
+    std::vector<size_t> misses;
+    for (size_t i = 0; i < words.size(); i++) {
+        bool verdict;
+        if (find(words[i], verdict)) verdicts[i] = verdict;
+        else misses.push_back(i);
+    }
+    if (misses.empty()) return;
+
+    // words could be checked by other users meanwhile, so look at the cache again
+    std::lock_guard<std::mutex> lock(engine_mutex);
+    for (size_t i = 0; i < misses.size(); i++) {
+        const std::string & word = words[misses[i]];
+        bool verdict;
+        if (!find(word, verdict)) {
+            verdict = engine->spell(word.c_str()) != 0;
+            store(word, verdict);
+        }
+        verdicts[misses[i]] = verdict;
+    }
+}
+
+std::vector<std::string> SpellService::suggest(const std::string & word)
+{
+    std::vector<std::string> result;
+    std::lock_guard<std::mutex> lock(engine_mutex);
+    char ** slst = NULL;
+    int ns = engine->suggest(&slst, word.c_str());
+    for (int i = 0; i < ns; i++) result.push_back(slst[i]);
+    engine->free_list(&slst, ns);
+    return result;
+}
+
+int SpellService::add(const std::string & word)
+{
+    std::lock_guard<std::mutex> lock(engine_mutex);
+    int result = engine->add(word.c_str());
+    invalidate();
+    return result;
+}
+
+int SpellService::add_with_affix(const std::string & word, const std::string & example)
+{
+    std::lock_guard<std::mutex> lock(engine_mutex);
+    int result = engine->add_with_affix(word.c_str(), example.c_str());
+    invalidate();
+    return result;
+}
+
+int SpellService::remove(const std::string & word)
+{
+    std::lock_guard<std::mutex> lock(engine_mutex);
+    int result = engine->remove(word.c_str());
+    invalidate();
+    return result;
+}
+
+int SpellService::add_dic(const char * dpath)
+{
+    std::lock_guard<std::mutex> lock(engine_mutex);
+    int result = engine->add_dic(dpath);
+    invalidate();
+    return result;
+}
+
+unsigned int SpellService::generation() const
+{
+    return gen.load();
+}
+
+const std::string & SpellService::get_dic_encoding() const
+{
+    return encoding;
+}
+
+SpellService::shard & SpellService::shard_for(const std::string & word)
+{
+    return shards[std::hash<std::string>()(word) % SHARDS];
+}
+
+bool SpellService::find(const std::string & word, bool & verdict)
+{
+    shard & s = shard_for(word);
+    std::lock_guard<std::mutex> lock(s.mutex);
+    std::unordered_map<std::string, bool>::const_iterator it = s.verdicts.find(word);
+    if (it == s.verdicts.end()) return false;
+    verdict = it->second;
+    return true;
+}
+
+// called with locked engine, so verdicts can't outlive invalidate()
+void SpellService::store(const std::string & word, bool verdict)
+{
+    shard & s = shard_for(word);
+    std::lock_guard<std::mutex> lock(s.mutex);
+    // simple bound of the cache size: rarely used words are checked again
+    if (s.verdicts.size() >= SHARD_CAPACITY) s.verdicts.clear();
+    s.verdicts[word] = verdict;
+}
+
+// called with locked engine
+void SpellService::invalidate()
+{
+    for (int i = 0; i < SHARDS; i++) {
+        std::lock_guard<std::mutex> lock(shards[i].mutex);
+        shards[i].verdicts.clear();
+    }
+    ++gen;
+}
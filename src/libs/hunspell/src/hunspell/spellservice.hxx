@@ -0,0 +1,100 @@
+#ifndef _SPELLSERVICE_HXX_
+#define _SPELLSERVICE_HXX_
+
+#include "hunvisapi.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class Hunspell;
+
+/* SpellService - process-wide spell checker
+ * All users of a dictionary share one Hunspell instance, the service is
+ * thread-safe and caches verdicts of checked words until the run-time
+ * dictionary is modified. Words are in the dictionary encoding.
+ * Services (and other Hunspell objects) can be created and released in
+ * any thread: the only state shared by Hunspell instances is the UTF-8
+ * case table of csutil.cxx, which is locked. Loading a dictionary is
+ * slow, so the first instance() of it is better requested before
+ * the checking starts.
+ * In this tree the only user is the script spelling index of the
+ * desktop application. The editor highlighters (SpellChecker of the
+ * scenarist-core submodule) still own their Hunspell instances.
+ */
+
+class LIBHUNSPELL_DLL_EXPORTED SpellService
+{
+  /* word verdicts are split into independently locked parts */
+  struct shard {
+    std::mutex mutex;
+    std::unordered_map<std::string, bool> verdicts;
+  };
+  enum { SHARDS = 16, SHARD_CAPACITY = 8192 };
+
+  std::mutex          engine_mutex; // Hunspell isn't thread-safe
+  Hunspell *          engine;
+  std::string         encoding;
+  shard               shards[SHARDS];
+  std::atomic<unsigned int> gen;
+
+  SpellService(const char * affpath, const char * dpath);
+  SpellService(const SpellService &);
+  SpellService & operator = (const SpellService &);
+
+public:
+
+  /* instance(aff, dic) - service of the dictionary
+   * the dictionary is loaded on the first request and released
+   * with the last reference to the service
+   */
+
+  static std::shared_ptr<SpellService> instance(const char * affpath, const char * dpath);
+  ~SpellService();
+
+  /* spell(word) - spellcheck word
+   * output: false = bad word, true = good word
+   */
+
+  bool spell(const std::string & word);
+
+  /* spell(words, verdicts) - spellcheck a batch of words
+   * the dictionary is locked once for all words missing in the cache
+   * output: verdicts[i] is not 0 for good words[i]
+   */
+
+  void spell(const std::vector<std::string> & words, std::vector<char> & verdicts);
+
+  /* suggest(word) - suggestions for the (bad) word, not cached */
+
+  std::vector<std::string> suggest(const std::string & word);
+
+  /* functions for run-time modification of the dictionary,
+   * they drop all cached verdicts
+   */
+
+  int add(const std::string & word);
+  int add_with_affix(const std::string & word, const std::string & example);
+  int remove(const std::string & word);
+  int add_dic(const char * dpath);
+
+  /* generation() - number, which changes every time the cached
+   * verdicts are dropped (for example, to recheck visible text)
+   */
+
+  unsigned int generation() const;
+
+  const std::string & get_dic_encoding() const;
+
+private:
+  shard & shard_for(const std::string & word);
+  bool find(const std::string & word, bool & verdict);
+  void store(const std::string & word, bool verdict);
+  void invalidate();
+
+};
+
+#endif
@@ -5,6 +5,14 @@
 #include <string.h>
 #include <stdio.h> 
 #include <ctype.h>
+#include <limits.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
 
 #include "suggestmgr.hxx"
 #include "htypes.hxx"
@@ -12,6 +20,56 @@
 
 const w_char W_VLINE = { '\0', '|' };
 
+// character signature bit: Latin and Cyrillic letters get different bits
+#define NGRAM_BIT(c) (1ULL << ((c) & 63))
+
+// parameters of the ngram root word search shared by the search threads
+struct SuggestMgr::ngscan {
+  char * word;                // misspelled word (reversed with complex prefixes)
+  int n;                      // its length in characters
+  int low;                    // NGRAM_LOWERING or 0
+  unsigned short first;       // its first character
+  unsigned long long bits[MAXSWL]; // signature bits of its characters
+  phonetable * ph;
+  const char * target;        // its phonetic code
+  FLAG forbiddenword;
+  FLAG nosuggest;
+  FLAG nongramsuggest;
+  FLAG onlyincompound;
+  std::chrono::steady_clock::time_point deadline;
+};
+
+// scored root word
+struct SuggestMgr::ngroot {
+  int table;                  // index of its hash table
+  int score;
+  struct hentry * hp;
+};
+
+// roots of a part of the hash tables in the order they got into the
+// MAX_ROOTS best roots of the part
+struct SuggestMgr::ngpart {
+  std::vector<ngroot> roots;
+  std::vector<ngroot> rootsphon;
+};
+
+// threads searching the parts 1, 2... of the root words, started with the
+// first search of a large dictionary and stopped with the SuggestMgr
+struct SuggestMgr::ngpool {
+  std::mutex mutex;
+  std::condition_variable start; // new search or quit
+  std::condition_variable done;  // all threads finished their parts
+  std::vector<std::thread> threads;
+  unsigned int generation;       // number of the search
+  int running;                   // threads still searching
+  int quit;
+  const ngscan * scan;
+  HashMgr ** pHMgr;
+  int md;
+  int parts;
+  ngpart * found;
+};
+
 SuggestMgr::SuggestMgr(const char * tryme, int maxn, 
                        AffixMgr * aptr)
 {
@@ -30,6 +88,8 @@ SuggestMgr::SuggestMgr(const char * tryme, int maxn,
   ctry = NULL;
   ctry_utf = NULL;
 
+  pool = NULL;
+
   utf8 = 0;
   langnum = 0;
   complexprefixes = 0;  
@@ -85,6 +145,16 @@ SuggestMgr::SuggestMgr(const char * tryme, int maxn,
 
 SuggestMgr::~SuggestMgr()
 {
+  if (pool) {
+    {
+      std::lock_guard<std::mutex> lock(pool->mutex);
+      pool->quit = 1;
+    }
+    pool->start.notify_all();
+    for (size_t k = 0; k < pool->threads.size(); k++) pool->threads[k].join();
+    delete pool;
+    pool = NULL;
+  }
   pAMgr = NULL;
   if (ckey) free(ckey);
   ckey = NULL;
@@ -1010,8 +1080,8 @@ int SuggestMgr::ngsuggest(char** wlst, char * w, int ns, HashMgr** pHMgr, int md
 
   int i, j;
   int lval;
-  int sc, scphon;
-  int lp, lpphon;
+  int sc;
+  int lp;
   int nonbmp = 0;
 
   // exhaustively search through all root words
@@ -1026,9 +1096,6 @@ int SuggestMgr::ngsuggest(char** wlst, char * w, int ns, HashMgr** pHMgr, int md
     rootsphon[i] = NULL;
     scoresphon[i] = -100 * i;
   }
-  lp = MAX_ROOTS - 1;
-  lpphon = MAX_ROOTS - 1;
-  scphon = -20000;
   int low = NGRAM_LOWERING;
   
   char w2[MAXWORDUTF8LEN];
@@ -1055,8 +1122,6 @@ int SuggestMgr::ngsuggest(char** wlst, char * w, int ns, HashMgr** pHMgr, int md
     low = 0;
   }
 
-  struct hentry* hp = NULL;
-  int col = -1;
   phonetable * ph = (pAMgr) ? pAMgr->get_phonetable() : NULL;
   char target[MAXSWUTF8L];
   char candidate[MAXSWUTF8L];
@@ -1073,69 +1138,60 @@ int SuggestMgr::ngsuggest(char** wlst, char * w, int ns, HashMgr** pHMgr, int md
     phonet(candidate, target, nc, *ph); // XXX phonet() is 8-bit (nc, not n)
   }
 
-  FLAG forbiddenword = pAMgr ? pAMgr->get_forbiddenword() : FLAG_NULL;
-  FLAG nosuggest = pAMgr ? pAMgr->get_nosuggest() : FLAG_NULL;
-  FLAG nongramsuggest = pAMgr ? pAMgr->get_nongramsuggest() : FLAG_NULL;
-  FLAG onlyincompound = pAMgr ? pAMgr->get_onlyincompound() : FLAG_NULL;
-
-  for (i = 0; i < md; i++) {  
-  while (0 != (hp = (pHMgr[i])->walk_hashtable(col, hp))) {
-    if ((hp->astr) && (pAMgr) && 
-       (TESTAFF(hp->astr, forbiddenword, hp->alen) ||
-          TESTAFF(hp->astr, ONLYUPCASEFLAG, hp->alen) ||
-          TESTAFF(hp->astr, nosuggest, hp->alen) ||
-          TESTAFF(hp->astr, nongramsuggest, hp->alen) ||
-          TESTAFF(hp->astr, onlyincompound, hp->alen))) continue;
-
-    sc = ngram(3, word, HENTRY_WORD(hp), NGRAM_LONGER_WORSE + low) +
-	leftcommonsubstring(word, HENTRY_WORD(hp));
-
-    // check special pronounciation
-    if ((hp->var & H_OPT_PHON) && copy_field(f, HENTRY_DATA(hp), MORPH_PHON)) {
-	int sc2 = ngram(3, word, f, NGRAM_LONGER_WORSE + low) +
-		+ leftcommonsubstring(word, f);
-	if (sc2 > sc) sc = sc2;
-    }
-    
-    scphon = -20000;
-    if (ph && (sc > 2) && (abs(n - (int) hp->clen) <= 3)) {
-      char target2[MAXSWUTF8L];
-      if (utf8) {
-        w_char _w[MAXSWL];
-        int _wl = u8_u16(_w, MAXSWL, HENTRY_WORD(hp));
-        mkallcap_utf(_w, _wl, langnum);
-        u16_u8(candidate, MAXSWUTF8L, _w, _wl);
-      } else {
-        strcpy(candidate, HENTRY_WORD(hp));
-        mkallcap(candidate, csconv);
-      }
-      phonet(candidate, target2, -1, *ph);
-      scphon = 2 * ngram(3, target, target2, NGRAM_LONGER_WORSE);
-    }
+  // search the root words in parts of the hash tables, keeping track of the
+  // MAX_ROOTS most similar root words in every part, and replay the results
+  ngscan scan;
+  scan.word = word;
+  scan.n = n;
+  scan.low = low;
+  scan.ph = ph;
+  scan.target = target;
+  scan.forbiddenword = pAMgr ? pAMgr->get_forbiddenword() : FLAG_NULL;
+  scan.nosuggest = pAMgr ? pAMgr->get_nosuggest() : FLAG_NULL;
+  scan.nongramsuggest = pAMgr ? pAMgr->get_nongramsuggest() : FLAG_NULL;
+  scan.onlyincompound = pAMgr ? pAMgr->get_onlyincompound() : FLAG_NULL;
+  scan.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(NGRAM_TIMELIMIT);
+  scan.first = 0;
+  for (i = 0; (i < n) && (i < MAXSWL); i++) {
+    unsigned short c = (utf8) ? (unsigned short) ((u8[i].h << 8) + u8[i].l) : (unsigned char) word[i];
+    scan.bits[i] = NGRAM_BIT(c);
+    if (i == 0) scan.first = c;
+  }
 
-    if (sc > scores[lp]) {
-      scores[lp] = sc;  
-      roots[lp] = hp;
-      lval = sc;
-      for (j=0; j < MAX_ROOTS; j++)
-        if (scores[j] < lval) {
-          lp = j;
-          lval = scores[j];
-        }
-    }
+  int slots = 0;
+  for (i = 0; i < md; i++) slots += pHMgr[i]->get_tablesize();
+  int parts = 1;
+  if (slots >= NGRAM_MINSLOTS) {
+    parts = (int) std::thread::hardware_concurrency();
+    if (parts > NGRAM_MAXTHREADS) parts = NGRAM_MAXTHREADS;
+    parts = ngram_parts(parts);
+  }
 
+  std::vector<ngpart> found(parts);
+  if (parts > 1) {
+    std::lock_guard<std::mutex> lock(pool->mutex);
+    pool->scan = &scan;
+    pool->pHMgr = pHMgr;
+    pool->md = md;
+    pool->parts = parts;
+    pool->found = &found[0];
+    pool->running = parts - 1;
+    pool->generation++;
+    pool->start.notify_all();
+  }
+  ngram_roots(&scan, pHMgr, md, 0, parts, &found[0]);
+  if (parts > 1) {
+    std::unique_lock<std::mutex> lock(pool->mutex);
+    while (pool->running) pool->done.wait(lock);
+  }
 
-    if (scphon > scoresphon[lpphon]) {
-      scoresphon[lpphon] = scphon;
-      rootsphon[lpphon] = HENTRY_WORD(hp);
-      lval = scphon;
-      for (j=0; j < MAX_ROOTS; j++)
-        if (scoresphon[j] < lval) {
-          lpphon = j;
-          lval = scoresphon[j];
-        }
-    }
-  }}
+  ngram_replay(&found[0], parts, md, 0, roots, scores);
+  struct hentry * phonroots[MAX_ROOTS];
+  for (i = 0; i < MAX_ROOTS; i++) phonroots[i] = NULL;
+  ngram_replay(&found[0], parts, md, 1, phonroots, scoresphon);
+  for (i = 0; i < MAX_ROOTS; i++) {
+    if (phonroots[i]) rootsphon[i] = HENTRY_WORD(phonroots[i]);
+  }
 
   // find minimum threshold for a passable suggestion
   // mangle original word three differnt ways
@@ -1376,6 +1432,230 @@ int SuggestMgr::ngsuggest(char** wlst, char * w, int ns, HashMgr** pHMgr, int md
 }
 
 
+// upper bound of the ngram(3, word, s2, NGRAM_LONGER_WORSE + low) +
+// leftcommonsubstring(word, s2) score: an n-gram of the word can only be
+// found in s2 if the signature of s2 has the bits of all its characters
+int SuggestMgr::ngram_bound(const ngscan * scan, const char * s2)
+{
+  unsigned long long sig = 0;
+  unsigned short first;
+  int l2;
+  if (scan->n > MAXSWL) return INT_MAX;
+  if (utf8) {
+    w_char su2[MAXSWL];
+    l2 = u8_u16(su2, MAXSWL, s2);
+    if (l2 <= 0) return INT_MAX;
+    for (int i = 0; i < l2; i++) {
+      unsigned short c = (su2[i].h << 8) + su2[i].l;
+      if (scan->low) c = unicodetolower(c, langnum);
+      sig |= NGRAM_BIT(c);
+    }
+    first = (su2[0].h << 8) + su2[0].l;
+    if ((scan->first != first) && (scan->first != unicodetolower(first, langnum))) first = 0;
+  } else {
+    const unsigned char * p = (const unsigned char *) s2;
+    for (l2 = 0; p[l2]; l2++) {
+      unsigned char c = (scan->low) ? csconv[p[l2]].clower : p[l2];
+      sig |= NGRAM_BIT(c);
+    }
+    if (l2 == 0) return INT_MAX;
+    first = *p;
+    if ((scan->first != first) && (scan->first != csconv[first].clower)) first = 0;
+  }
+
+  // count the 1, 2 and 3 character windows of the word with signature bits
+  int run = 0;
+  int ns1 = 0, ns2 = 0, ns3 = 0;
+  for (int i = 0; i < scan->n; i++) {
+    if (sig & scan->bits[i]) {
+      run++;
+      ns1++;
+      if (run > 1) ns2++;
+      if (run > 2) ns3++;
+    } else run = 0;
+  }
+  int bound = ns1;
+  if (ns1 >= 2) {
+    bound += ns2;
+    if (ns2 >= 2) bound += ns3;
+  }
+  if (l2 - scan->n - 2 > 0) bound -= l2 - scan->n - 2;
+
+  // left common substring
+  if (complexprefixes) bound += 1;
+  else if (first) bound += (scan->n < l2) ? scan->n : l2;
+  return bound;
+}
+
+// search the root words in the part of slots of the hash tables, keeping
+// track of the MAX_ROOTS most similar root words like the whole search does
+// and logging the roots which got into them
+void SuggestMgr::ngram_roots(const ngscan * scan, HashMgr ** pHMgr, int md, int part, int parts,
+    ngpart * found)
+{
+  char word[MAXWORDUTF8LEN]; // ngram() modifies its first argument
+  char f[MAXSWUTF8L];
+  char candidate[MAXSWUTF8L];
+  char target2[MAXSWUTF8L];
+  int n = scan->n;
+  int low = scan->low;
+  int scores[MAX_ROOTS];
+  int scoresphon[MAX_ROOTS];
+  int lp = MAX_ROOTS - 1;
+  int lpphon = MAX_ROOTS - 1;
+  int checks = 0;
+
+  strcpy(word, scan->word);
+  for (int i = 0; i < MAX_ROOTS; i++) {
+    scores[i] = -100 * i;
+    scoresphon[i] = -100 * i;
+  }
+
+  for (int i = 0; i < md; i++) {
+    int size = pHMgr[i]->get_tablesize();
+    int col = (int) ((long long) size * part / parts) - 1;
+    int end = (int) ((long long) size * (part + 1) / parts);
+    struct hentry * hp = NULL;
+    while ((hp = pHMgr[i]->walk_hashtable(col, hp)) && (col < end)) {
+      // return the best roots found so far when the time is over
+      if (!(++checks & 1023) && (std::chrono::steady_clock::now() > scan->deadline)) return;
+
+      if ((hp->astr) && (pAMgr) &&
+         (TESTAFF(hp->astr, scan->forbiddenword, hp->alen) ||
+            TESTAFF(hp->astr, ONLYUPCASEFLAG, hp->alen) ||
+            TESTAFF(hp->astr, scan->nosuggest, hp->alen) ||
+            TESTAFF(hp->astr, scan->nongramsuggest, hp->alen) ||
+            TESTAFF(hp->astr, scan->onlyincompound, hp->alen))) continue;
+
+      // skip the words which cannot get into the roots
+      int phoncheck = scan->ph && (abs(n - (int) hp->clen) <= 3);
+      if (!(hp->var & H_OPT_PHON)) {
+        int bound = ngram_bound(scan, HENTRY_WORD(hp));
+        if ((bound <= scores[lp]) && (!phoncheck || (bound <= 2))) continue;
+      }
+
+      int sc = ngram(3, word, HENTRY_WORD(hp), NGRAM_LONGER_WORSE + low) +
+          leftcommonsubstring(word, HENTRY_WORD(hp));
+
+      // check special pronounciation
+      if ((hp->var & H_OPT_PHON) && copy_field(f, HENTRY_DATA(hp), MORPH_PHON)) {
+        int sc2 = ngram(3, word, f, NGRAM_LONGER_WORSE + low) +
+            + leftcommonsubstring(word, f);
+        if (sc2 > sc) sc = sc2;
+      }
+
+      int scphon = -20000;
+      if (phoncheck && (sc > 2)) {
+        if (utf8) {
+          w_char _w[MAXSWL];
+          int _wl = u8_u16(_w, MAXSWL, HENTRY_WORD(hp));
+          mkallcap_utf(_w, _wl, langnum);
+          u16_u8(candidate, MAXSWUTF8L, _w, _wl);
+        } else {
+          strcpy(candidate, HENTRY_WORD(hp));
+          mkallcap(candidate, csconv);
+        }
+        phonet(candidate, target2, -1, *(scan->ph));
+        scphon = 2 * ngram(3, (char *) scan->target, target2, NGRAM_LONGER_WORSE);
+      }
+
+      if (sc > scores[lp]) {
+        ngroot root = { i, sc, hp };
+        found->roots.push_back(root);
+        scores[lp] = sc;
+        int lval = sc;
+        for (int j = 0; j < MAX_ROOTS; j++)
+          if (scores[j] < lval) {
+            lp = j;
+            lval = scores[j];
+          }
+      }
+
+      if (scphon > scoresphon[lpphon]) {
+        ngroot root = { i, scphon, hp };
+        found->rootsphon.push_back(root);
+        scoresphon[lpphon] = scphon;
+        int lval = scphon;
+        for (int j = 0; j < MAX_ROOTS; j++)
+          if (scoresphon[j] < lval) {
+            lpphon = j;
+            lval = scoresphon[j];
+          }
+      }
+    }
+  }
+}
+
+// replay the logged roots of the parts in the hash table walk order: the
+// best roots of a part are the best of its words, and a root, which didn't
+// get into them, can't get into the best roots of all words, so the roots
+// (and their order) are the same as of the search in one part
+void SuggestMgr::ngram_replay(const ngpart * found, int parts, int md, int phon,
+    struct hentry ** roots, int * scores)
+{
+  int lp = MAX_ROOTS - 1;
+  for (int i = 0; i < md; i++) {
+    for (int part = 0; part < parts; part++) {
+      const std::vector<ngroot> & log = (phon) ? found[part].rootsphon : found[part].roots;
+      for (size_t k = 0; k < log.size(); k++) {
+        if ((log[k].table != i) || (log[k].score <= scores[lp])) continue;
+        scores[lp] = log[k].score;
+        roots[lp] = log[k].hp;
+        int lval = log[k].score;
+        for (int j = 0; j < MAX_ROOTS; j++)
+          if (scores[j] < lval) {
+            lp = j;
+            lval = scores[j];
+          }
+      }
+    }
+  }
+}
+
+// number of parts of the root word search: part 0 is searched by
+// the calling thread, the others by the threads of the pool
+int SuggestMgr::ngram_parts(int parts)
+{
+  if (parts < 2) return 1;
+  if (!pool) {
+    pool = new (std::nothrow) ngpool;
+    if (!pool) return 1;
+    pool->generation = 0;
+    pool->running = 0;
+    pool->quit = 0;
+    pool->scan = NULL;
+    pool->pHMgr = NULL;
+    pool->md = 0;
+    pool->parts = 1;
+    pool->found = NULL;
+    for (int part = 1; part < parts; part++) {
+      try {
+        pool->threads.push_back(std::thread(&SuggestMgr::ngram_pool, this, part));
+      } catch (...) {
+        // no more threads: search with the started ones
+        break;
+      }
+    }
+  }
+  return (int) pool->threads.size() + 1;
+}
+
+// thread of the pool: searches its part of every new search
+void SuggestMgr::ngram_pool(int part)
+{
+  unsigned int generation = 0;
+  std::unique_lock<std::mutex> lock(pool->mutex);
+  for (;;) {
+    while (!pool->quit && (pool->generation == generation)) pool->start.wait(lock);
+    if (pool->quit) return;
+    generation = pool->generation;
+    lock.unlock();
+    if (part < pool->parts) ngram_roots(pool->scan, pool->pHMgr, pool->md, part, pool->parts, pool->found + part);
+    lock.lock();
+    if (--pool->running == 0) pool->done.notify_one();
+  }
+}
+
 // see if a candidate suggestion is spelled correctly
 // needs to check both root words and words with affixes
 
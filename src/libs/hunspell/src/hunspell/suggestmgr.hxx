@@ -15,6 +15,13 @@
 #define MINTIMER 100
 #define MAXPLUSTIMER 100
 
+// ngram suggestion: wall clock limit (in ms) of the root word search,
+// the best roots found so far are used when it runs out
+#define NGRAM_TIMELIMIT 250
+// hash tables with more slots are searched by several threads
+#define NGRAM_MINSLOTS 32768
+#define NGRAM_MAXTHREADS 4
+
 #define NGRAM_LONGER_WORSE  (1 << 0)
 #define NGRAM_ANY_MISMATCH  (1 << 1)
 #define NGRAM_LOWERING      (1 << 2)
@@ -50,6 +57,9 @@ class LIBHUNSPELL_DLL_EXPORTED SuggestMgr
   int             maxcpdsugs;
   int             complexprefixes;
 
+  struct ngpool;
+  ngpool *        pool;           // threads of the ngram root word search
+
 
 public:
   SuggestMgr(const char * tryme, int maxn, AffixMgr *aptr);
@@ -66,6 +76,10 @@ public:
   char * suggest_morph_for_spelling_error(const char * word);
 
 private:
+   struct ngscan;
+   struct ngroot;
+   struct ngpart;
+
    int testsug(char** wlst, const char * candidate, int wl, int ns, int cpdsuggest,
      int * timer, clock_t * timelimit);
    int checkword(const char *, int, int, int *, clock_t *);
@@ -97,6 +111,13 @@ private:
    int mapchars(char**, const char *, int, int);
    int map_related(const char *, char *, int, int, char ** wlst, int, int, const mapentry*, int, int *, clock_t *);
    int ngram(int n, char * s1, const char * s2, int opt);
+   int ngram_bound(const ngscan * scan, const char * s2);
+   void ngram_roots(const ngscan * scan, HashMgr ** pHMgr, int md, int part, int parts,
+     ngpart * found);
+   int ngram_parts(int parts);
+   void ngram_pool(int thread);
+   static void ngram_replay(const ngpart * found, int parts, int md, int phon,
+     struct hentry ** roots, int * scores);
    int mystrlen(const char * word);
    int leftcommonsubstring(char * s1, const char * s2);
    int commoncharacterpositions(char * s1, const char * s2, int * is_swap);
@@ -6,6 +6,12 @@
 
 #include "mythes.h"
 
+#include <QtCore/QDateTime>
+#include <QtCore/QFileInfo>
+#include <QtCore/QSaveFile>
+
+#include <algorithm>
+
 // some basic utility routines
 
 // string duplication routine
@@ -22,21 +28,118 @@ char * mystrdup(const char * p)
 }
 
 
-// return index of char in string
-int mystr_indexOfChar(const char * d, int c)
-{
-  const char * p = strchr(d,c);
-  if (p) return (int)(p-d);
-  return -1;
-}
+// binary index layout:
+//   header, encoding (null terminated, padded to 4 bytes),
+//   count pairs of (word offset in string table, entry offset in data file),
+//   string table of null terminated words sorted with strcmp
+namespace {
+	const char IDX_MAGIC[8] = { 'M', 'Y', 'T', 'H', 'B', 'I', 'N', '2' };
+	const quint32 IDX_BYTE_ORDER = 0x01020304;
+
+	struct idxheader {
+		char magic[8];
+		quint32 byteorder;
+		quint32 count;
+		quint32 encodinglen;      /* including padding */
+		quint32 datsize;          /* size of data file the index was built for */
+		quint32 idxsize;          /* size of text index the binary one was built from */
+		quint32 idxmtime;         /* modification time of text index, seconds since epoch */
+	};
+
+	// number of decoded entries kept for repeated lookups
+	const size_t CACHE_SIZE = 16;
+
+	// end of the text line starting at p
+	const char* lineEnd(const char* p, const char* end)
+	{
+		const char* e = static_cast<const char*>(memchr(p, '\n', end - p));
+		return e ? e : end;
+	}
 
+	// compare not null terminated text with null terminated word like strcmp does
+	int compareWord(const char* wrd, int len, const char* word)
+	{
+		const size_t wl = strlen(word);
+		const size_t n = std::min(static_cast<size_t>(len), wl);
+		const int r = memcmp(wrd, word, n);
+		if (r != 0) return r;
+		if (static_cast<size_t>(len) < wl) return -1;
+		return static_cast<size_t>(len) > wl ? 1 : 0;
+	}
 
-// remove cross-platform text line end characters
-void mychomp(char * s)
-{
-  int k = strlen(s);
-  if ((k > 0) && ((*(s+k-1)=='\r') || (*(s+k-1)=='\n'))) *(s+k-1) = '\0';
-  if ((k > 1) && (*(s+k-2) == '\r')) *(s+k-2) = '\0';
+	// modification time of the file as stored in the binary index
+	quint32 modificationTime(const QFileInfo& info)
+	{
+		return static_cast<quint32>(info.lastModified().toMSecsSinceEpoch() / 1000);
+	}
+
+	// build binary index from the text one
+	QByteArray buildIndex(const char* idxpath, qint64 datsize)
+	{
+		QFile idx(QString::fromLocal8Bit(idxpath));
+		const QFileInfo idxinfo(idx);
+		if (!idx.open(QIODevice::ReadOnly)) return QByteArray();
+		QByteArray text = idx.readAll();
+		idx.close();
+		text.append('\0');
+
+		// split into lines, first two are encoding and entries count
+		std::vector<char*> lines;
+		char* p = text.data();
+		char* end = p + text.size() - 1;
+		while (p < end) {
+			char* e = static_cast<char*>(memchr(p, '\n', end - p));
+			if (!e) e = end;
+			*e = '\0';
+			if (e > p && *(e-1) == '\r') *(e-1) = '\0';
+			lines.push_back(p);
+			p = e + 1;
+		}
+		if (lines.size() < 2) return QByteArray();
+		const char* encoding = lines[0];
+
+		// parse "word|offset" entries
+		std::vector<std::pair<const char*, quint32> > entries;
+		entries.reserve(lines.size() - 2);
+		for (size_t i = 2; i < lines.size(); i++) {
+			char* sep = strchr(lines[i], '|');
+			if (!sep) continue;
+			*sep = '\0';
+			entries.push_back(std::make_pair(lines[i], static_cast<quint32>(strtoul(sep + 1, NULL, 10))));
+		}
+		std::stable_sort(entries.begin(), entries.end(),
+			[] (const std::pair<const char*, quint32>& a, const std::pair<const char*, quint32>& b) {
+				return strcmp(a.first, b.first) < 0;
+			});
+
+		// lay out the binary image
+		idxheader header;
+		memcpy(header.magic, IDX_MAGIC, sizeof(IDX_MAGIC));
+		header.byteorder = IDX_BYTE_ORDER;
+		header.count = static_cast<quint32>(entries.size());
+		header.encodinglen = static_cast<quint32>((strlen(encoding) + 1 + 3) & ~size_t(3));
+		header.datsize = static_cast<quint32>(datsize);
+		header.idxsize = static_cast<quint32>(idxinfo.size());
+		header.idxmtime = modificationTime(idxinfo);
+
+		QByteArray result;
+		result.append(reinterpret_cast<const char*>(&header), sizeof(header));
+		QByteArray encodingData(static_cast<int>(header.encodinglen), '\0');
+		memcpy(encodingData.data(), encoding, strlen(encoding));
+		result.append(encodingData);
+
+		QByteArray table;
+		QByteArray strings;
+		table.reserve(static_cast<int>(entries.size() * 2 * sizeof(quint32)));
+		for (size_t i = 0; i < entries.size(); i++) {
+			const quint32 pair[2] = { static_cast<quint32>(strings.size()), entries[i].second };
+			table.append(reinterpret_cast<const char*>(pair), sizeof(pair));
+			strings.append(entries[i].first, static_cast<int>(strlen(entries[i].first)) + 1);
+		}
+		result.append(table);
+		result.append(strings);
+		return result;
+	}
 }
 
 
@@ -44,15 +147,15 @@ MyThes::MyThes(const char* idxpath, const char * datpath)
 {
 	nw = 0;
 	encoding = NULL;
-	list = NULL;
 	offst = NULL;
+	strings = NULL;
+	datdata = NULL;
+	datsize = 0;
 
 	if (thInitialize(idxpath, datpath) != 1) {
 		fprintf(stderr,"Error - can't open %s or %s\n",idxpath, datpath);
 		fflush(stderr);
-		if (encoding) free((void*)encoding);
-		if (list)  free((void*)list);
-		if (offst) free((void*)offst);
+		thCleanup();
 		// did not initialize properly - throw exception?
 	}
 }
@@ -63,95 +166,119 @@ MyThes::~MyThes()
 	if (thCleanup() != 1) {
 		/* did not cleanup properly - throw exception? */
 	}
-	if (encoding) free((void*)encoding);
-	encoding = NULL;
-	list = NULL;
-	offst = NULL;
 }
 
 
-int MyThes::thInitialize(const char* idxpath, const char* datpath)
+bool MyThes::compileIndex(const char* idxpath, const char* datpath, const char* binpath)
 {
+	const QByteArray index = buildIndex(idxpath, QFileInfo(QString::fromLocal8Bit(datpath)).size());
+	if (index.isEmpty()) return false;
 
-	// open the index file
-	FILE * pifile = fopen(idxpath,"r");
-	if (!pifile) {
-		pifile = NULL;
-		return 0;
-	}
-
-	// parse in encoding and index size */
-	char * wrd;
-	wrd = (char *)calloc(1, MAX_WD_LEN);
-	int len = readLine(pifile,wrd,MAX_WD_LEN);
-	encoding = mystrdup(wrd);
-	len = readLine(pifile,wrd,MAX_WD_LEN);
-	int idxsz = atoi(wrd);
-
+	QSaveFile bin(QString::fromLocal8Bit(binpath));
+	if (!bin.open(QIODevice::WriteOnly)) return false;
+	bin.write(index);
+	return bin.commit();
+}
 
-	// now allocate list, offst for the given size
-	list = (char**)   calloc(idxsz,sizeof(char*));
-	offst = (unsigned int*) calloc(idxsz,sizeof(unsigned int));
 
-	if ( (!(list)) || (!(offst)) ) {
-	   fprintf(stderr,"Error - bad memory allocation\n");
-	   fflush(stderr);
-	   return 0;
+int MyThes::thInitialize(const char* idxpath, const char* datpath)
+{
+	// map the data file, lookups parse entries right from it
+	datfile.setFileName(QString::fromLocal8Bit(datpath));
+	if (!datfile.open(QIODevice::ReadOnly)) return 0;
+	datsize = datfile.size();
+	datdata = reinterpret_cast<const char*>(datfile.map(0, datsize));
+	if (!datdata) {
+		datbuffer = datfile.readAll();
+		datfile.close();
+		datdata = datbuffer.constData();
+		datsize = datbuffer.size();
 	}
-
-	// now parse the remaining lines of the index
-	len = readLine(pifile,wrd,MAX_WD_LEN);
-	while (len > 0)
-	{
-		int np = mystr_indexOfChar(wrd,'|');
-		if (nw < idxsz) {
-		   if (np >= 0) {
-			  *(wrd+np) = '\0';
-			  list[nw] = (char *)calloc(1,(np+1));
-			  memcpy((list[nw]),wrd,np);
-			  offst[nw] = atoi(wrd+np+1);
-			  nw++;
-	   }
+	if (datsize <= 0) return 0;
+
+	// use precompiled index when it was built from the current text index,
+	// the text one may be left out when only the binary index is shipped
+	const QString idxname = QString::fromLocal8Bit(idxpath);
+	const QString binname = idxname + ".bin";
+	const QFileInfo idxinfo(idxname);
+	if (QFileInfo::exists(binname)) {
+		idxfile.setFileName(binname);
+		if (idxfile.open(QIODevice::ReadOnly)) {
+			const uchar* data = idxfile.map(0, idxfile.size());
+			if (data && attachIndex(reinterpret_cast<const char*>(data), idxfile.size(), idxinfo)) {
+				return 1;
+			}
+			idxfile.close();
 		}
-		len = readLine(pifile,wrd,MAX_WD_LEN);
 	}
 
-	free((void *)wrd);
-	fclose(pifile);
-	pifile=NULL;
-
-	/* next open the data file */
-	pdfile = fopen(datpath,"r");
-	if (!pdfile) {
-		pdfile = NULL;
-		return 0;
+	// otherwise convert the text index and save it for the next time,
+	// failure to save only means conversion will be repeated
+	idxbuffer = buildIndex(idxpath, datsize);
+	if (!attachIndex(idxbuffer.constData(), idxbuffer.size(), idxinfo)) return 0;
+	QSaveFile bin(binname);
+	if (bin.open(QIODevice::WriteOnly)) {
+		bin.write(idxbuffer);
+		bin.commit();
 	}
 
 	return 1;
 }
 
 
-int MyThes::thCleanup()
+bool MyThes::attachIndex(const char* data, qint64 size, const QFileInfo& idxinfo)
 {
-	/* first close the data file */
-	if (pdfile) {
-		fclose(pdfile);
-		pdfile=NULL;
+	if (size < static_cast<qint64>(sizeof(idxheader))) return false;
+	const idxheader* header = reinterpret_cast<const idxheader*>(data);
+	if (memcmp(header->magic, IDX_MAGIC, sizeof(IDX_MAGIC)) != 0
+		|| header->byteorder != IDX_BYTE_ORDER
+		|| header->datsize != static_cast<quint32>(datsize)
+		|| header->encodinglen == 0) {
+		return false;
+	}
+	if (idxinfo.exists()
+		&& (header->idxsize != static_cast<quint32>(idxinfo.size())
+			|| header->idxmtime != modificationTime(idxinfo))) {
+		return false;
 	}
 
-	/* now free up all the allocated strings on the list */
-	for (int i=0; i < nw; i++)
-	{
-		if (list[i]) {
-			free(list[i]);
-			list[i] = 0;
-		}
+	const qint64 tablepos = sizeof(idxheader) + static_cast<qint64>(header->encodinglen);
+	const qint64 stringspos = tablepos + static_cast<qint64>(header->count) * 2 * sizeof(quint32);
+	if (stringspos > size || data[tablepos - 1] != '\0') return false;
+
+	// all words must lie inside the string table and be terminated
+	if (header->count > 0 && data[size - 1] != '\0') return false;
+	const quint32* table = reinterpret_cast<const quint32*>(data + tablepos);
+	for (quint32 i = 0; i < header->count; i++) {
+		if (stringspos + table[i * 2] >= size) return false;
 	}
 
-	if (list)  free((void*)list);
-	if (offst) free((void*)offst);
+	if (encoding) free(encoding);
+	encoding = mystrdup(data + sizeof(idxheader));
+	offst = table;
+	strings = data + stringspos;
+	nw = static_cast<int>(header->count);
+	return true;
+}
+
+
+int MyThes::thCleanup()
+{
+	cache.clear();
 
 	nw = 0;
+	offst = NULL;
+	strings = NULL;
+	idxfile.close();
+	idxbuffer.clear();
+
+	datdata = NULL;
+	datsize = 0;
+	datfile.close();
+	datbuffer.clear();
+
+	if (encoding) free((void*)encoding);
+	encoding = NULL;
 	return 1;
 }
 
@@ -169,111 +296,144 @@ int MyThes::Lookup(const char * pText, int len, mentry** pme)
 
 	*pme = NULL;
 
+	const thentry* entry = lookupEntry(pText, len);
+	if (!entry) return 0;
+	const mentry* cached = entry->meanings.data();
+	const int nmeanings = static_cast<int>(entry->meanings.size());
+
+	// copy decoded meanings, the caller owns them
+	*pme = (mentry*) malloc( nmeanings * sizeof(mentry) );
+	if (!(*pme)) return 0;
+
+	for (int i = 0; i < nmeanings; i++) {
+		mentry* pm = *pme + i;
+		pm->defn = mystrdup(cached[i].defn);
+		pm->count = cached[i].count;
+		pm->psyns = (char **) malloc(pm->count * sizeof(char*));
+		for (int j = 0; j < pm->count; j++) {
+			pm->psyns[j] = mystrdup(cached[i].psyns[j]);
+		}
+	}
+
+	return nmeanings;
+}
+
+
+const MyThes::thentry* MyThes::lookupEntry(const char * pText, int len)
+{
 	// handle the case of missing file or file related errors
-	if (! pdfile) return 0;
+	if (!datdata || nw == 0) return NULL;
 
-	long offset = 0;
+	const int idx = binsearch(pText, len);
+	if (idx < 0) return NULL;
 
-	/* copy search word and make sure null terminated */
-	char * wrd = (char *) calloc(1,(len+1));
-	memcpy(wrd,pText,len);
+	const thentry* entry = cachedEntry(idx);
+	if (!entry || entry->meanings.empty()) return NULL;
+	return entry;
+}
 
-	/* find it in the list */
-	int idx = binsearch(wrd,list,nw);
-	free(wrd);
-	if (idx < 0) return 0;
 
-	// now seek to the offset
-	offset = (long) offst[idx];
-	int rc = fseek(pdfile,offset,SEEK_SET);
-	if (rc) {
-	   return 0;
+const MyThes::thentry* MyThes::cachedEntry(int idx)
+{
+	for (std::list<thentry>::iterator it = cache.begin(); it != cache.end(); ++it) {
+		if (it->idx == idx) {
+			cache.splice(cache.begin(), cache, it);
+			return &cache.front();
+		}
 	}
 
-	// grab the count of the number of meanings
-	// and allocate a list of meaning entries
-	char * buf = NULL;
-	buf  = (char *) malloc( MAX_LN_LEN );
-	if (!buf) return 0;
-	readLine(pdfile, buf, (MAX_LN_LEN-1));
-	int np = mystr_indexOfChar(buf,'|');
-	if (np < 0) {
-		 free(buf);
-		 return 0;
-	}
-	int nmeanings = atoi(buf+np+1);
-	*pme = (mentry*) malloc( nmeanings * sizeof(mentry) );
-	if (!(*pme)) {
-		free(buf);
-		return 0;
+	cache.push_front(thentry());
+	if (!decodeEntry(idx, cache.front())) {
+		cache.pop_front();
+		return NULL;
 	}
+	if (cache.size() > CACHE_SIZE) cache.pop_back();
+	return &cache.front();
+}
 
-	// now read in each meaning and parse it to get defn, count and synonym lists
-	mentry* pm = *(pme);
-	char dfn[MAX_WD_LEN];
 
-	for (int j = 0; j < nmeanings; j++) {
-		readLine(pdfile, buf, (MAX_LN_LEN-1));
+bool MyThes::decodeEntry(int idx, thentry& entry) const
+{
+	entry.idx = idx;
+
+	// now go to the offset
+	const quint32 offset = offst[idx * 2 + 1];
+	if (offset >= datsize) return false;
+	const char* end = datdata + datsize;
+	const char* p = datdata + offset;
+
+	// grab the count of the number of meanings from "word|count"
+	const char* e = lineEnd(p, end);
+	const char* sep = static_cast<const char*>(memchr(p, '|', e - p));
+	if (!sep) return false;
+	int nmeanings = 0;
+	for (const char* d = sep + 1; d < e && *d >= '0' && *d <= '9'; d++) {
+		nmeanings = nmeanings * 10 + (*d - '0');
+	}
+	p = e < end ? e + 1 : end;
 
-		pm->count = 0;
-		pm->psyns = NULL;
-		pm->defn = NULL;
+	// collect strings as offsets first, text may reallocate while growing
+	std::vector<int> defnoffsets;
+	std::vector<int> synoffsets;
+	std::vector<int> counts;
+
+	for (int j = 0; j < nmeanings && p < end; j++) {
+		e = lineEnd(p, end);
+		const char* le = (e > p && *(e-1) == '\r') ? e - 1 : e;
 
 		// store away the part of speech for later use
-		char * p = buf;
-		char * pos = NULL;
-		np = mystr_indexOfChar(p,'|');
-		if (np >= 0) {
-		   *(buf+np) = '\0';
-	   pos = mystrdup(p);
-		   p = p + np + 1;
-	} else {
-		  pos = mystrdup("");
+		const char* pos = p;
+		const char* posend = p;
+		const char* d = p;
+		sep = static_cast<const char*>(memchr(p, '|', le - p));
+		if (sep) {
+			posend = sep;
+			d = sep + 1;
 		}
 
-		// count the number of fields in the remaining line
-		int nf = 1;
-		char * d = p;
-		np = mystr_indexOfChar(d,'|');
-		while ( np >= 0 ) {
-	  nf++;
-		  d = d + np + 1;
-		  np = mystr_indexOfChar(d,'|');
-	}
-	pm->count = nf;
-		pm->psyns = (char **) malloc(nf*sizeof(char*));
-
 		// fill in the synonym list
-		d = p;
-		for (int j = 0; j < nf; j++) {
-			np = mystr_indexOfChar(d,'|');
-			if (np > 0) {
-		  *(d+np) = '\0';
-			  pm->psyns[j] = mystrdup(d);
-			  d = d + np + 1;
-			} else {
-			  pm->psyns[j] = mystrdup(d);
-		}
+		const int firstsyn = static_cast<int>(synoffsets.size());
+		while (true) {
+			sep = static_cast<const char*>(memchr(d, '|', le - d));
+			const char* synend = sep ? sep : le;
+			synoffsets.push_back(entry.text.size());
+			entry.text.append(d, static_cast<int>(synend - d));
+			entry.text.append('\0');
+			if (!sep) break;
+			d = sep + 1;
 		}
+		counts.push_back(static_cast<int>(synoffsets.size()) - firstsyn);
 
 		// add pos to first synonym to create the definition
-		int k = strlen(pos);
-		int m = strlen(pm->psyns[0]);
+		const int k = static_cast<int>(posend - pos);
+		const int m = static_cast<int>(strlen(entry.text.constData() + synoffsets[firstsyn]));
+		defnoffsets.push_back(entry.text.size());
 		if ((k+m) < (MAX_WD_LEN - 1)) {
-			 strncpy(dfn,pos,k);
-			 *(dfn+k) = ' ';
-			 strncpy((dfn+k+1),(pm->psyns[0]),m+1);
-			 pm->defn = mystrdup(dfn);
-	} else {
-		 pm->defn = mystrdup(pm->psyns[0]);
+			entry.text.append(pos, k);
+			entry.text.append(' ');
+		}
+		entry.text.append(entry.text.mid(synoffsets[firstsyn], m));
+		entry.text.append('\0');
+
+		p = e < end ? e + 1 : end;
 	}
-		free(pos);
-		pm++;
 
+	// resolve offsets into pointers now that text is complete
+	char* base = entry.text.data();
+	entry.synonyms.resize(synoffsets.size());
+	for (size_t i = 0; i < synoffsets.size(); i++) {
+		entry.synonyms[i] = base + synoffsets[i];
+	}
+	entry.meanings.resize(counts.size());
+	int syn = 0;
+	for (size_t i = 0; i < counts.size(); i++) {
+		entry.meanings[i].defn = base + defnoffsets[i];
+		entry.meanings[i].count = counts[i];
+		entry.meanings[i].psyns = entry.synonyms.data() + syn;
+		syn += counts[i];
 	}
-	free(buf);
 
-	return nmeanings;
+	return true;
 }
 
 
@@ -306,53 +466,29 @@ void MyThes::CleanUpAfterLookup(mentry ** pme, int nmeanings)
 }
 
 
-// read a line of text from a text file stripping
-// off the line terminator and replacing it with
-// a null string terminator.
-// returns:  -1 on error or the number of characters in
-//             in the returning string
-
-// A maximum of nc characters will be returned
-
-int MyThes::readLine(FILE * pf, char * buf, int nc)
-{
-
-  if (fgets(buf,nc,pf)) {
-	mychomp(buf);
-	return strlen(buf);
-  }
-  return -1;
-}
-
-
 
-//  performs a binary search on null terminated character
-//  strings
+//  performs a binary search of the not null terminated text
+//  in the sorted string table
 //
 //  returns: -1 on not found
-//           index of wrd in the list[]
+//           index of wrd in the list
 
-int MyThes::binsearch(char * sw, char* list[], int nlst)
+int MyThes::binsearch(const char * sw, int len) const
 {
-	int lp, up, mp, j, indx;
-	lp = 0;
-	up = nlst-1;
-	indx = -1;
-	if (strcmp(sw,list[lp]) < 0) return -1;
-	if (strcmp(sw,list[up]) > 0) return -1;
-	while (indx < 0 ) {
-		mp = (int)((lp+up) >> 1);
-		j = strcmp(sw,list[mp]);
-		if ( j > 0) {
+	int lp = 0;
+	int up = nw - 1;
+	while (lp <= up) {
+		const int mp = (lp + up) >> 1;
+		const int j = compareWord(sw, len, strings + offst[mp * 2]);
+		if (j > 0) {
 			lp = mp + 1;
-		} else if (j < 0 ) {
+		} else if (j < 0) {
 			up = mp - 1;
 		} else {
-			indx = mp;
+			return mp;
 		}
-		if (lp > up) return -1;
 	}
-	return indx;
+	return -1;
 }
 
 char * MyThes::get_th_encoding()
@@ -360,4 +496,3 @@ char * MyThes::get_th_encoding()
   if (encoding) return encoding;
   return NULL;
 }
-
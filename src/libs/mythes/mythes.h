@@ -3,6 +3,13 @@
 
 #include "MyThesGlobal.h"
 
+#include <QtCore/QByteArray>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+
+#include <list>
+#include <vector>
+
 // some maximum sizes for buffers
 #define MAX_WD_LEN 200
 #define MAX_LN_LEN 16384
@@ -16,15 +23,34 @@ struct mentry {
 };
 
 
+// Modified version: the word list is kept in a compact binary index
+// (sorted string table plus offsets) that is memory-mapped together with
+// the data file, see compileIndex()
 class MYTHESSHARED_EXPORT MyThes
 {
 
 	int  nw;                  /* number of entries in thesaurus */
-	char**  list;               /* stores word list */
-	unsigned int* offst;              /* stores offset list */
-	char *  encoding;           /* stores text encoding; */
-
-	FILE  *pdfile;
+	const quint32* offst;     /* pairs of word offset in string table and offset in data file */
+	const char* strings;      /* sorted table of null terminated words */
+	char *  encoding;         /* stores text encoding; */
+
+	QFile  idxfile;           /* mapped binary index */
+	QByteArray idxbuffer;     /* binary index built in memory when it can't be mapped */
+	QFile  datfile;           /* mapped data file */
+	QByteArray datbuffer;     /* data file contents when it can't be mapped */
+	const char* datdata;
+	qint64 datsize;
+
+	// decoded entry of the data file, all strings are stored in text
+	struct thentry {
+		int idx;
+		QByteArray text;
+		std::vector<mentry> meanings;
+		std::vector<char*> synonyms;
+	};
+
+	// recently decoded entries, the most recent first
+	std::list<thentry> cache;
 
 	// disallow copy-constructor and assignment-operator for now
 	MyThes();
@@ -35,6 +61,11 @@ public:
 	MyThes(const char* idxpath, const char* datpath);
 	~MyThes();
 
+	// convert text index of the given data file to the binary format;
+	// the thesaurus picks up "<idxpath>.bin" automatically and creates it
+	// on first load when the folder is writable
+	static bool compileIndex(const char* idxpath, const char* datpath, const char* binpath);
+
 	// lookup text in index and return number of meanings
 	// each meaning entry has a defintion, synonym count and pointer
 	// when complete return the *original* meaning entry and count via
@@ -47,17 +78,27 @@ public:
 	char* get_th_encoding();
 
 private:
-	// Open index and dat files and load list array
+	// Open index and dat files and map them
 	int thInitialize (const char* indxpath, const char* datpath);
 
 	// internal close and cleanup dat and idx files
 	int thCleanup ();
 
-	// read a text line (\n terminated) stripping off line terminator
-	int readLine(FILE * pf, char * buf, int nc);
+	// point word list at the binary index, returns false if index is damaged
+	// or was built from another text index
+	bool attachIndex(const char* data, qint64 size, const QFileInfo& idxinfo);
+
+	// binary search of not null terminated text in the string table
+	int binsearch(const char * wrd, int len) const;
+
+	// decoded entry of the text with at least one meaning, NULL if there is none
+	const thentry* lookupEntry(const char * pText, int len);
+
+	// decoded entry from cache, decodes and caches it on miss
+	const thentry* cachedEntry(int idx);
 
-	// binary search on null terminated character strings
-	int binsearch(char * wrd, char* list[], int nlst);
+	// parse data file entry into the given cache item
+	bool decodeEntry(int idx, thentry& entry) const;
 
 };
 
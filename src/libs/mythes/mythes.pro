@@ -6,7 +6,7 @@
 
 QT       -= gui
 
-CONFIG += qt thread warn_on staticlib
+CONFIG += qt thread warn_on staticlib c++11
 
 TARGET = mythes
 TEMPLATE = lib
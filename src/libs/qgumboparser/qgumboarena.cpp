@@ -0,0 +1,76 @@
+#include <algorithm>
+#include <cstdlib>
+#include "qgumboarena.h"
+
+namespace {
+
+const size_t ALIGNMENT = alignof(std::max_align_t);
+
+size_t aligned(size_t size)
+{
+    return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+}
+
+} /* namespace */
+
+QGumboArena::QGumboArena(size_t firstBlockSize) :
+    options_(kGumboDefaultOptions),
+    blockSize_(aligned(std::max<size_t>(firstBlockSize, ALIGNMENT)))
+{
+    options_.allocator = &QGumboArena::allocateCallback;
+    options_.deallocator = &QGumboArena::deallocateCallback;
+    options_.userdata = this;
+}
+
+QGumboArena::~QGumboArena()
+{
+    for (char* block : blocks_)
+        std::free(block);
+}
+
+void* QGumboArena::allocate(size_t size)
+{
+    size = aligned(std::max<size_t>(size, 1));
+
+    if (size > static_cast<size_t>(end_ - current_)) {
+        // a large buffer gets a block of its own, the current one stays in use
+        if (size >= blockSize_ / 2) {
+            char* block = static_cast<char*>(std::malloc(size));
+            if (block)
+                blocks_.push_back(block);
+            return block;
+        }
+
+        char* block = static_cast<char*>(std::malloc(blockSize_));
+        if (!block)
+            return nullptr;
+        blocks_.push_back(block);
+        current_ = block;
+        end_ = block + blockSize_;
+        last_ = nullptr;
+        blockSize_ *= 2;
+    }
+
+    last_ = current_;
+    current_ += size;
+    return last_;
+}
+
+void QGumboArena::deallocate(void* ptr)
+{
+    // temporary buffers are often freed right after use
+    if (ptr && ptr == last_) {
+        current_ = last_;
+        last_ = nullptr;
+    }
+}
+
+void* QGumboArena::allocateCallback(void* arena, size_t size)
+{
+    return static_cast<QGumboArena*>(arena)->allocate(size);
+}
+
+void QGumboArena::deallocateCallback(void* arena, void* ptr)
+{
+    static_cast<QGumboArena*>(arena)->deallocate(ptr);
+}
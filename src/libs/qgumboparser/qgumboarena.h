@@ -0,0 +1,38 @@
+#ifndef QGUMBOARENA_H
+#define QGUMBOARENA_H
+
+#include <cstddef>
+#include <vector>
+#include "gumbo-parser/src/gumbo.h"
+
+/**
+ * Bump allocator for one parse: the whole gumbo tree is freed at once
+ * with the arena, so deallocate() only takes back the last allocation.
+ */
+class QGumboArena
+{
+public:
+    explicit QGumboArena(size_t firstBlockSize);
+    ~QGumboArena();
+
+    void* allocate(size_t size);
+    void deallocate(void* ptr);
+
+    const GumboOptions* options() const { return &options_; }
+
+private:
+    QGumboArena(const QGumboArena&) = delete;
+    QGumboArena& operator=(const QGumboArena&) = delete;
+
+    static void* allocateCallback(void* arena, size_t size);
+    static void deallocateCallback(void* arena, void* ptr);
+
+    GumboOptions options_;
+    std::vector<char*> blocks_;
+    char* current_ = nullptr;
+    char* end_ = nullptr;
+    char* last_ = nullptr;
+    size_t blockSize_;
+};
+
+#endif // QGUMBOARENA_H
@@ -1,9 +1,21 @@
 #include <QByteArray>
 #include <QString>
 #include <stdexcept>
+#include "qgumboarena.h"
 #include "qgumbodocument.h"
 #include "qgumbonode.h"
 
+namespace {
+
+// gumbo allocates about ten bytes per byte of html,
+// so the whole tree usually fits into the first block of the arena
+size_t arenaSize(int htmlLength)
+{
+    return static_cast<size_t>(htmlLength) * 10 + 64 * 1024;
+}
+
+} /* namespace */
+
 QGumboDocument QGumboDocument::parse(const char *utf8data)
 {
     if (!utf8data)
@@ -23,10 +35,10 @@ QGumboDocument QGumboDocument::parse(QByteArray data)
 }
 
 QGumboDocument::QGumboDocument(QByteArray arr) :
-    options_(&kGumboDefaultOptions),
+    arena_(new QGumboArena(arenaSize(arr.length()))),
     sourceData_(arr)
 {
-    gumboOutput_ = gumbo_parse_with_options(options_,
+    gumboOutput_ = gumbo_parse_with_options(arena_->options(),
                                             sourceData_.constData(),
                                             sourceData_.length());
     if (!gumboOutput_)
@@ -35,19 +47,15 @@ QGumboDocument::QGumboDocument(QByteArray arr) :
 
 QGumboDocument::~QGumboDocument()
 {
-    if (gumboOutput_)
-        gumbo_destroy_output(options_, gumboOutput_);
-    if (options_ != &kGumboDefaultOptions)
-        delete options_;
+    // the output is freed together with the arena
 }
 
 QGumboDocument::QGumboDocument(QGumboDocument &&source) :
+    arena_(std::move(source.arena_)),
     gumboOutput_(source.gumboOutput_),
-    options_(source.options_),
     sourceData_(source.sourceData_)
 {
     source.gumboOutput_ = nullptr;
-    source.options_ = nullptr;
 }
 
 QGumboNode QGumboDocument::rootNode() const
@@ -2,9 +2,11 @@
 #define QGUMBODOCUMENT_H
 
 #include <QByteArray>
+#include <memory>
 #include "gumbo-parser/src/gumbo.h"
 
 class QString;
+class QGumboArena;
 class QGumboNode;
 
 class QGumboDocument
@@ -26,8 +28,8 @@ private:
     QGumboDocument(const QGumboDocument&) = delete;
     QGumboDocument& operator=(const QGumboDocument&) = delete;
 
+    std::unique_ptr<QGumboArena> arena_;
     GumboOutput *gumboOutput_ = nullptr;
-    const GumboOptions *options_ = nullptr;
     QByteArray sourceData_;
 };
 
@@ -45,6 +45,61 @@ bool iterateChildren(GumboNode* node, TFunctor& functor)
     return false;
 }
 
+bool isAscii(const char* data, int length)
+{
+    for (int i = 0; i < length; ++i) {
+        if (static_cast<uchar>(data[i]) >= 0x80)
+            return false;
+    }
+    return true;
+}
+
+char asciiToLower(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+}
+
+/**
+ * Case insensitive comparison of utf-8 values with a query,
+ * a value is decoded only if it has non-ascii characters
+ */
+class Utf8Matcher
+{
+public:
+    explicit Utf8Matcher(const QString& query) :
+        query_(query),
+        utf8Query_(query.toUtf8()),
+        isAsciiQuery_(isAscii(utf8Query_.constData(), utf8Query_.length()))
+    {
+    }
+
+    bool matches(const char* value, int length) const
+    {
+        if (length == utf8Query_.length()) {
+            int i = 0;
+            for (; i < length; ++i) {
+                const char a = value[i];
+                const char b = utf8Query_.at(i);
+                if (static_cast<uchar>(a) >= 0x80 || static_cast<uchar>(b) >= 0x80)
+                    break;
+                if (asciiToLower(a) != asciiToLower(b))
+                    return false;
+            }
+            if (i == length)
+                return true;
+        } else if (isAsciiQuery_ && isAscii(value, length)) {
+            return false;
+        }
+
+        return QString::fromUtf8(value, length).compare(query_, Qt::CaseInsensitive) == 0;
+    }
+
+private:
+    const QString& query_;
+    const QByteArray utf8Query_;
+    const bool isAsciiQuery_;
+};
+
 } /* namespace */
 
 QGumboNode::QGumboNode()
@@ -67,11 +122,12 @@ QGumboNodes QGumboNode::getElementById(const QString& nodeId) const
 
     QGumboNodes nodes;
 
-    auto functor = [&nodes, &nodeId] (GumboNode* node) {
+    const Utf8Matcher matcher(nodeId);
+
+    auto functor = [&nodes, &matcher] (GumboNode* node) {
         GumboAttribute* attr = gumbo_get_attribute(&node->v.element.attributes, ID_ATTRIBUTE);
         if (attr) {
-            const QString value = QString::fromUtf8(attr->value);
-            if (value.compare(nodeId, Qt::CaseInsensitive) == 0) {
+            if (matcher.matches(attr->value, static_cast<int>(strlen(attr->value)))) {
                 nodes.emplace_back(QGumboNode(node));
                 return true;
             }
@@ -112,18 +168,25 @@ QGumboNodes QGumboNode::getElementsByClassName(const QString& name) const
 
     QGumboNodes nodes;
 
-    auto functor = [&nodes, &name] (GumboNode* node) {
+    const Utf8Matcher matcher(name);
+
+    auto functor = [&nodes, &matcher] (GumboNode* node) {
         GumboAttribute* attr = gumbo_get_attribute(&node->v.element.attributes, CLASS_ATTRIBUTE);
         if (attr) {
-            const QString value = QString::fromUtf8(attr->value);
-            const QVector<QStringRef> parts =
-                    value.splitRef(QChar(' '), QString::SkipEmptyParts, Qt::CaseInsensitive);
-
-            for (const QStringRef& part: parts) {
-                if (part.compare(name, Qt::CaseInsensitive) == 0) {
+            // a space is a single byte in utf-8 too, so the classes are split by bytes
+            const char* part = attr->value;
+            while (*part) {
+                const char* partEnd = part;
+                while (*partEnd && *partEnd != ' ')
+                    ++partEnd;
+
+                if (partEnd != part
+                    && matcher.matches(part, static_cast<int>(partEnd - part))) {
                     nodes.emplace_back(QGumboNode(node));
                     break;
                 }
+
+                part = *partEnd ? partEnd + 1 : partEnd;
             }
         }
         return false;
@@ -189,20 +252,20 @@ QString QGumboNode::innerText() const
 {
     Q_ASSERT(ptr_);
 
-    QString text;
+    QByteArray text;
 
     auto functor = [&text] (GumboNode* node) {
         if (node->type == GUMBO_NODE_TEXT) {
-            text += QString::fromUtf8(node->v.text.text);
+            text += node->v.text.text;
         } else if (node->type == GUMBO_NODE_WHITESPACE) {
-            text += " ";
+            text += ' ';
         }
         return false;
     };
 
     iterateChildren(ptr_, functor);
 
-    return text;
+    return QString::fromUtf8(text);
 }
 
 QString QGumboNode::outerHtml() const
@@ -27,6 +27,7 @@ UI_DIR = $$DESTDIR/.ui
 #
 
 SOURCES += \
+    qgumboarena.cpp \
     qgumboattribute.cpp \
     qgumbodocument.cpp \
     qgumbonode.cpp \
@@ -43,6 +44,7 @@ SOURCES += \
     gumbo-parser/src/vector.c
 
 HEADERS += \
+    qgumboarena.h \
     qgumboattribute.h \
     qgumbodocument.h \
     qgumbonode.h \
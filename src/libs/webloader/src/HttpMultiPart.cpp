@@ -19,6 +19,197 @@
 #include "QMimeDatabase"
 #include <QtCore/QStringList>
 #include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QIODevice>
+#include <QtCore/QVector>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    /**
+     * @brief Устройство, последовательно читающее части тела запроса из памяти и из файлов
+     */
+    class HttpMultiPartDevice : public QIODevice
+    {
+    public:
+        explicit HttpMultiPartDevice(QObject* _parent) :
+            QIODevice(_parent)
+        {
+        }
+
+        /**
+         * @brief Добавить данные из памяти
+         */
+        void appendData(const QByteArray& _data) {
+            Segment segment;
+            segment.data = _data;
+            segment.size = _data.size();
+            appendSegment(segment);
+        }
+
+        /**
+         * @brief Добавить содержимое файла
+         * @note Размер фиксируется сейчас, т.к. именно он уходит в заголовок Content-Length
+         */
+        void appendFile(const QString& _filePath) {
+            Segment segment;
+            segment.filePath = _filePath;
+            segment.size = QFileInfo(_filePath).size();
+            appendSegment(segment);
+        }
+
+        bool open(OpenMode _mode) override {
+            if (_mode != ReadOnly) {
+                return false;
+            }
+
+            m_position = 0;
+            return QIODevice::open(ReadOnly | Unbuffered);
+        }
+
+        void close() override {
+            m_file.close();
+            QIODevice::close();
+        }
+
+        qint64 size() const override {
+            return m_size;
+        }
+
+        bool seek(qint64 _position) override {
+            if (_position > m_size
+                || !QIODevice::seek(_position)) {
+                return false;
+            }
+
+            m_position = _position;
+            return true;
+        }
+
+        bool atEnd() const override {
+            return m_position >= m_size;
+        }
+
+    protected:
+        qint64 readData(char* _data, qint64 _maxSize) override {
+            qint64 readed = 0;
+            while (readed < _maxSize
+                   && m_position < m_size) {
+                //
+                // Находим часть, в которую попадает текущая позиция
+                //
+                while (m_position < m_segments.at(m_segmentIndex).offset) {
+                    --m_segmentIndex;
+                }
+                while (m_position >= m_segments.at(m_segmentIndex).offset + m_segments.at(m_segmentIndex).size) {
+                    ++m_segmentIndex;
+                }
+                const Segment& segment = m_segments.at(m_segmentIndex);
+                const qint64 segmentPosition = m_position - segment.offset;
+                qint64 partSize = std::min(_maxSize - readed, segment.size - segmentPosition);
+
+                if (segment.filePath.isEmpty()) {
+                    std::memcpy(_data + readed, segment.data.constData() + segmentPosition, static_cast<size_t>(partSize));
+                } else {
+                    if (m_file.fileName() != segment.filePath
+                        || !m_file.isOpen()) {
+                        m_file.close();
+                        m_file.setFileName(segment.filePath);
+                        if (!m_file.open(QIODevice::ReadOnly)) {
+                            return -1;
+                        }
+                    }
+                    if (m_file.pos() != segmentPosition
+                        && !m_file.seek(segmentPosition)) {
+                        return -1;
+                    }
+                    //
+                    // Если файл укоротился после формирования заголовков, то отправить
+                    // заявленный объём уже не получится
+                    //
+                    partSize = m_file.read(_data + readed, partSize);
+                    if (partSize <= 0) {
+                        return -1;
+                    }
+                }
+
+                readed += partSize;
+                m_position += partSize;
+            }
+
+            return readed;
+        }
+
+        qint64 writeData(const char* _data, qint64 _maxSize) override {
+            Q_UNUSED(_data);
+            Q_UNUSED(_maxSize);
+            return -1;
+        }
+
+    private:
+        /**
+         * @brief Часть тела запроса
+         */
+        struct Segment {
+            /**
+             * @brief Данные из памяти
+             */
+            QByteArray data;
+
+            /**
+             * @brief Путь к файлу, если данные читаются из него
+             */
+            QString filePath;
+
+            /**
+             * @brief Позиция начала части в теле запроса
+             */
+            qint64 offset = 0;
+
+            /**
+             * @brief Размер части
+             */
+            qint64 size = 0;
+        };
+
+        void appendSegment(Segment& _segment) {
+            if (_segment.size <= 0) {
+                return;
+            }
+
+            _segment.offset = m_size;
+            m_size += _segment.size;
+            m_segments.append(_segment);
+        }
+
+    private:
+        /**
+         * @brief Части тела запроса
+         */
+        QVector<Segment> m_segments;
+
+        /**
+         * @brief Общий размер тела запроса
+         */
+        qint64 m_size = 0;
+
+        /**
+         * @brief Текущая позиция чтения
+         */
+        qint64 m_position = 0;
+
+        /**
+         * @brief Индекс части, из которой выполнялось последнее чтение
+         */
+        int m_segmentIndex = 0;
+
+        /**
+         * @brief Файл, из которого выполнялось последнее чтение
+         */
+        QFile m_file;
+    };
+}
 
 
 HttpPart::HttpPart(HttpPartType _type) :
@@ -112,38 +303,40 @@ void HttpMultiPart::addPart(const HttpPart& _part)
     m_parts.append(_part);
 }
 
-QByteArray HttpMultiPart::data()
+QIODevice* HttpMultiPart::createDevice(QObject* _parent) const
 {
-	QByteArray multiPartData;
-	foreach ( HttpPart httpPart, parts() ) {
-		QByteArray partData = makeDataFromPart( httpPart );
-		multiPartData.append( partData );
-	}
-	// Добавление отметки о завершении данных
-	{
-		QByteArray endData = makeEndData();
-		multiPartData.append( endData );
-	}
-	return multiPartData;
+    HttpMultiPartDevice* device = new HttpMultiPartDevice(_parent);
+    foreach (const HttpPart& httpPart, parts()) {
+        switch (httpPart.type()) {
+            case HttpPart::Text: {
+                device->appendData(makeDataFromTextPart(httpPart));
+                break;
+            }
+
+            case HttpPart::File: {
+                device->appendData(makeFilePartHeader(httpPart));
+                device->appendFile(httpPart.filePath());
+                device->appendData(crlf().toUtf8());
+                break;
+            }
+        }
+    }
+    // Добавление отметки о завершении данных
+    device->appendData(makeEndData());
+
+    device->open(QIODevice::ReadOnly);
+    return device;
 }
 
-QByteArray HttpMultiPart::makeDataFromPart(const HttpPart& _part)
+QByteArray HttpMultiPart::data()
 {
-	QByteArray partData;
-    switch (_part.type()) {
-	case HttpPart::Text: {
-        partData = makeDataFromTextPart( _part );
-		break;
-	}
-	case HttpPart::File: {
-        partData = makeDataFromFilePart( _part );
-		break;
-	}
-	}
-	return partData;
+    QIODevice* device = createDevice();
+    const QByteArray multiPartData = device->readAll();
+    delete device;
+    return multiPartData;
 }
 
-QByteArray HttpMultiPart::makeDataFromTextPart(const HttpPart& _part)
+QByteArray HttpMultiPart::makeDataFromTextPart(const HttpPart& _part) const
 {
 	QByteArray partData;
 
@@ -155,13 +348,12 @@ QByteArray HttpMultiPart::makeDataFromTextPart(const HttpPart& _part)
                 QString("Content-Disposition: form-data; name=\"%1\"%3%3%2")
                 .arg(_part.name(), _part.value(), crlf())
 				);
-
     partData.append(crlf());
 
 	return partData;
 }
 
-QByteArray HttpMultiPart::makeDataFromFilePart(const HttpPart& _part)
+QByteArray HttpMultiPart::makeFilePartHeader(const HttpPart& _part) const
 {
 	QByteArray partData;
 
@@ -169,35 +361,24 @@ QByteArray HttpMultiPart::makeDataFromFilePart(const HttpPart& _part)
     partData.append(boundary());
     partData.append(crlf());
 
-    {
-        // Определение mime типа файла
-        QMimeDatabase mimeTypeDetector;
-        QString contentType = mimeTypeDetector.mimeTypeForFile(_part.filePath()).name();
-
-		partData.append(
-                    QString("Content-Disposition: form-data; name=\"%1\"; filename=\"%2\"%4"
-							 "Content-Type: %3%4%4"
-							 )
-                    .arg(_part.name(),
-                          _part.fileName(),
-						  contentType,
-                          crlf())
-					);
-
-        QFile uploadFile(_part.filePath());
-        uploadFile.open(QIODevice::ReadOnly);
-        while (!uploadFile.atEnd()) {
-			QByteArray readed = uploadFile.read(1024);
-            partData.append(readed);
-		}
-		uploadFile.close();
-	}
+    // Определение mime типа файла
+    QMimeDatabase mimeTypeDetector;
+    QString contentType = mimeTypeDetector.mimeTypeForFile(_part.filePath()).name();
+
+    partData.append(
+                QString("Content-Disposition: form-data; name=\"%1\"; filename=\"%2\"%4"
+                         "Content-Type: %3%4%4"
+                         )
+                .arg(_part.name(),
+                      _part.fileName(),
+                      contentType,
+                      crlf())
+                );
 
-    partData.append(crlf());
 	return partData;
 }
 
-QByteArray HttpMultiPart::makeEndData()
+QByteArray HttpMultiPart::makeEndData() const
 {
 	QByteArray partData;
 
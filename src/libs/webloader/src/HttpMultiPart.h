@@ -22,6 +22,9 @@
 #include <QtCore/QString>
 #include <QtCore/QList>
 
+class QIODevice;
+class QObject;
+
 class HttpPart
 {
 public:
@@ -63,13 +66,22 @@ public:
     void setBoundary(const QString& _boundary);
     void addPart(const HttpPart& _part);
 
+    /**
+     * @brief Создать устройство для чтения тела запроса
+     * @note Файлы не загружаются в память целиком, а читаются с диска по мере отправки.
+     *       Устройство поддерживает произвольный доступ, поэтому тело может быть отправлено повторно
+     */
+    QIODevice* createDevice(QObject* _parent = nullptr) const;
+
+    /**
+     * @brief Получить тело запроса целиком
+     */
 	QByteArray data();
 
 private:
-    QByteArray makeDataFromPart(const HttpPart& _part);
-    QByteArray makeDataFromTextPart(const HttpPart& _part);
-    QByteArray makeDataFromFilePart(const HttpPart& _part);
-	QByteArray makeEndData();
+    QByteArray makeDataFromTextPart(const HttpPart& _part) const;
+    QByteArray makeFilePartHeader(const HttpPart& _part) const;
+	QByteArray makeEndData() const;
 
 private:
 	QString boundary() const;
@@ -18,6 +18,27 @@
 #include "NetworkQueue.h"
 #include "WebLoader.h"
 
+#include <QThread>
+
+namespace {
+    /**
+     * @brief Количество рабочих потоков загрузки
+     * @note Сетевой обмен асинхронный, поэтому потоков нужно немного, а запросы одного потока
+     *       идут через общий менеджер загрузок и переиспользуют его соединения
+     */
+    const int kWorkerThreadsCount = 2;
+
+    /**
+     * @brief Минимальное количество одновременно выполняемых запросов
+     */
+    const int kMinimumLoadersCount = 4;
+
+    /**
+     * @brief Количество полос очереди, по одной на каждый приоритет
+     */
+    const int kLanesCount = static_cast<int>(NetworkRequestPriority::Bulk) + 1;
+}
+
 
 NetworkQueue* NetworkQueue::instance() {
     static NetworkQueue queue;
@@ -41,16 +62,45 @@ void NetworkQueue::enqueue(NetworkRequest* _request)
     Q_ASSERT_X(_request, Q_FUNC_INFO, "NetworkRequest shouldn't be a null pointer");
 
     //
-    // Добавим запрос в очередь
+    // Одинаковые GET-запросы выполняем один раз, отдавая результат всем ожидающим
     //
-    NetworkQueueEntry queueEntry;
-    queueEntry.request = _request;
-    m_queue.enqueue(queueEntry);
+    QString getKey;
+    if (_request->m_requestParameters.requestMethod() != NetworkRequestMethod::Post) {
+        getKey = _request->m_request.urlToLoad().toString(QUrl::FullyEncoded)
+                 + "\n" + _request->m_request.urlReferer().toString(QUrl::FullyEncoded)
+                 + "\n" + QString::number(reinterpret_cast<quintptr>(_request->cookieJar()));
+
+        const QSharedPointer<NetworkQueueEntry> sameEntry = m_pendingGets.value(getKey);
+        if (!sameEntry.isNull()) {
+            sameEntry->requests.append(_request);
+            m_pendingRequests.insert(_request, sameEntry);
+
+            //
+            // Если присоединившийся запрос важнее, переносим запись в его полосу,
+            // старая копия записи будет пропущена при извлечении
+            //
+            if (_request->priority() < sameEntry->priority) {
+                sameEntry->priority = _request->priority();
+                lane(sameEntry->priority).enqueue(sameEntry);
+                processQueue();
+            }
+            return;
+        }
+    }
 
     //
-    // Подпишемся на удаление объекта, чтобы пометить его, как не нуждающийся в загрузке
+    // Добавим запрос в очередь соответствующей полосы
     //
-    connect(_request, &NetworkRequest::destroyed, [this, _request] { stop(_request); });
+    QSharedPointer<NetworkQueueEntry> entry(new NetworkQueueEntry);
+    entry->priority = _request->priority();
+    entry->requests.append(_request);
+    entry->getKey = getKey;
+    lane(entry->priority).enqueue(entry);
+
+    m_pendingRequests.insert(_request, entry);
+    if (!getKey.isEmpty()) {
+        m_pendingGets.insert(getKey, entry);
+    }
 
     //
     // Попробуем отправить запрос на загрузку прямо сейчас
@@ -58,20 +108,25 @@ void NetworkQueue::enqueue(NetworkRequest* _request)
     processQueue();
 }
 
-void NetworkQueue::stop(NetworkRequest* _request)
+bool NetworkQueue::stop(NetworkRequest* _request)
 {
     Q_ASSERT_X(_request, Q_FUNC_INFO, "NetworkRequest shouldn't be a null pointer");
 
+    const QSharedPointer<NetworkQueueEntry> entry = m_pendingRequests.take(_request);
+    if (entry.isNull()) {
+        return false;
+    }
+
     //
-    // Просто помечаем запрос, как не нуждающийся в загрузке
+    // Отсоединяем запрос от записи, а если её больше никто не ждёт, то помечаем
+    // как не нуждающуюся в загрузке
     //
-    for (NetworkQueueEntry& entry : m_queue) {
-        if (entry.request == _request) {
-            entry.isNeedToLoad = false;
-            m_requests.removeAll(_request->m_request);
-            m_requestParameters.removeAll(_request->m_requestParameters);
-        }
+    entry->requests.removeAll(QPointer<NetworkRequest>(_request));
+    if (entry->requests.isEmpty()) {
+        forgetEntry(entry);
     }
+
+    return true;
 }
 
 void NetworkQueue::stopAll()
@@ -79,81 +134,178 @@ void NetworkQueue::stopAll()
     //
     // Очистим очередь ожидающих запросов
     //
-    m_queue.clear();
+    for (Lane& queueLane : m_lanes) {
+        for (const QSharedPointer<NetworkQueueEntry>& entry : queueLane) {
+            entry->isNeedToLoad = false;
+        }
+        queueLane.clear();
+    }
+    m_pendingRequests.clear();
+    m_pendingGets.clear();
 
     //
     // Остановим уже обрабатывающиеся запросы
     //
-    for (WebLoader* loader : m_busyLoaders) {
+    for (WebLoader* loader : m_busyLoaders.keys()) {
         loader->stop();
     }
 }
 
-NetworkQueue::NetworkQueue()
+void NetworkQueue::unregisterRequest(NetworkRequest* _request)
 {
-    //
-    // В нужном количестве создадим WebLoader'ы
-    //
-    for (int i = 0; i != std::max(QThread::idealThreadCount(), 4); ++i) {
-        m_freeLoaders.append(new WebLoader(this));
-    }
+    Q_ASSERT_X(_request, Q_FUNC_INFO, "NetworkRequest shouldn't be a null pointer");
+
+    stop(_request);
+    m_requests.removeAll(_request->m_request);
+    m_requestParameters.removeAll(_request->m_requestParameters);
 }
 
-void NetworkQueue::processQueue()
+NetworkQueue::NetworkQueue() :
+    m_lanes(kLanesCount)
 {
     //
-    // Если нет свободных загрузчиков или запросов на загрузку, ничего и не делаем
+    // Запустим рабочие потоки
     //
-    if (m_freeLoaders.isEmpty()
-        || m_queue.isEmpty()) {
-        return;
+    for (int i = 0; i != kWorkerThreadsCount; ++i) {
+        QThread* thread = new QThread(this);
+        thread->start();
+        m_workerThreads.append(thread);
     }
 
     //
-    // Извлечём запрос, который необходимо загрузить
+    // В нужном количестве создадим WebLoader'ы, распределив их по рабочим потокам
     //
-    NetworkQueueEntry requestEntry;
-    while (!m_queue.isEmpty()) {
-        requestEntry = m_queue.dequeue();
-        if (requestEntry.isNeedToLoad) {
-            break;
-        }
+    for (int i = 0; i != std::max(QThread::idealThreadCount(), kMinimumLoadersCount); ++i) {
+        WebLoader* loader = new WebLoader;
+        QThread* thread = m_workerThreads.at(i % m_workerThreads.size());
+        loader->moveToThread(thread);
+        connect(thread, &QThread::finished, loader, &WebLoader::deleteLater);
+        m_freeLoaders.append(loader);
     }
+}
 
+NetworkQueue::~NetworkQueue()
+{
     //
-    // Если не нашли ни одного запроса, который нужно загрузить, прерываемся
+    // Загрузчики удаляются в своих потоках при их завершении
     //
-    if (!requestEntry.isNeedToLoad) {
-        return;
+    for (QThread* thread : m_workerThreads) {
+        thread->quit();
+        thread->wait();
     }
+}
 
+NetworkQueue::Lane& NetworkQueue::lane(NetworkRequestPriority _priority)
+{
+    return m_lanes[static_cast<int>(_priority)];
+}
+
+QSharedPointer<NetworkQueue::NetworkQueueEntry> NetworkQueue::takeNextEntry()
+{
     //
-    // Перемещаем загрузчик в список занятых
-    //
-    WebLoader* loader = m_freeLoaders.takeLast();
-    m_busyLoaders.append(loader);
-    //
-    // ... конфигурируем его
-    //
-    loader->setWebRequest(requestEntry.request->m_request);
-    loader->setWebRequestParameters(requestEntry.request->m_requestParameters);
-    //
-    // ... соединяем с запросом
+    // Объёмным загрузкам оставляем не все загрузчики, чтобы один всегда был
+    // доступен для интерактивных запросов
     //
-    connect(loader, static_cast<void (WebLoader::*)(QByteArray, QUrl)>(&WebLoader::downloadComplete),
-            requestEntry.request, &NetworkRequest::downloadComplete);
-    connect(loader, static_cast<void (WebLoader::*)(int, QUrl)>(&WebLoader::uploadProgress),
-            requestEntry.request, &NetworkRequest::uploadProgress);
-    connect(loader, static_cast<void (WebLoader::*)(int, QUrl)>(&WebLoader::downloadProgress),
-            requestEntry.request, &NetworkRequest::downloadProgress);
-    connect(loader, &WebLoader::error, requestEntry.request, &NetworkRequest::error);
-    connect(loader, &WebLoader::errorDetails, requestEntry.request, &NetworkRequest::errorDetails);
-    connect(loader, &WebLoader::finished, requestEntry.request, &NetworkRequest::finished);
-    connect(loader, &WebLoader::finished, this, &NetworkQueue::reinitFinishedLoader);
+    const int loadersCount = m_freeLoaders.size() + m_busyLoaders.size();
+    const int busyBulkLoadersCount = m_busyLoaders.values().count(NetworkRequestPriority::Bulk);
+    const bool canLoadBulk = busyBulkLoadersCount < loadersCount - 1;
+
+    for (int laneIndex = 0; laneIndex != m_lanes.size(); ++laneIndex) {
+        const NetworkRequestPriority priority = static_cast<NetworkRequestPriority>(laneIndex);
+        if (priority == NetworkRequestPriority::Bulk
+            && !canLoadBulk) {
+            continue;
+        }
+
+        Lane& queue = m_lanes[laneIndex];
+        while (!queue.isEmpty()) {
+            const QSharedPointer<NetworkQueueEntry> entry = queue.dequeue();
+            if (entry->isNeedToLoad
+                && entry->priority == priority) {
+                return entry;
+            }
+        }
+    }
+
+    return QSharedPointer<NetworkQueueEntry>();
+}
+
+void NetworkQueue::forgetEntry(const QSharedPointer<NetworkQueueEntry>& _entry)
+{
     //
-    // ... и запускаем выполнение
+    // Сама запись остаётся в очереди полосы и будет пропущена при извлечении
     //
-    loader->loadAsync();
+    _entry->isNeedToLoad = false;
+
+    for (const QPointer<NetworkRequest>& request : _entry->requests) {
+        if (m_pendingRequests.value(request) == _entry) {
+            m_pendingRequests.remove(request);
+        }
+    }
+    if (!_entry->getKey.isEmpty()
+        && m_pendingGets.value(_entry->getKey) == _entry) {
+        m_pendingGets.remove(_entry->getKey);
+    }
+}
+
+void NetworkQueue::processQueue()
+{
+    while (!m_freeLoaders.isEmpty()) {
+        //
+        // Извлечём запрос, который необходимо загрузить
+        //
+        const QSharedPointer<NetworkQueueEntry> entry = takeNextEntry();
+        if (entry.isNull()) {
+            return;
+        }
+
+        //
+        // Исключим запрос из ожидающих
+        //
+        forgetEntry(entry);
+
+        //
+        // Перемещаем загрузчик в список занятых
+        //
+        WebLoader* loader = m_freeLoaders.takeLast();
+        m_busyLoaders.insert(loader, entry->priority);
+        //
+        // ... конфигурируем его по первому из ожидающих запросов
+        //
+        NetworkRequest* mainRequest = nullptr;
+        for (const QPointer<NetworkRequest>& request : entry->requests) {
+            if (!request.isNull()) {
+                mainRequest = request;
+                break;
+            }
+        }
+        Q_ASSERT_X(mainRequest, Q_FUNC_INFO, "Queued entry should have at least one request");
+        loader->setWebRequest(mainRequest->m_request);
+        loader->setWebRequestParameters(mainRequest->m_requestParameters);
+        //
+        // ... соединяем со всеми ожидающими запросами
+        //
+        for (const QPointer<NetworkRequest>& request : entry->requests) {
+            if (request.isNull()) {
+                continue;
+            }
+
+            connect(loader, static_cast<void (WebLoader::*)(QByteArray, QUrl)>(&WebLoader::downloadComplete),
+                    request, &NetworkRequest::downloadComplete);
+            connect(loader, static_cast<void (WebLoader::*)(int, QUrl)>(&WebLoader::uploadProgress),
+                    request, &NetworkRequest::uploadProgress);
+            connect(loader, static_cast<void (WebLoader::*)(int, QUrl)>(&WebLoader::downloadProgress),
+                    request, &NetworkRequest::downloadProgress);
+            connect(loader, &WebLoader::error, request, &NetworkRequest::error);
+            connect(loader, &WebLoader::errorDetails, request, &NetworkRequest::errorDetails);
+            connect(loader, &WebLoader::finished, request, &NetworkRequest::finished);
+        }
+        connect(loader, &WebLoader::finished, this, &NetworkQueue::reinitFinishedLoader);
+        //
+        // ... и запускаем выполнение
+        //
+        loader->loadAsync();
+    }
 }
 
 void NetworkQueue::reinitFinishedLoader()
@@ -171,10 +323,7 @@ void NetworkQueue::reinitFinishedLoader()
     //
     // Если загрузчик был в списке занятых, исключаем его оттуда и переводим в список свободных
     //
-    const int loaderIndex = m_busyLoaders.indexOf(loader);
-    const int invalidIndex = -1;
-    if (loaderIndex != invalidIndex) {
-        m_busyLoaders.takeAt(loaderIndex);
+    if (m_busyLoaders.remove(loader) > 0) {
         m_freeLoaders.append(loader);
     }
 
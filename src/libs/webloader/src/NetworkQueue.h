@@ -18,13 +18,19 @@
 #ifndef NETWORKQUEUE_H
 #define NETWORKQUEUE_H
 
+#include "NetworkTypes.h"
 #include "WebRequest.h"
 #include "WebRequestParameters.h"
 
+#include <QHash>
 #include <QObject>
+#include <QPointer>
 #include <QQueue>
+#include <QSharedPointer>
+#include <QVector>
 
 class NetworkRequest;
+class QThread;
 class WebLoader;
 
 
@@ -61,14 +67,20 @@ public:
     /**
      * @brief Запросить остановку запроса
      * @note Метод не гарантирует остановку запроса, если он уже выполняется, для этого стоит использовать stopAll
+     * @return Ожидал ли запрос выполнения
      */
-    void stop(NetworkRequest* _request);
+    bool stop(NetworkRequest* _request);
 
     /**
      * @brief Метод, останавливающий все текущие запросы и очищающий очередь
      */
     void stopAll();
 
+    /**
+     * @brief Удалить зарегистрированные данные запроса
+     */
+    void unregisterRequest(NetworkRequest* _request);
+
 private:
     /**
      * @brief Приватные конструкторы и оператор присваивания
@@ -77,12 +89,61 @@ private:
     NetworkQueue();
     NetworkQueue(const NetworkQueue&);
     NetworkQueue& operator=(const NetworkQueue&);
+    ~NetworkQueue();
 
     /**
      * @brief Выполнить шаг обработки очереди
      */
     void processQueue();
 
+    /**
+     * @brief Объект очереди на загрузку
+     */
+    struct NetworkQueueEntry {
+        /**
+         * @brief Необходимо ли загрузить
+         */
+        bool isNeedToLoad = true;
+
+        /**
+         * @brief Полоса, в которой ожидает запрос
+         */
+        NetworkRequestPriority priority = NetworkRequestPriority::Interactive;
+
+        /**
+         * @brief Объекты запросов, ожидающих результата загрузки
+         * @note Первый из них используется для настройки загрузчика, остальные - это
+         *       присоединившиеся к нему одинаковые GET-запросы
+         */
+        QList<QPointer<NetworkRequest>> requests;
+
+        /**
+         * @brief Ключ GET-запроса, по которому к нему присоединяются одинаковые запросы
+         */
+        QString getKey;
+    };
+
+    /**
+     * @brief Полоса очереди, ожидающие запросы
+     * @note Отменённые и перемещённые в другие полосы записи удаляются при извлечении
+     */
+    using Lane = QQueue<QSharedPointer<NetworkQueueEntry>>;
+
+    /**
+     * @brief Получить полосу очереди по приоритету
+     */
+    Lane& lane(NetworkRequestPriority _priority);
+
+    /**
+     * @brief Извлечь следующий запрос на загрузку с учётом приоритетов
+     */
+    QSharedPointer<NetworkQueueEntry> takeNextEntry();
+
+    /**
+     * @brief Исключить запись из ожидающих загрузки
+     */
+    void forgetEntry(const QSharedPointer<NetworkQueueEntry>& _entry);
+
     /**
      * @brief Перенастроить загрузчик завершивший свою работу
      */
@@ -99,35 +160,35 @@ private:
      */
     QList<WebRequestParameters> m_requestParameters;
 
+    /**
+     * @brief Рабочие потоки, в которых живут загрузчики
+     */
+    QVector<QThread*> m_workerThreads;
+
     /**
      * @brief Свободные загрузчики
      */
     QVector<WebLoader*> m_freeLoaders;
 
     /**
-     * @brief Занятые загрузчики
+     * @brief Занятые загрузчики и приоритеты выполняемых ими запросов
      */
-    QVector<WebLoader*> m_busyLoaders;
+    QHash<WebLoader*, NetworkRequestPriority> m_busyLoaders;
 
     /**
-     * @brief Объект очереди на загрузку
+     * @brief Полосы очереди, в порядке убывания приоритета
      */
-    struct NetworkQueueEntry {
-        /**
-         * @brief Необходимо ли загрузить
-         */
-        bool isNeedToLoad = true;
+    QVector<Lane> m_lanes;
 
-        /**
-         * @brief Объект запроса
-         */
-        NetworkRequest* request = nullptr;
-    };
+    /**
+     * @brief Ожидающие записи по объектам запросов
+     */
+    QHash<NetworkRequest*, QSharedPointer<NetworkQueueEntry>> m_pendingRequests;
 
     /**
-     * @brief Собственно очередь запросов
+     * @brief Ожидающие GET-запросы по их ключу
      */
-    QQueue<NetworkQueueEntry> m_queue;
+    QHash<QString, QSharedPointer<NetworkQueueEntry>> m_pendingGets;
 };
 
 #endif // NETWORKQUEUE_H
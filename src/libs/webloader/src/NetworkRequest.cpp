@@ -39,9 +39,14 @@ NetworkRequest::NetworkRequest(QObject* _parent) :
     });
 }
 
+NetworkRequest::~NetworkRequest()
+{
+    NetworkQueue::instance()->unregisterRequest(this);
+}
+
 void NetworkRequest::setCookieJar(QNetworkCookieJar* _cookieJar)
 {
-    stop();
+    NetworkQueue::instance()->stop(this);
     m_requestParameters.setCookieJar(_cookieJar);
 }
 
@@ -52,7 +57,7 @@ QNetworkCookieJar* NetworkRequest::cookieJar() const
 
 void NetworkRequest::setRequestMethod(NetworkRequestMethod _method)
 {
-    stop();
+    NetworkQueue::instance()->stop(this);
     m_requestParameters.setRequestMethod(_method);
 }
 
@@ -63,7 +68,7 @@ NetworkRequestMethod NetworkRequest::requestMethod() const
 
 void NetworkRequest::setLoadingTimeout(int _loadingTimeout)
 {
-    stop();
+    NetworkQueue::instance()->stop(this);
     m_requestParameters.setLoadingTimeout(_loadingTimeout);
 }
 
@@ -72,33 +77,43 @@ int NetworkRequest::loadingTimeout() const
     return m_requestParameters.loadingTimeout();
 }
 
+void NetworkRequest::setPriority(NetworkRequestPriority _priority)
+{
+    m_priority = _priority;
+}
+
+NetworkRequestPriority NetworkRequest::priority() const
+{
+    return m_priority;
+}
+
 void NetworkRequest::clearRequestAttributes()
 {
-    stop();
+    NetworkQueue::instance()->stop(this);
     m_request.clearAttributes();
 }
 
 void NetworkRequest::addRequestAttribute(const QString& _name, const QVariant& _value)
 {
-    stop();
+    NetworkQueue::instance()->stop(this);
     m_request.addAttribute(_name, _value);
 }
 
 void NetworkRequest::addRequestAttributeFile(const QString& _name, const QString& _filePath)
 {
-    stop();
+    NetworkQueue::instance()->stop(this);
     m_request.addAttributeFile(_name, _filePath);
 }
 
 void NetworkRequest::setRawRequestData(const QByteArray &_data)
 {
-    stop();
+    NetworkQueue::instance()->stop(this);
     m_request.setRawData(_data);
 }
 
 void NetworkRequest::setRawRequestData(const QByteArray &_data, const QString &_mime)
 {
-    stop();
+    NetworkQueue::instance()->stop(this);
     m_request.setRawData(_data, _mime);
 }
 
@@ -117,6 +132,7 @@ void NetworkRequest::loadAsync(const QUrl& _urlToLoad, const QUrl& _referer)
     //
     // Настраиваем параметры и кладем в очередь
     //
+    m_downloadedData.clear();
     m_request.setUrlToLoad(_urlToLoad);
     m_request.setUrlReferer(_referer);
     NetworkQueue::instance()->enqueue(this);
@@ -140,9 +156,23 @@ QByteArray NetworkRequest::loadSync(const QUrl& _urlToLoad, const QUrl& _referer
     return m_downloadedData;
 }
 
+QByteArray NetworkRequest::downloadedData() const
+{
+    return m_downloadedData;
+}
+
 void NetworkRequest::stop()
 {
-    NetworkQueue::instance()->stop(this);
+    //
+    // Остановленный пользователем запрос завершаем с ошибкой, чтобы ожидающие его продолжения
+    // не остались висеть. Сеттеры параметров снимают запрос из очереди молча, т.к. за ними
+    // обычно следует новая загрузка
+    //
+    if (NetworkQueue::instance()->stop(this)) {
+        m_downloadedData.clear();
+        emit error(tr("Request was stopped"), m_request.urlToLoad());
+        emit finished();
+    }
 }
 
 void NetworkRequest::done()
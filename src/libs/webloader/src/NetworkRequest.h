@@ -45,6 +45,7 @@ public:
 
 public:
     explicit NetworkRequest(QObject* _parent = nullptr);
+    ~NetworkRequest();
 
     /**
      * @brief Установка cookie для загрузчика
@@ -76,6 +77,17 @@ public:
      */
     int loadingTimeout() const;
 
+    /**
+     * @brief Установка приоритета запроса в очереди загрузки
+     * @note Применяется при следующей постановке запроса в очередь
+     */
+    void setPriority(NetworkRequestPriority _priority);
+
+    /**
+     * @brief Получение приоритета запроса
+     */
+    NetworkRequestPriority priority() const;
+
     /**
      * @brief Очистить все старые атрибуты запроса
      */
@@ -109,14 +121,21 @@ public:
 
     /**
      * @brief Синхронная загрузка запроса
+     * @note Выполняется во вложенном цикле событий, в новом коде стоит использовать асинхронную загрузку
      */
     /** @{ */
     QByteArray loadSync(const QString& _urlToLoad, const QString& _referer = QString());
     QByteArray loadSync(const QUrl& _urlToLoad, const QUrl& _referer = QUrl());
     /** @} */
 
+    /**
+     * @brief Данные, загруженные последним запросом
+     */
+    QByteArray downloadedData() const;
+
     /**
      * @brief Остановка выполнения запроса, связанного с текущим объектом
+     * @note Если запрос ожидал выполнения, то испускаются сигналы error и finished
      */
     void stop();
 
@@ -165,6 +184,11 @@ private:
      */
     WebRequestParameters& m_requestParameters;
 
+    /**
+     * @brief Приоритет запроса в очереди
+     */
+    NetworkRequestPriority m_priority = NetworkRequestPriority::Interactive;
+
     /**
      * @brief Загруженные данные в случае, если используется синхронная загрузка
      */
@@ -20,7 +20,9 @@
 #include "NetworkRequest.h"
 
 #include <QByteArray>
+#include <QSharedPointer>
 #include <QUrl>
+#include <QVector>
 
 
 class NetworkRequestLoader {
@@ -89,8 +91,58 @@ public:
 		}
 	}
 
+	/**
+	 * @brief Загрузить ссылку настроенным запросом и передать результат в продолжение
+	 * @note Продолжение вызывается и при ошибке (с пустыми данными), но только пока жив объект-контекст.
+	 *		 Запрос удаляется после завершения загрузки
+	 */
+	template<typename Func>
+	static void loadAsync(NetworkRequest* _request, const QUrl& _urlToLoad, const QObject* _context, Func _func)
+	{
+		QObject::connect(_request, &NetworkRequest::finished, _context, [_request, _func] {
+			_func(_request->downloadedData());
+		});
+		QObject::connect(_request, &NetworkRequest::finished, _request, &NetworkRequest::deleteLater);
+		_request->loadAsync(_urlToLoad);
+	}
+
+	/**
+	 * @brief Загрузить ссылки параллельно и передать все результаты в продолжение
+	 * @note Результаты передаются в порядке ссылок, продолжение вызывается один раз,
+	 *		 когда завершатся все запросы
+	 */
+	template<typename Func>
+	static void loadAllAsync(const QVector<NetworkRequest*>& _requests, const QVector<QUrl>& _urlsToLoad,
+		const QObject* _context, Func _func)
+	{
+		Q_ASSERT_X(_requests.size() == _urlsToLoad.size(), Q_FUNC_INFO, "Each url should have its own request");
+
+		struct State {
+			QVector<QByteArray> results;
+			int pendingCount = 0;
+		};
+		QSharedPointer<State> state(new State);
+		state->results.resize(_requests.size());
+		state->pendingCount = _requests.size();
+
+		if (_requests.isEmpty()) {
+			_func(state->results);
+			return;
+		}
+
+		for (int index = 0; index != _requests.size(); ++index) {
+			loadAsync(_requests.at(index), _urlsToLoad.at(index), _context, [state, index, _func] (const QByteArray& _data) {
+				state->results[index] = _data;
+				if (--state->pendingCount == 0) {
+					_func(state->results);
+				}
+			});
+		}
+	}
+
 	/**
 	 * @brief Загрузить ссылку синхронно
+	 * @note Выполняется во вложенном цикле событий, в новом коде стоит использовать асинхронную загрузку
 	 */
 	static QByteArray loadSync(const QUrl& _urlToLoad);
 
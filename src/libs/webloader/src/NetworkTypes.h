@@ -10,4 +10,18 @@ enum class NetworkRequestMethod {
     Post
 };
 
+/**
+ * @enum Приоритет запроса в очереди загрузки
+ */
+enum class NetworkRequestPriority {
+    //
+    // Запросы, результата которых ждёт пользователь (курсоры соавторов, проверка обновлений и т.п.)
+    //
+    Interactive,
+    //
+    // Объёмные загрузки и выгрузки (резервные копии, словари, обновления)
+    //
+    Bulk
+};
+
 #endif // NETWORKTYPES_H
@@ -17,12 +17,13 @@
 
 #include "WebLoader.h"
 
-#include <QEventLoop>
+#include <QNetworkCookie>
 #include <QNetworkCookieJar>
 #include <QNetworkAccessManager>
 #include <QNetworkRequest>
 #include <QNetworkReply>
-#include <QPointer>
+#include <QThread>
+#include <QThreadStorage>
 #include <QTimer>
 
 namespace {
@@ -33,6 +34,24 @@ namespace {
      */
     const int kPossibleRecievedMaxFileSize = 120000;
 
+    /**
+     * @brief Количество повторов запроса после обрыва соединения
+     */
+    const int kMaxRetriesCount = 2;
+
+    /**
+     * @brief Менеджер загрузок текущего потока
+     * @note Один долгоживущий менеджер на поток держит открытыми соединения с серверами,
+     *       так что последующие запросы не тратят время на установку соединения и TLS-рукопожатие
+     */
+    static QNetworkAccessManager* networkManager() {
+        static QThreadStorage<QNetworkAccessManager*> s_networkManagers;
+        if (!s_networkManagers.hasLocalData()) {
+            s_networkManagers.setLocalData(new QNetworkAccessManager);
+        }
+        return s_networkManagers.localData();
+    }
+
     /**
      * @brief Преобразовать ошибку в читаемый вид
      */
@@ -83,15 +102,24 @@ namespace {
 
 
 WebLoader::WebLoader(QObject* _parent) :
-    QThread(_parent)
+    QObject(_parent),
+    m_timeoutTimer(new QTimer(this))
 {
+    m_timeoutTimer->setSingleShot(true);
+    connect(m_timeoutTimer, &QTimer::timeout, this, [this] {
+        //
+        // Прерываем зависшую загрузку, завершится она в обработчике окончания загрузки
+        //
+        if (!m_reply.isNull()) {
+            m_reply->abort();
+        }
+    });
 }
 
 WebLoader::~WebLoader()
 {
-    stop();
-    if (m_networkManager != nullptr)
-        m_networkManager->deleteLater();
+    m_isLoading = false;
+    abortLoading();
 }
 
 void WebLoader::setWebRequest(const WebRequest& _request)
@@ -111,17 +139,6 @@ void WebLoader::loadAsync()
 
 void WebLoader::loadAsync(const QUrl& _urlToLoad, const QUrl& _referer)
 {
-    //
-    // Останавливаем, если выполняется в данный момент
-    //
-    stop();
-
-    //
-    // Сбрасываем переменные времени выполненеия
-    //
-    m_isNeedStop = false;
-    m_downloadedData.clear();
-
     //
     // Настраиваем запрос
     //
@@ -129,119 +146,205 @@ void WebLoader::loadAsync(const QUrl& _urlToLoad, const QUrl& _referer)
     m_request.setUrlReferer(_referer);
 
     //
-    // Запускаем загрузку
+    // Запускаем загрузку в потоке загрузчика, сама загрузка выполняется асинхронно
     //
-    start();
+    QMetaObject::invokeMethod(this, "startLoading", Qt::QueuedConnection);
 }
 
-void WebLoader::run()
+void WebLoader::stop()
 {
-    initNetworkManager();
+    if (thread() == QThread::currentThread()) {
+        abortLoading();
+    } else {
+        QMetaObject::invokeMethod(this, "abortLoading", Qt::QueuedConnection);
+    }
+}
 
+void WebLoader::startLoading()
+{
+    //
+    // Останавливаем, если выполняется в данный момент
+    //
+    abortLoading();
+
+    //
+    // Сбрасываем переменные времени выполненеия
+    //
+    m_isLoading = true;
+    ++m_loadingId;
+    m_downloadedData.clear();
     m_requestSourceUrl = m_request.urlToLoad();
+    m_retriesLeft = kMaxRetriesCount;
+    if (m_parameters.cookieJar() == nullptr) {
+        delete m_ownCookieJar;
+        m_ownCookieJar = new QNetworkCookieJar(this);
+    }
 
-    do
-    {
-        if (m_isNeedStop) {
-            return;
-        }
+    //! Начало загрузки страницы m_request.url()
+    emit uploadProgress(0, m_requestSourceUrl);
+    emit downloadProgress(0, m_requestSourceUrl);
 
-        //! Начало загрузки страницы m_request.url()
-        emit uploadProgress(0, m_requestSourceUrl);
-        emit downloadProgress(0, m_requestSourceUrl);
+    sendRequest();
+}
 
-        QPointer<QNetworkReply> reply = nullptr;
+void WebLoader::abortLoading()
+{
+    ++m_loadingId;
+    m_timeoutTimer->stop();
+
+    if (!m_reply.isNull()) {
+        QNetworkReply* reply = m_reply.data();
+        m_reply.clear();
+        reply->disconnect(this);
+        reply->abort();
+        reply->deleteLater();
+    }
 
-        switch (m_parameters.requestMethod()) {
+    //
+    // Прерванная загрузка всё равно считается завершённой, чтобы очередь освободила загрузчик
+    //
+    if (m_isLoading) {
+        finishLoading(false);
+    }
+}
 
-            default:
-            case NetworkRequestMethod::Get: {
-                const QNetworkRequest request = this->m_request.networkRequest();
-                reply = m_networkManager->get(request);
-                break;
-            }
+void WebLoader::sendRequest()
+{
+    QNetworkCookieJar* jar = cookieJar();
+    const QUrl url = m_request.urlToLoad();
+    if (jar->thread() == thread()) {
+        sendRequest(jar->cookiesForUrl(url));
+        return;
+    }
 
-            case NetworkRequestMethod::Post: {
-                const QNetworkRequest networkRequest = m_request.networkRequest(true);
-                const QByteArray data = m_request.multiPartData();
-                reply = m_networkManager->post(networkRequest, data);
-                break;
+    //
+    // Хранилище куки клиента живёт в другом потоке, поэтому читаем куки в нём, а запрос отправляем
+    // уже в своём потоке, если загрузка к тому времени не была прервана
+    //
+    const int loadingId = m_loadingId;
+    QPointer<WebLoader> loader(this);
+    QTimer::singleShot(0, jar, [jar, url, loader, loadingId] {
+        const QList<QNetworkCookie> cookies = jar->cookiesForUrl(url);
+        if (loader.isNull()) {
+            return;
+        }
+        QTimer::singleShot(0, loader.data(), [loader, cookies, loadingId] {
+            if (loader->m_isLoading
+                && loader->m_loadingId == loadingId) {
+                loader->sendRequest(cookies);
             }
+        });
+    });
+}
 
-        } // switch
+void WebLoader::sendRequest(const QList<QNetworkCookie>& _cookies)
+{
+    const bool isPost = m_parameters.requestMethod() == NetworkRequestMethod::Post;
+    QNetworkRequest request = m_request.networkRequest(isPost);
 
-        connect(reply.data(), &QNetworkReply::uploadProgress,
-                this, static_cast<void (WebLoader::*)(qint64, qint64)>(&WebLoader::uploadProgress));
-        connect(reply.data(), &QNetworkReply::downloadProgress,
-                this, static_cast<void (WebLoader::*)(qint64, qint64)>(&WebLoader::downloadProgress));
-        connect(reply.data(), static_cast<void (QNetworkReply::*)(QNetworkReply::NetworkError)>(&QNetworkReply::error),
-                this, &WebLoader::downloadError);
-        connect(reply.data(), &QNetworkReply::sslErrors, this, &WebLoader::downloadSslErrors);
-        connect(reply.data(), &QNetworkReply::sslErrors,
-                reply.data(), static_cast<void (QNetworkReply::*)()>(&QNetworkReply::ignoreSslErrors));
+    //
+    // Куки подставляем сами, т.к. менеджер загрузок общий для всех запросов потока
+    //
+    request.setAttribute(QNetworkRequest::CookieLoadControlAttribute, QNetworkRequest::Manual);
+    request.setAttribute(QNetworkRequest::CookieSaveControlAttribute, QNetworkRequest::Manual);
+    if (!_cookies.isEmpty()) {
+        request.setHeader(QNetworkRequest::CookieHeader, QVariant::fromValue(_cookies));
+    }
+#if QT_VERSION >= 0x050800
+    //
+    // Несколько запросов к одному серверу мультиплексируются в одном соединении
+    //
+    request.setAttribute(QNetworkRequest::HTTP2AllowedAttribute, true);
+#endif
 
+    QNetworkReply* reply = nullptr;
+    if (isPost) {
         //
-        // Таймер для прерывания работы
+        // Тело запроса читается с устройства по мере отправки, а при повторной отправке
+        // (например после обрыва соединения) менеджер загрузок перематывает его в начало
         //
-        QTimer timeoutTimer;
-        connect(reply.data(), &QNetworkReply::uploadProgress, &timeoutTimer, static_cast<void (QTimer::*)()>(&QTimer::start));
-        connect(reply.data(), &QNetworkReply::downloadProgress, &timeoutTimer, static_cast<void (QTimer::*)()>(&QTimer::start));
-        connect(&timeoutTimer, &QTimer::timeout, this, &WebLoader::quit);
-        connect(&timeoutTimer, &QTimer::timeout, reply.data(), &QNetworkReply::abort);
-        timeoutTimer.setSingleShot(true);
-        timeoutTimer.start(m_parameters.loadingTimeout());
+        QIODevice* multiPartDevice = m_request.createMultiPartDevice(this);
+        request.setHeader(QNetworkRequest::ContentLengthHeader, multiPartDevice->size());
+        reply = ::networkManager()->post(request, multiPartDevice);
+        multiPartDevice->setParent(reply);
+    } else {
+        reply = ::networkManager()->get(request);
+    }
+    m_reply = reply;
+
+    connect(reply, &QNetworkReply::uploadProgress,
+            this, static_cast<void (WebLoader::*)(qint64, qint64)>(&WebLoader::uploadProgress));
+    connect(reply, &QNetworkReply::downloadProgress,
+            this, static_cast<void (WebLoader::*)(qint64, qint64)>(&WebLoader::downloadProgress));
+    connect(reply, static_cast<void (QNetworkReply::*)(QNetworkReply::NetworkError)>(&QNetworkReply::error),
+            this, &WebLoader::downloadError);
+    connect(reply, &QNetworkReply::sslErrors, this, &WebLoader::downloadSslErrors);
+    connect(reply, &QNetworkReply::sslErrors,
+            reply, static_cast<void (QNetworkReply::*)()>(&QNetworkReply::ignoreSslErrors));
+    connect(reply, &QNetworkReply::finished, this, [this, reply] { downloadComplete(reply); });
 
-        //
-        // Входим в поток обработки событий, ожидая завершения отработки networkManager'а
-        //
-        exec();
+    //
+    // Таймер для прерывания работы перезапускается при любом движении данных
+    //
+    connect(reply, &QNetworkReply::uploadProgress, m_timeoutTimer, static_cast<void (QTimer::*)()>(&QTimer::start));
+    connect(reply, &QNetworkReply::downloadProgress, m_timeoutTimer, static_cast<void (QTimer::*)()>(&QTimer::start));
+    m_timeoutTimer->start(m_parameters.loadingTimeout());
+}
 
-        if (m_isNeedStop) {
-            return;
-        }
+void WebLoader::finishLoading(bool _isDownloaded)
+{
+    m_isLoading = false;
+    if (_isDownloaded) {
+        emit downloadComplete(m_downloadedData, m_requestSourceUrl);
+    }
+    emit finished();
+}
 
-        //
-        // Если ответ ещё не удалён
-        //
-        if (!reply.isNull()) {
-            //
-            // ... если ответ получен, останавливаем таймер
-            //
-            if (reply->isFinished()) {
-                timeoutTimer.stop();
-            }
-            //
-            // ... а если загрузка прервалась по таймеру, освобождаем ресурсы и закрываем соединение
-            //
-            else {
-                m_isNeedRedirect = false;
-                reply->abort();
-            }
-        }
+void WebLoader::storeCookies(const QList<QNetworkCookie>& _cookies, const QUrl& _url)
+{
+    if (_cookies.isEmpty()) {
+        return;
+    }
 
-    } while (m_isNeedRedirect);
+    QNetworkCookieJar* jar = cookieJar();
+    if (jar->thread() == thread()) {
+        jar->setCookiesFromUrl(_cookies, _url);
+        return;
+    }
 
-    emit downloadComplete(m_downloadedData, m_requestSourceUrl);
+    //
+    // Запрос, отправленный после этого в тот же поток за куками, увидит уже сохранённые
+    //
+    QTimer::singleShot(0, jar, [jar, _cookies, _url] {
+        jar->setCookiesFromUrl(_cookies, _url);
+    });
 }
 
-void WebLoader::stop()
+bool WebLoader::canRetry(QNetworkReply::NetworkError _networkError) const
 {
-    m_isNeedStop = true;
+    if (m_retriesLeft <= 0) {
+        return false;
+    }
 
     //
-    // Сперва пробуем остановить аккуратно
+    // POST-запрос мог дойти до сервера до обрыва соединения, а повторять его можно
+    // только если он идемпотентен, что загрузчику неизвестно, поэтому повторяем лишь GET
     //
-    if (isRunning()) {
-        quit();
-        wait(1000);
+    if (m_parameters.requestMethod() == NetworkRequestMethod::Post) {
+        return false;
     }
 
-    //
-    // Если не удалось, прерываем жёстко
-    //
-    if (isRunning()) {
-        terminate();
-        wait();
+    switch (_networkError) {
+        case QNetworkReply::RemoteHostClosedError:
+        case QNetworkReply::TemporaryNetworkFailureError:
+        case QNetworkReply::NetworkSessionFailedError:
+        case QNetworkReply::ProxyConnectionClosedError: {
+            return true;
+        }
+
+        default: {
+            return false;
+        }
     }
 }
 
@@ -267,7 +370,27 @@ void WebLoader::downloadProgress(qint64 _recievedBytes, qint64 _totalBytes)
 
 void WebLoader::downloadComplete(QNetworkReply* _reply)
 {
+    //
+    // Ответ на прерванный запрос уже никому не нужен
+    //
+    if (_reply != m_reply) {
+        return;
+    }
+
     //! Завершена загрузка страницы [m_request.url()]
+    m_timeoutTimer->stop();
+    m_reply.clear();
+    _reply->deleteLater();
+    storeCookies(_reply->header(QNetworkRequest::SetCookieHeader).value<QList<QNetworkCookie>>(), _reply->url());
+
+    //
+    // При обрыве соединения отправляем запрос заново
+    //
+    if (canRetry(_reply->error())) {
+        --m_retriesLeft;
+        sendRequest();
+        return;
+    }
 
     // требуется ли редирект?
     if (!_reply->header(QNetworkRequest::LocationHeader).isNull()) {
@@ -276,26 +399,18 @@ void WebLoader::downloadComplete(QNetworkReply* _reply)
         QUrl refererUrl = m_request.urlToLoad();
         m_request.setUrlReferer(refererUrl);
         // Получаем ссылку для загрузки из заголовка ответа [Loacation]
-        QUrl redirectUrl = _reply->header(QNetworkRequest::LocationHeader).toUrl();
+        QUrl redirectUrl = refererUrl.resolved(_reply->header(QNetworkRequest::LocationHeader).toUrl());
         m_request.setUrlToLoad(redirectUrl);
         m_parameters.setRequestMethod(NetworkRequestMethod::Get); // Редирект всегда методом Get
-        m_isNeedRedirect = true;
-    } else {
-        //! Загружены данные [reply->bytesAvailable()]
-        if (_reply->isOpen()) {
-            qint64 downloadedDataSize = _reply->bytesAvailable();
-            QByteArray downloadedData = _reply->read(downloadedDataSize);
-            m_downloadedData = downloadedData;
-        }
-        _reply->deleteLater();
-        m_isNeedRedirect = false;
+        sendRequest();
+        return;
     }
 
-    if (!isRunning()) {
-        wait(300);
+    //! Загружены данные [reply->bytesAvailable()]
+    if (_reply->isOpen()) {
+        m_downloadedData = _reply->readAll();
     }
-
-    quit(); // прерываем цикл обработки событий потока (возвращаемся в run())
+    finishLoading(true);
 }
 
 void WebLoader::downloadError(QNetworkReply::NetworkError _networkError)
@@ -307,6 +422,13 @@ void WebLoader::downloadError(QNetworkReply::NetworkError _networkError)
         }
 
         default: {
+            //
+            // Об ошибке, после которой запрос будет повторён, клиентов не уведомляем
+            //
+            if (canRetry(_networkError)) {
+                break;
+            }
+
             const QString lastError =
                     tr("Sorry, we have some error while loading. Error is: %1")
                     .arg(networkErrorToString(_networkError));
@@ -329,28 +451,7 @@ void WebLoader::downloadSslErrors(const QList<QSslError>& _errors)
     emit errorDetails(lastErrorDetails, m_requestSourceUrl);
 }
 
-void WebLoader::initNetworkManager()
+QNetworkCookieJar* WebLoader::cookieJar() const
 {
-    //
-    // Создаём загрузчика, если нужно
-    //
-    if (m_networkManager == nullptr) {
-        m_networkManager = new QNetworkAccessManager;
-    }
-
-    //
-    // Настраиваем куки
-    //
-    QNetworkCookieJar* cookie = m_parameters.cookieJar();
-    if (cookie != nullptr) {
-        m_networkManager->setCookieJar(cookie);
-        cookie->setParent(nullptr); // Убираем родителя, т.к. удалением управляет клиент
-    }
-
-    //
-    // Оключаем от предыдущих соединений и настраиваем новое
-    //
-    m_networkManager->disconnect();
-    connect(m_networkManager, &QNetworkAccessManager::finished,
-            this, static_cast<void (WebLoader::*)(QNetworkReply*)>(&WebLoader::downloadComplete));
+    return m_parameters.cookieJar() != nullptr ? m_parameters.cookieJar() : m_ownCookieJar;
 }
@@ -23,16 +23,21 @@
 #include "WebRequestParameters.h"
 
 #include <QNetworkReply>
-#include <QThread>
+#include <QObject>
+#include <QPointer>
 
 class QNetworkAccessManager;
+class QNetworkCookie;
 class QNetworkCookieJar;
+class QTimer;
 
 
 /**
  * @brief Класс для осуществления запросов по http(s)-протоколу
+ * @note Загрузчик живёт в одном из рабочих потоков очереди и выполняет запросы через общий
+ *       для этого потока менеджер загрузок, поэтому соединения с сервером переиспользуются
  */
-class WebLoader : public QThread
+class WebLoader : public QObject
 {
 	Q_OBJECT
 
@@ -87,13 +92,49 @@ signals:
     void errorDetails(QString, QUrl);
     /** @} */
 
-protected:
     /**
-     * @brief Работа потока
+     * @brief Выполнение запроса завершено
      */
-    void run() override;
+    void finished();
 
 private:
+    /**
+     * @brief Начать загрузку, выполняется в потоке загрузчика
+     */
+    Q_INVOKABLE void startLoading();
+
+    /**
+     * @brief Прервать загрузку, выполняется в потоке загрузчика
+     */
+    Q_INVOKABLE void abortLoading();
+
+    /**
+     * @brief Отправить запрос по текущей ссылке
+     * @note Куки клиента могут принадлежать другому потоку, тогда они читаются в его потоке,
+     *       а запрос отправляется, когда они будут получены
+     */
+    /** @{ */
+    void sendRequest();
+    void sendRequest(const QList<QNetworkCookie>& _cookies);
+    /** @} */
+
+    /**
+     * @brief Сохранить полученные от сервера куки в потоке, которому принадлежит хранилище
+     */
+    void storeCookies(const QList<QNetworkCookie>& _cookies, const QUrl& _url);
+
+    /**
+     * @brief Завершить загрузку и уведомить об этом клиентов
+     */
+    void finishLoading(bool _isDownloaded);
+
+    /**
+     * @brief Можно ли повторить запрос после ошибки
+     * @note Повторяются только GET-запросы, загрузки на сервер не повторяются и не докачиваются,
+     *       т.к. сервер не умеет продолжать прерванную загрузку
+     */
+    bool canRetry(QNetworkReply::NetworkError _networkError) const;
+
     /**
      * @brief Прогресс отправки запроса на сервер
      * @param uploadedBytes - отправлено байт
@@ -124,20 +165,41 @@ private:
 	void downloadSslErrors(const QList<QSslError>& _errors);
 
     /**
-     * @brief Подготовить менеджер загрузок для того, чтобы он работал в текущем потоке
+     * @brief Куки, используемые в текущей загрузке
      */
-	void initNetworkManager();
+    QNetworkCookieJar* cookieJar() const;
 
 private:
     /**
-     * @brief Необходимо ли остановить выполненеие процесса
+     * @brief Выполняется ли загрузка
+     */
+    bool m_isLoading = false;
+
+    /**
+     * @brief Номер текущей загрузки, куки, прочитанные для прерванной загрузки, отбрасываются
      */
-    bool m_isNeedStop = false;
+    int m_loadingId = 0;
 
     /**
-     * @brief Собственно загрузчик, который делает всю черновую работу
+     * @brief Ответ на текущий запрос
      */
-    QNetworkAccessManager* m_networkManager = nullptr;
+    QPointer<QNetworkReply> m_reply;
+
+    /**
+     * @brief Таймер для прерывания зависшей загрузки
+     */
+    QTimer* m_timeoutTimer = nullptr;
+
+    /**
+     * @brief Сколько ещё раз можно повторить запрос после обрыва соединения
+     */
+    int m_retriesLeft = 0;
+
+    /**
+     * @brief Куки загрузки, если клиент не задал свои
+     * @note Пересоздаются для каждой загрузки, чтобы запросы не делили состояние между собой
+     */
+    QNetworkCookieJar* m_ownCookieJar = nullptr;
 
     /**
      * @brief Объекст запроса
@@ -149,11 +211,6 @@ private:
      */
     WebRequestParameters m_parameters;
 
-    /**
-     * @brief Нужен ли редирект
-     */
-    bool m_isNeedRedirect = false;
-
     /**
      * @brief Исходная ссылка для загрузки
      * @note Во время редиректов ссылка в WebRequest'е может указывать не на исходно загружаемую страницу
@@ -19,6 +19,7 @@
 #include "HttpMultiPart.h"
 
 
+#include <QBuffer>
 #include <QFile>
 #include <QStringList>
 #include <QSslConfiguration>
@@ -164,16 +165,18 @@ QNetworkRequest WebRequest::networkRequest(bool _addContentHeaders)
         } else {
             request.setHeader(QNetworkRequest::ContentTypeHeader, kContentType);
         }
-        request.setHeader(QNetworkRequest::ContentLengthHeader, multiPartData().size());
     }
 
     return request;
 }
 
-QByteArray WebRequest::multiPartData()
+QIODevice* WebRequest::createMultiPartDevice(QObject* _parent) const
 {
     if(m_useRawData) {
-        return m_rawData;
+        QBuffer* buffer = new QBuffer(_parent);
+        buffer->setData(m_rawData);
+        buffer->open(QIODevice::ReadOnly);
+        return buffer;
     }
 
     HttpMultiPart multiPart;
@@ -203,7 +206,7 @@ QByteArray WebRequest::multiPartData()
         multiPart.addPart(filePart);
     }
 
-    return multiPart.data();
+    return multiPart.createDevice(_parent);
 }
 
 QVector<QPair<QString, QVariant>> WebRequest::attributes() const
@@ -23,6 +23,8 @@
 #include <QVariant>
 #include <QVector>
 
+class QIODevice;
+class QObject;
 
 /**
  * @brief Класс запроса
@@ -92,9 +94,10 @@ public:
     QNetworkRequest networkRequest(bool _addContentHeaders = false);
 
     /**
-     * @breif Получить данные запроса
+     * @brief Создать устройство для чтения данных запроса
+     * @note Файлы-атрибуты читаются с диска по мере отправки, а не загружаются в память заранее
      */
-    QByteArray  multiPartData();
+    QIODevice* createMultiPartDevice(QObject* _parent = nullptr) const;
 
 private:
     /**